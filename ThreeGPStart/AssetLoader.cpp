@@ -0,0 +1,123 @@
+#include "AssetLoader.h"
+#include <iomanip>
+
+namespace Helpers
+{
+	// Milliseconds between two clock readings
+	static double ElapsedMs(AssetLoader::Clock::time_point start, AssetLoader::Clock::time_point end)
+	{
+		return std::chrono::duration<double, std::milli>(end - start).count();
+	}
+
+	size_t AssetLoader::Queue(Request&& request, const std::string& filepath, std::function<bool()> load)
+	{
+		if (m_requests.empty())
+			m_startTime = Clock::now();
+
+		const size_t id{ m_requests.size() };
+
+		m_timings.emplace_back();
+		m_timings.back().filepath = filepath;
+
+		// Timings are written by the job before its future becomes ready so WaitAll sees them
+		Timing* timing{ &m_timings.back() };
+		const Clock::time_point queuedAt{ Clock::now() };
+
+		request.result = JobSystem::Get().Submit([load, queuedAt, timing]()
+			{
+				const Clock::time_point startedAt{ Clock::now() };
+				const bool loaded{ load() };
+
+				timing->queuedMs = ElapsedMs(queuedAt, startedAt);
+				timing->loadMs = ElapsedMs(startedAt, Clock::now());
+				return loaded;
+			});
+
+		m_requests.emplace_back(std::move(request));
+		return id;
+	}
+
+	// Queue an image decode, returns an id to retrieve it with
+	size_t AssetLoader::RequestImage(const std::string& filepath)
+	{
+		Request request;
+		request.image = std::make_unique<ImageLoader>();
+
+		ImageLoader* image{ request.image.get() };
+		return Queue(std::move(request), filepath, [image, filepath]() { return image->Load(filepath); });
+	}
+
+	// Queue a model import, returns an id to retrieve it with
+	size_t AssetLoader::RequestModel(const std::string& filepath)
+	{
+		Request request;
+		request.model = std::make_unique<ModelLoader>();
+
+		ModelLoader* model{ request.model.get() };
+		return Queue(std::move(request), filepath, [model, filepath]() { return model->LoadFromFile(filepath); });
+	}
+
+	// Blocks until all requests are complete. Returns false if any failed to load.
+	bool AssetLoader::WaitAll()
+	{
+		bool anyPending{ false };
+		bool allLoaded{ true };
+		for (size_t i = 0; i < m_requests.size(); i++)
+		{
+			Request& request{ m_requests[i] };
+			if (request.result.valid())
+			{
+				anyPending = true;
+				request.loaded = request.result.get();
+				m_timings[i].loaded = request.loaded;
+
+				if (!request.loaded)
+					std::cout << "AssetLoader failed to load: " << m_timings[i].filepath << std::endl;
+			}
+
+			allLoaded = allLoaded && request.loaded;
+		}
+
+		if (anyPending)
+			m_totalMs = ElapsedMs(m_startTime, Clock::now());
+
+		return allLoaded;
+	}
+
+	// Results, only valid after WaitAll. Returns nullptr if the load failed.
+	ImageLoader* AssetLoader::GetImage(size_t id) const
+	{
+		return m_requests[id].loaded ? m_requests[id].image.get() : nullptr;
+	}
+
+	ModelLoader* AssetLoader::GetModel(size_t id) const
+	{
+		return m_requests[id].loaded ? m_requests[id].model.get() : nullptr;
+	}
+
+	// Output the per asset timings, the slowest asset is the critical path of the load
+	void AssetLoader::ReportTimings() const
+	{
+		std::cout << "\nAsset load timings (ms) using " << JobSystem::Get().NumWorkers() << " workers" << std::endl;
+		std::cout << std::left << std::setw(48) << "Asset" << std::right
+			<< std::setw(10) << "Queued" << std::setw(10) << "Load" << std::setw(10) << "Upload" << std::endl;
+
+		double sumMs{ 0 };
+		size_t slowest{ 0 };
+		for (size_t i = 0; i < m_timings.size(); i++)
+		{
+			const Timing& timing{ m_timings[i] };
+			std::cout << std::left << std::setw(48) << timing.filepath << std::right << std::fixed << std::setprecision(2)
+				<< std::setw(10) << timing.queuedMs << std::setw(10) << timing.loadMs << std::setw(10) << timing.uploadMs
+				<< (timing.loaded ? "" : "  FAILED") << std::endl;
+
+			sumMs += timing.loadMs;
+			if (timing.queuedMs + timing.loadMs > m_timings[slowest].queuedMs + m_timings[slowest].loadMs)
+				slowest = i;
+		}
+
+		if (!m_timings.empty())
+			std::cout << "Critical path: " << m_timings[slowest].filepath << std::endl;
+		std::cout << "Wall time: " << m_totalMs << " Sum of load times: " << sumMs << std::endl;
+	}
+}
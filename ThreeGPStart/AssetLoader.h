@@ -0,0 +1,82 @@
+#pragma once
+
+#include "ExternalLibraryHeaders.h"
+#include "ImageLoader.h"
+#include "Mesh.h"
+#include "JobSystem.h"
+
+#include <chrono>
+
+namespace Helpers
+{
+	// Loads images and models on the worker pool so level load is not limited to one core
+	// Request everything up front, do other CPU work, then WaitAll and upload the results on the GL thread
+	class AssetLoader
+	{
+	public:
+		using Clock = std::chrono::high_resolution_clock;
+
+		// Where the time went for a single asset, all in milliseconds
+		struct Timing
+		{
+			std::string filepath;
+			double queuedMs{ 0 };	// Waiting for a free worker
+			double loadMs{ 0 };		// Decode / import on the worker
+			double uploadMs{ 0 };	// Creating the OpenGL resources on the main thread
+			bool loaded{ false };
+		};
+	private:
+		struct Request
+		{
+			std::unique_ptr<ImageLoader> image;
+			std::unique_ptr<ModelLoader> model;
+			std::future<bool> result;
+			bool loaded{ false };
+		};
+
+		std::vector<Request> m_requests;
+
+		// A deque so workers can hold on to their entry while more requests are added
+		std::deque<Timing> m_timings;
+		Clock::time_point m_startTime{ Clock::now() };
+		double m_totalMs{ 0 };
+
+		size_t Queue(Request&& request, const std::string& filepath, std::function<bool()> load);
+	public:
+		AssetLoader() = default;
+		~AssetLoader() { WaitAll(); }
+
+		AssetLoader(const AssetLoader&) = delete;
+		AssetLoader& operator=(const AssetLoader&) = delete;
+
+		// Queue an image decode, returns an id to retrieve it with
+		size_t RequestImage(const std::string& filepath);
+
+		// Queue a model import, returns an id to retrieve it with
+		size_t RequestModel(const std::string& filepath);
+
+		// Blocks until all requests are complete. Returns false if any failed to load.
+		bool WaitAll();
+
+		// Results, only valid after WaitAll. Returns nullptr if the load failed.
+		ImageLoader* GetImage(size_t id) const;
+		ModelLoader* GetModel(size_t id) const;
+
+		// Record the time spent turning a loaded asset into OpenGL resources
+		void AddUploadTime(size_t id, double uploadMs) { m_timings[id].uploadMs += uploadMs; }
+
+		// Frees one decoded image as soon as it has been uploaded, GetImage returns nullptr after
+		void ReleaseImage(size_t id) { m_requests[id].image.reset(); }
+
+		// Releases the CPU side copies once they have been uploaded
+		void Clear() { WaitAll(); m_requests.clear(); }
+
+		const std::deque<Timing>& GetTimings() const { return m_timings; }
+
+		// Wall clock time from the first request to WaitAll returning
+		double GetTotalMs() const { return m_totalMs; }
+
+		// Output the per asset timings, the slowest asset is the critical path of the load
+		void ReportTimings() const;
+	};
+}
@@ -0,0 +1,1028 @@
+#include "Benchmark.h"
+#include "Mesh.h"
+#include "VertexFormat.h"
+#include "Terrain.h"
+#include "TerrainBuilder.h"
+#include "FractalNoise.h"
+#include "JobSystem.h"
+#include "RenderQueue.h"
+#include "ImageLoader.h"
+#include "TextureCompression.h"
+#include "DDSFile.h"
+#include "TextureManager.h"
+#include "ClusteredLights.h"
+#include <Psapi.h>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <numeric>
+#include <random>
+#include <thread>
+namespace fs = std::filesystem;
+
+namespace Benchmarks
+{
+	using Clock = std::chrono::high_resolution_clock;
+
+	// Milliseconds between two clock readings
+	static double ElapsedMs(Clock::time_point start, Clock::time_point end)
+	{
+		return std::chrono::duration<double, std::milli>(end - start).count();
+	}
+
+	// Run every benchmark in turn
+	void RunAll()
+	{
+		std::cout << "\nRunning benchmarks" << std::endl;
+
+		ModelCache("Data\\Models");
+		VertexPacking("Data\\Models");
+		TerrainCulling();
+		TerrainLod();
+		TerrainBuild();
+		NoiseThroughput();
+		GridNormals();
+		RenderQueue();
+		TextureCompression();
+		DDSFiles();
+		ImageLoading("Data\\Models\\Sky");
+		ClusteredLighting();
+
+		std::cout << "Benchmarks complete\n" << std::endl;
+	}
+
+	// Compares a cold ASSIMP import against the binary mesh cache for every model under modelsFolder
+	void ModelCache(const std::string& modelsFolder)
+	{
+		Assimp::Importer importer;
+
+		std::cout << "\nModel cache: cold ASSIMP vs cached load" << std::endl;
+		std::cout << std::left << std::setw(48) << "Model" << std::right
+			<< std::setw(12) << "ASSIMP ms" << std::setw(12) << "Cache ms" << std::setw(10) << "Speedup" << std::endl;
+
+		double totalCold{ 0 };
+		double totalCached{ 0 };
+
+		for (const fs::directory_entry& entry : fs::recursive_directory_iterator(modelsFolder))
+		{
+			if (!entry.is_regular_file())
+				continue;
+
+			const std::string extension{ entry.path().extension().string() };
+			if (extension == ".meshcache" || extension == ".tmp" || !importer.IsExtensionSupported(extension))
+				continue;
+
+			const std::string filename{ entry.path().string() };
+
+			// Cold: straight through ASSIMP, the cache is neither read nor written
+			Clock::time_point start{ Clock::now() };
+			{
+				Helpers::ModelLoader loader;
+				if (!loader.LoadFromFile(filename, false))
+					continue;
+			}
+			const double coldMs{ ElapsedMs(start, Clock::now()) };
+
+			// Make sure the cache is up to date, then time a warm load
+			{
+				Helpers::ModelLoader loader;
+				loader.LoadFromFile(filename, true);
+			}
+
+			start = Clock::now();
+			{
+				Helpers::ModelLoader loader;
+				loader.LoadFromFile(filename, true);
+			}
+			const double cachedMs{ ElapsedMs(start, Clock::now()) };
+
+			totalCold += coldMs;
+			totalCached += cachedMs;
+
+			std::cout << std::left << std::setw(48) << filename << std::right << std::fixed << std::setprecision(2)
+				<< std::setw(12) << coldMs << std::setw(12) << cachedMs << std::setw(9) << coldMs / std::max(cachedMs, 0.001) << "x" << std::endl;
+		}
+
+		std::cout << std::left << std::setw(48) << "Total" << std::right << std::fixed << std::setprecision(2)
+			<< std::setw(12) << totalCold << std::setw(12) << totalCached << std::setw(9) << totalCold / std::max(totalCached, 0.001) << "x" << std::endl;
+	}
+
+	// Checks the packed vertex formats decode back within tolerance and reports the bytes saved for every model
+	void VertexPacking(const std::string& modelsFolder)
+	{
+		// 10 bit snorm gives 1/511 per component and half floats ~1/2048 in the 0-1 range
+		const float KMaxNormalError{ 0.005f };
+		const float KMaxUVError{ 0.001f };
+
+		Assimp::Importer importer;
+
+		std::cout << "\nVertex packing: round trip error and bytes saved" << std::endl;
+		std::cout << std::left << std::setw(48) << "Model" << std::right << std::setw(12) << "Normal err" << std::setw(12) << "UV err"
+			<< std::setw(12) << "Unpacked" << std::setw(12) << "Packed" << std::setw(10) << "Saved" << std::endl;
+
+		size_t totalUnpacked{ 0 };
+		size_t totalPacked{ 0 };
+		bool allPassed{ true };
+
+		for (const fs::directory_entry& entry : fs::recursive_directory_iterator(modelsFolder))
+		{
+			const std::string extension{ entry.path().extension().string() };
+			if (!entry.is_regular_file() || extension == ".meshcache" || !importer.IsExtensionSupported(extension))
+				continue;
+
+			const std::string filename{ entry.path().string() };
+			Helpers::ModelLoader loader;
+			if (!loader.LoadFromFile(filename))
+				continue;
+
+			float maxNormalError{ 0 };
+			float maxUVError{ 0 };
+			bool positionsAndElementsExact{ true };
+			size_t unpacked{ 0 };
+			size_t packed{ 0 };
+
+			for (const Helpers::Mesh& mesh : loader.GetMeshVector())
+			{
+				const Helpers::InterleavedMesh interleaved{ Helpers::BuildInterleavedMesh(mesh) };
+				unpacked += interleaved.unpackedBytes;
+				packed += interleaved.PackedBytes();
+
+				for (size_t v = 0; v < mesh.vertices.size(); v++)
+				{
+					if (interleaved.GetPosition(v) != mesh.vertices[v])
+						positionsAndElementsExact = false;
+
+					if (v < mesh.normals.size() && glm::length(mesh.normals[v]) > 0)
+					{
+						const glm::vec3 error{ interleaved.GetNormal(v) - glm::normalize(mesh.normals[v]) };
+						maxNormalError = std::max({ maxNormalError, std::abs(error.x), std::abs(error.y), std::abs(error.z) });
+					}
+
+					if (v < mesh.uvCoords.size())
+					{
+						const glm::vec2 error{ interleaved.GetUV(v) - mesh.uvCoords[v] };
+						maxUVError = std::max({ maxUVError, std::abs(error.x), std::abs(error.y) });
+					}
+				}
+
+				for (size_t e = 0; e < mesh.elements.size(); e++)
+				{
+					if (interleaved.GetElement(e) != mesh.elements[e])
+						positionsAndElementsExact = false;
+				}
+			}
+
+			const bool passed{ positionsAndElementsExact && maxNormalError <= KMaxNormalError && maxUVError <= KMaxUVError };
+			allPassed = allPassed && passed;
+			totalUnpacked += unpacked;
+			totalPacked += packed;
+
+			std::cout << std::left << std::setw(48) << filename << std::right << std::fixed << std::setprecision(5)
+				<< std::setw(12) << maxNormalError << std::setw(12) << maxUVError
+				<< std::setw(12) << unpacked << std::setw(12) << packed << std::setw(10) << (long long)unpacked - (long long)packed
+				<< (passed ? "" : "  FAILED") << std::endl;
+		}
+
+		std::cout << "Total saved " << (long long)totalUnpacked - (long long)totalPacked << " of " << totalUnpacked << " bytes. "
+			<< (allPassed ? "All models within tolerance" : "Some models FAILED the round trip check") << std::endl;
+	}
+
+	// Vertex spacing of the terrain in Renderer::InitialiseGeometry
+	static const glm::vec2 KTerrainSpacing{ 100.0f, 150.0f };
+
+	// CPU only terrain of numVerts x numVerts vertices
+	static bool BuildBenchmarkTerrain(int numVerts, Helpers::Terrain& terrain)
+	{
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec3> normals((size_t)numVerts * numVerts, glm::vec3(0, 1, 0));
+		std::vector<glm::vec2> uvs((size_t)numVerts * numVerts, glm::vec2(0));
+		positions.reserve(normals.size());
+		for (int x = 0; x < numVerts; x++)
+			for (int z = 0; z < numVerts; z++)
+				positions.push_back(glm::vec3(x * KTerrainSpacing.x, 50.0f * std::sin(x * 0.1f) * std::cos(z * 0.1f), z * KTerrainSpacing.y));
+
+		return terrain.BuildChunks(positions, normals, uvs, numVerts, numVerts);
+	}
+
+	// Flies a scripted camera over the chunked terrain and reports the triangles submitted per frame with and without culling
+	void TerrainCulling()
+	{
+		// Same size as the terrain in Renderer::InitialiseGeometry
+		const int numVerts{ 501 };
+		Helpers::Terrain terrain;
+		if (!BuildBenchmarkTerrain(numVerts, terrain))
+			return;
+
+		// Matches the projection in Renderer::Render for a 1280 x 720 window
+		const glm::mat4 projection{ glm::perspective(glm::radians(45.0f), 1280.0f / 720.0f, 1.0f, 40000.0f) };
+		const glm::vec3 centre{ (numVerts - 1) * KTerrainSpacing.x * 0.5f, 0, (numVerts - 1) * KTerrainSpacing.y * 0.5f };
+
+		// Circle the middle of the terrain at two heights, looking along the path and slightly down
+		const int KNumFrames{ 720 };
+		std::vector<size_t> visibleChunks;
+		size_t minTriangles{ std::numeric_limits<size_t>::max() };
+		size_t maxTriangles{ 0 };
+		double totalTriangles{ 0 };
+		double totalCullMs{ 0 };
+
+		for (int frame = 0; frame < KNumFrames; frame++)
+		{
+			const float angle{ glm::two_pi<float>() * frame / (KNumFrames / 2) };
+			const float height{ frame < KNumFrames / 2 ? 500.0f : 5000.0f };
+			const glm::vec3 position{ centre + glm::vec3(std::cos(angle) * centre.x * 0.6f, height, std::sin(angle) * centre.z * 0.6f) };
+			const glm::vec3 forward{ -std::sin(angle), -0.2f, std::cos(angle) };
+
+			const glm::mat4 view{ glm::lookAt(position, position + forward, glm::vec3(0, 1, 0)) };
+
+			const Clock::time_point start{ Clock::now() };
+			const size_t triangles{ terrain.Cull(Helpers::Frustum(projection * view), visibleChunks) };
+			totalCullMs += ElapsedMs(start, Clock::now());
+
+			minTriangles = std::min(minTriangles, triangles);
+			maxTriangles = std::max(maxTriangles, triangles);
+			totalTriangles += triangles;
+		}
+
+		std::cout << "\nTerrain culling over " << KNumFrames << " frames, " << terrain.NumChunks() << " chunks" << std::endl;
+		std::cout << "Triangles per frame without culling: " << terrain.NumTriangles() << std::endl;
+		std::cout << std::fixed << std::setprecision(0) << "Triangles per frame with culling: min " << minTriangles
+			<< " max " << maxTriangles << " average " << totalTriangles / KNumFrames << std::endl;
+		std::cout << std::setprecision(4) << "Average cull time " << totalCullMs / KNumFrames << " ms" << std::endl;
+	}
+
+	// Checks every stitched element list covers its chunk exactly once, then flies a camera over increasingly large
+	// terrains and reports the triangles submitted per frame with culling alone and with culling plus LOD
+	void TerrainLod()
+	{
+		std::cout << "\nTerrain LOD" << std::endl;
+
+		Helpers::Terrain terrain;
+		if (!BuildBenchmarkTerrain(Helpers::Terrain::KChunkVerts, terrain))
+			return;
+
+		// Triangles within a variant must all wind the same way and add up to the area of the chunk,
+		// and a stitched edge may only use vertices that also exist one level down
+		const std::vector<GLushort>& elements{ terrain.GetElements() };
+		auto gridPosition = [](GLushort element)
+		{
+			return glm::vec2(element / Helpers::Terrain::KChunkVerts, element % Helpers::Terrain::KChunkVerts);
+		};
+
+		size_t failures{ 0 };
+		for (int lod = 0; lod < Helpers::Terrain::KNumLods - 1; lod++)
+		{
+			const int coarseStep{ 2 << lod };
+			for (unsigned int stitch = 0; stitch < Helpers::Terrain::KNumStitchVariants; stitch++)
+			{
+				const Helpers::Terrain::ElementRange& range{ terrain.GetElementRange(lod, stitch) };
+
+				float area{ 0 };
+				float winding{ 0 };
+				for (size_t i = range.first; i < range.first + range.count; i += 3)
+				{
+					const glm::vec2 a{ gridPosition(elements[i]) };
+					const glm::vec2 b{ gridPosition(elements[i + 1]) };
+					const glm::vec2 c{ gridPosition(elements[i + 2]) };
+
+					const float twiceArea{ (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x) };
+					if (winding == 0)
+						winding = twiceArea > 0 ? 1.0f : -1.0f;
+					if (twiceArea * winding <= 0)
+						failures++;
+					area += std::abs(twiceArea) * 0.5f;
+				}
+
+				if (area != (float)(Helpers::Terrain::KChunkCells * Helpers::Terrain::KChunkCells))
+					failures++;
+
+				for (size_t i = range.first; i < range.first + range.count; i++)
+				{
+					const glm::vec2 position{ gridPosition(elements[i]) };
+					const bool onNegX{ position.x == 0 && (stitch & Helpers::Terrain::KStitchNegX) };
+					const bool onPosX{ position.x == Helpers::Terrain::KChunkCells && (stitch & Helpers::Terrain::KStitchPosX) };
+					const bool onNegZ{ position.y == 0 && (stitch & Helpers::Terrain::KStitchNegZ) };
+					const bool onPosZ{ position.y == Helpers::Terrain::KChunkCells && (stitch & Helpers::Terrain::KStitchPosZ) };
+
+					if (((onNegX || onPosX) && (int)position.y % coarseStep) || ((onNegZ || onPosZ) && (int)position.x % coarseStep))
+						failures++;
+				}
+			}
+		}
+		std::cout << "Stitched element lists: " << (failures ? "FAILED" : "passed") << std::endl;
+
+		// Matches the projection in Renderer::Render for a 1280 x 720 window
+		const glm::mat4 projection{ glm::perspective(glm::radians(45.0f), 1280.0f / 720.0f, 1.0f, 40000.0f) };
+
+		std::cout << std::setw(10) << "Grid" << std::setw(10) << "Chunks" << std::setw(14) << "All"
+			<< std::setw(14) << "Culled" << std::setw(14) << "Culled+LOD" << std::setw(12) << "LOD ms" << std::endl;
+
+		for (int numVerts : { 513, 1025, 2049 })
+		{
+			if (!BuildBenchmarkTerrain(numVerts, terrain))
+				continue;
+
+			// Circle a fixed distance around the middle so only the terrain size changes
+			const glm::vec3 centre{ (numVerts - 1) * KTerrainSpacing.x * 0.5f, 0, (numVerts - 1) * KTerrainSpacing.y * 0.5f };
+			const int KNumFrames{ 360 };
+
+			std::vector<size_t> visibleChunks;
+			std::vector<int> chunkLods;
+			double culledTriangles{ 0 };
+			double lodTriangles{ 0 };
+			double totalLodMs{ 0 };
+
+			for (int frame = 0; frame < KNumFrames; frame++)
+			{
+				const float angle{ glm::two_pi<float>() * frame / KNumFrames };
+				const glm::vec3 position{ centre + glm::vec3(std::cos(angle) * 5000.0f, 500.0f, std::sin(angle) * 5000.0f) };
+				const glm::vec3 forward{ -std::sin(angle), -0.2f, std::cos(angle) };
+				const glm::mat4 view{ glm::lookAt(position, position + forward, glm::vec3(0, 1, 0)) };
+
+				culledTriangles += terrain.Cull(Helpers::Frustum(projection * view), visibleChunks);
+
+				const Clock::time_point start{ Clock::now() };
+				terrain.SelectLods(position, chunkLods);
+				totalLodMs += ElapsedMs(start, Clock::now());
+
+				lodTriangles += terrain.CountTriangles(visibleChunks, chunkLods);
+			}
+
+			std::cout << std::fixed << std::setprecision(0) << std::setw(10) << numVerts << std::setw(10) << terrain.NumChunks()
+				<< std::setw(14) << terrain.NumTriangles() << std::setw(14) << culledTriangles / KNumFrames
+				<< std::setw(14) << lodTriangles / KNumFrames << std::setprecision(4) << std::setw(12) << totalLodMs / KNumFrames << std::endl;
+		}
+	}
+
+	// Times TerrainBuilder resampling a 1024 x 1024 source at increasing grid sizes. The row sampler is checked
+	// against the scalar TerrainBuilder::Sample, Build adds the positions, normals and uvs on top.
+	void TerrainBuild()
+	{
+		Helpers::TerrainBuilder builder;
+		builder.SetProcedural(1024, 1024, [](int x, int z)
+			{
+				unsigned int n{ (unsigned int)(x * 73856093) ^ (unsigned int)(z * 19349663) };
+				n = (n << 13) ^ n;
+				return (float)((n * (n * n * 15731 + 789221) + 1376312589) & 0x7fffffff) / 2147483647.0f;
+			});
+
+		std::cout << "\nTerrain build from a 1024 x 1024 source" << std::endl;
+		std::cout << std::setw(10) << "Grid" << std::setw(12) << "Scalar ms" << std::setw(12) << "Rows ms" << std::setw(10) << "Speedup"
+			<< std::setw(12) << "Max error" << std::setw(12) << "Build ms" << std::setw(14) << "MVerts/s" << std::endl;
+
+		std::vector<float> heights;
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec3> normals;
+		std::vector<glm::vec2> uvs;
+		for (int numVerts : { 513, 2049, 4097 })
+		{
+			// Touch the memory first so the timings do not include the allocation
+			heights.assign((size_t)numVerts * numVerts, 0.0f);
+
+			const Clock::time_point scalarStart{ Clock::now() };
+			for (int x = 0; x < numVerts; x++)
+				for (int z = 0; z < numVerts; z++)
+					heights[(size_t)x * numVerts + z] = builder.Sample((float)x / (numVerts - 1), (float)z / (numVerts - 1));
+			const double scalarMs{ ElapsedMs(scalarStart, Clock::now()) };
+
+			std::vector<float> rowHeights(heights.size());
+			const Clock::time_point rowsStart{ Clock::now() };
+			builder.SampleGrid(numVerts, numVerts, rowHeights);
+			const double rowsMs{ ElapsedMs(rowsStart, Clock::now()) };
+
+			float maxError{ 0 };
+			for (size_t i = 0; i < heights.size(); i++)
+				maxError = std::max(maxError, std::abs(heights[i] - rowHeights[i]));
+
+			const Clock::time_point buildStart{ Clock::now() };
+			if (!builder.Build(numVerts, numVerts, KTerrainSpacing, 1.0f, 1.0f, positions, normals, uvs))
+				return;
+			const double buildMs{ ElapsedMs(buildStart, Clock::now()) };
+
+			std::cout << std::fixed << std::setw(10) << numVerts << std::setprecision(2) << std::setw(12) << scalarMs
+				<< std::setw(12) << rowsMs << std::setw(10) << scalarMs / rowsMs
+				<< std::scientific << std::setprecision(1) << std::setw(12) << maxError
+				<< std::fixed << std::setprecision(2) << std::setw(12) << buildMs << std::setw(14) << (double)numVerts * numVerts / (buildMs * 1000.0)
+				<< (maxError < 1e-4f ? "" : "  FAILED") << std::endl;
+		}
+	}
+
+	// Samples per second for each noise fractal one at a time, four at a time and filling a grid across every worker.
+	// Also checks the four wide results match the scalar ones.
+	void NoiseThroughput()
+	{
+		const Helpers::FractalNoise noise;
+		const char* names[Helpers::KNumNoiseFractals]{ "Gradient", "fBm", "Ridged", "Warped" };
+
+		// Enough work per variant to time but not so much the benchmark drags
+		const int KGridSize{ 512 };
+		const size_t numSamples{ (size_t)KGridSize * KGridSize };
+
+		std::cout << "\nNoise samples per second (millions), " << noise.GetSettings().octaves << " octaves, "
+			<< Helpers::JobSystem::Get().NumWorkers() << " workers" << std::endl;
+		std::cout << std::left << std::setw(12) << "Fractal" << std::right << std::setw(12) << "Scalar" << std::setw(12) << "SSE x4"
+			<< std::setw(12) << "Grid" << std::setw(12) << "Max diff" << std::endl;
+
+		std::vector<float> scalar(numSamples);
+		std::vector<float> wide(numSamples);
+		std::vector<float> grid;
+		for (int fractal = 0; fractal < Helpers::KNumNoiseFractals; fractal++)
+		{
+			const Helpers::NoiseFractal type{ (Helpers::NoiseFractal)fractal };
+
+			const Clock::time_point scalarStart{ Clock::now() };
+			for (int x = 0; x < KGridSize; x++)
+				for (int z = 0; z < KGridSize; z++)
+					scalar[(size_t)x * KGridSize + z] = noise.Evaluate(type, (float)x, (float)z);
+			const double scalarMs{ ElapsedMs(scalarStart, Clock::now()) };
+
+			const Clock::time_point wideStart{ Clock::now() };
+			for (int x = 0; x < KGridSize; x++)
+			{
+				const float xs[4]{ (float)x, (float)x, (float)x, (float)x };
+				for (int z = 0; z < KGridSize; z += 4)
+				{
+					const float zs[4]{ (float)z, (float)z + 1, (float)z + 2, (float)z + 3 };
+					noise.Evaluate4(type, xs, zs, wide.data() + (size_t)x * KGridSize + z);
+				}
+			}
+			const double wideMs{ ElapsedMs(wideStart, Clock::now()) };
+
+			const Clock::time_point gridStart{ Clock::now() };
+			noise.FillGrid(type, KGridSize, KGridSize, grid);
+			const double gridMs{ ElapsedMs(gridStart, Clock::now()) };
+
+			float maxDiff{ 0 };
+			for (size_t i = 0; i < numSamples; i++)
+				maxDiff = std::max({ maxDiff, std::abs(scalar[i] - wide[i]), std::abs(scalar[i] - grid[i]) });
+
+			std::cout << std::left << std::setw(12) << names[fractal] << std::right << std::fixed << std::setprecision(2)
+				<< std::setw(12) << numSamples / (scalarMs * 1000.0) << std::setw(12) << numSamples / (wideMs * 1000.0)
+				<< std::setw(12) << numSamples / (gridMs * 1000.0) << std::scientific << std::setprecision(1) << std::setw(12) << maxDiff
+				<< std::defaultfloat << (maxDiff < 1e-5f ? "" : "  FAILED") << std::endl;
+		}
+	}
+
+	// Reference normals for GridNormals, each triangle of the grid adds its area weighted face normal to its corners.
+	// Uses the same alternating diagonal as Terrain.
+	static void AccumulateTriangleNormals(const std::vector<float>& heights, int numVertX, int numVertZ, const glm::vec2& spacing,
+		std::vector<glm::vec3>& normals)
+	{
+		normals.assign(heights.size(), glm::vec3(0));
+		auto position = [&](int x, int z) { return glm::vec3(x * spacing.x, heights[(size_t)x * numVertZ + z], z * spacing.y); };
+		auto addTriangle = [&](int x0, int z0, int x1, int z1, int x2, int z2)
+		{
+			const glm::vec3 faceNormal{ glm::cross(position(x1, z1) - position(x0, z0), position(x2, z2) - position(x0, z0)) };
+			normals[(size_t)x0 * numVertZ + z0] += faceNormal;
+			normals[(size_t)x1 * numVertZ + z1] += faceNormal;
+			normals[(size_t)x2 * numVertZ + z2] += faceNormal;
+		};
+
+		for (int x = 0; x < numVertX - 1; x++)
+		{
+			for (int z = 0; z < numVertZ - 1; z++)
+			{
+				if ((x + z) % 2)
+				{
+					addTriangle(x, z, x, z + 1, x + 1, z);
+					addTriangle(x, z + 1, x + 1, z + 1, x + 1, z);
+				}
+				else
+				{
+					addTriangle(x, z, x, z + 1, x + 1, z + 1);
+					addTriangle(x, z, x + 1, z + 1, x + 1, z);
+				}
+			}
+		}
+
+		for (glm::vec3& normal : normals)
+			normal = glm::normalize(normal);
+	}
+
+	// Checks Helpers::ComputeGridNormals against per triangle accumulation, exactly on a slope and closely on noise terrain,
+	// and times the two
+	void GridNormals()
+	{
+		const int numVerts{ 513 };
+		std::vector<float> heights((size_t)numVerts * numVerts);
+		std::vector<glm::vec3> normals;
+		std::vector<glm::vec3> reference;
+
+		// On a flat slope both must give the slope's normal everywhere
+		const glm::vec2 slope{ 0.3f, -0.7f };
+		for (int x = 0; x < numVerts; x++)
+			for (int z = 0; z < numVerts; z++)
+				heights[(size_t)x * numVerts + z] = slope.x * x * KTerrainSpacing.x + slope.y * z * KTerrainSpacing.y;
+
+		Helpers::ComputeGridNormals(heights, numVerts, numVerts, KTerrainSpacing, normals);
+		AccumulateTriangleNormals(heights, numVerts, numVerts, KTerrainSpacing, reference);
+
+		const glm::vec3 expected{ glm::normalize(glm::vec3(-slope.x, 1.0f, -slope.y)) };
+		float slopeError{ 0 };
+		for (size_t i = 0; i < normals.size(); i++)
+			slopeError = std::max({ slopeError, glm::length(normals[i] - expected), glm::length(reference[i] - expected) });
+
+		// On noise they differ a little as central differences ignore which way each cell is split
+		Helpers::FractalNoise(Helpers::NoiseSettings()).FillGrid(Helpers::KNoiseFbm, numVerts, numVerts, heights);
+		for (float& height : heights)
+			height *= 600.0f;
+
+		const Clock::time_point gridStart{ Clock::now() };
+		Helpers::ComputeGridNormals(heights, numVerts, numVerts, KTerrainSpacing, normals);
+		const double gridMs{ ElapsedMs(gridStart, Clock::now()) };
+
+		const Clock::time_point referenceStart{ Clock::now() };
+		AccumulateTriangleNormals(heights, numVerts, numVerts, KTerrainSpacing, reference);
+		const double referenceMs{ ElapsedMs(referenceStart, Clock::now()) };
+
+		double totalDegrees{ 0 };
+		float maxDegrees{ 0 };
+		for (size_t i = 0; i < normals.size(); i++)
+		{
+			const float degrees{ glm::degrees(std::acos(glm::clamp(glm::dot(normals[i], reference[i]), -1.0f, 1.0f))) };
+			totalDegrees += degrees;
+			maxDegrees = std::max(maxDegrees, degrees);
+		}
+		const double meanDegrees{ totalDegrees / normals.size() };
+
+		const bool passed{ slopeError < 1e-4f && meanDegrees < 1.0 && maxDegrees < 5.0f };
+		std::cout << "\nGrid normals " << numVerts << " x " << numVerts << std::endl;
+		std::cout << std::fixed << std::setprecision(2) << "Central differences " << gridMs << " ms, triangle accumulation "
+			<< referenceMs << " ms" << std::endl;
+		std::cout << std::scientific << std::setprecision(1) << "Largest error on a slope " << slopeError << std::endl;
+		std::cout << std::fixed << std::setprecision(3) << "Difference on noise terrain: mean " << meanDegrees << " max " << maxDegrees
+			<< " degrees. " << (passed ? "Passed" : "FAILED") << std::endl;
+	}
+
+	// Times recording, sorting and dispatching the render queue at 10k and 100k commands, and checks the sort order.
+	// Nothing is drawn, so this is the CPU cost the queue adds on top of the draws themselves.
+	void RenderQueue()
+	{
+		const int KRepeats{ 20 };
+		const float KMaxDepth{ 40000.0f };
+
+		std::cout << "\nRender queue, ns per command averaged over " << KRepeats << " frames" << std::endl;
+		std::cout << std::right << std::setw(10) << "Commands" << std::setw(10) << "Record" << std::setw(10) << "Sort"
+			<< std::setw(12) << "std::sort" << std::setw(10) << "Dispatch" << std::setw(10) << "Total" << std::setw(10) << "Sorted" << std::endl;
+
+		for (size_t numCommands : { 10000, 100000 })
+		{
+			// A scene's worth of draws: mostly opaque, some transparent and a few sky, spread over 256 textures.
+			// Without a GL context every program id is 0 so only layer, texture and depth vary the keys.
+			std::mt19937 random{ 1234 };
+			std::uniform_int_distribution<int> layerChoice{ 0, 15 };
+			std::uniform_int_distribution<GLuint> textureChoice{ 1, 256 };
+			std::uniform_real_distribution<float> depthChoice{ 0.0f, KMaxDepth };
+
+			std::vector<Helpers::RenderLayer> layers(numCommands);
+			std::vector<float> depths(numCommands);
+			std::vector<Helpers::RenderQueue::Command> commands(numCommands);
+			for (size_t i = 0; i < numCommands; i++)
+			{
+				const int choice{ layerChoice(random) };
+				layers[i] = choice == 0 ? Helpers::KLayerSky : choice < 13 ? Helpers::KLayerOpaque : Helpers::KLayerTransparent;
+				depths[i] = depthChoice(random);
+				commands[i].texture = textureChoice(random);
+				commands[i].vertexArray = (GLuint)(i % 64) + 1;
+				commands[i].numElements = (GLsizei)(i % 1000) * 3;
+			}
+
+			Helpers::RenderQueue queue;
+			queue.SetMaxDepth(KMaxDepth);
+
+			double recordMs{ 0 };
+			double sortMs{ 0 };
+			double dispatchMs{ 0 };
+			size_t checksum{ 0 };
+			for (int repeat = 0; repeat < KRepeats; repeat++)
+			{
+				const Clock::time_point recordStart{ Clock::now() };
+				queue.Clear();
+				for (size_t i = 0; i < numCommands; i++)
+				{
+					Helpers::RenderQueue::Command command{ commands[i] };
+					command.transform = queue.AddTransform(glm::translate(glm::mat4(1.0f), glm::vec3(depths[i], 0.0f, 0.0f)));
+					queue.Submit(command, layers[i], depths[i]);
+				}
+				const Clock::time_point sortStart{ Clock::now() };
+				queue.Sort();
+				const Clock::time_point dispatchStart{ Clock::now() };
+				queue.Dispatch([&](const Helpers::RenderQueue::Command& command)
+					{
+						checksum += command.numElements + (size_t)queue.GetTransform(command.transform)[3].x;
+					});
+				const Clock::time_point end{ Clock::now() };
+
+				recordMs += ElapsedMs(recordStart, sortStart);
+				sortMs += ElapsedMs(sortStart, dispatchStart);
+				dispatchMs += ElapsedMs(dispatchStart, end);
+			}
+
+			// The same keys through std::sort, which must also give the same order
+			std::vector<std::pair<uint64_t, uint32_t>> reference(numCommands);
+			double stdSortMs{ 0 };
+			for (int repeat = 0; repeat < KRepeats; repeat++)
+			{
+				for (size_t i = 0; i < numCommands; i++)
+					reference[i] = { queue.MakeKey(layers[i], 0, commands[i].texture, depths[i]), (uint32_t)i };
+
+				const Clock::time_point start{ Clock::now() };
+				std::sort(reference.begin(), reference.end());
+				stdSortMs += ElapsedMs(start, Clock::now());
+			}
+
+			// Keeps the dispatch loop from being optimised away
+			static volatile size_t s_checksum;
+			s_checksum = checksum;
+
+			bool sorted{ queue.Size() == numCommands };
+			for (size_t i = 0; sorted && i < numCommands; i++)
+				sorted = queue.GetSortedKey(i) == reference[i].first;
+
+			const double toNs{ 1e6 / ((double)KRepeats * numCommands) };
+			std::cout << std::fixed << std::setprecision(1) << std::setw(10) << numCommands << std::setw(10) << recordMs * toNs
+				<< std::setw(10) << sortMs * toNs << std::setw(12) << stdSortMs * toNs << std::setw(10) << dispatchMs * toNs
+				<< std::setw(10) << (recordMs + sortMs + dispatchMs) * toNs << std::setw(10) << (sorted ? "passed" : "FAILED") << std::endl;
+		}
+	}
+
+	// Times the mip chain and BC1/BC3 encoder on the terrain and a sky texture, checks the PSNR and the DDS round trip.
+	// Compression only happens when a texture is first baked, afterwards the DDS is uploaded as is.
+	void TextureCompression()
+	{
+		const double KMinPSNR{ 30.0 };
+
+		std::cout << "\nTexture compression, level 0 PSNR must be at least " << KMinPSNR << " dB" << std::endl;
+		std::cout << std::left << std::setw(40) << "Image" << std::right << std::setw(8) << "Format" << std::setw(10) << "Mips ms"
+			<< std::setw(10) << "Encode ms" << std::setw(10) << "MPix/s" << std::setw(10) << "Ratio" << std::setw(10) << "PSNR"
+			<< std::setw(10) << "Quality" << std::setw(10) << "DDS" << std::endl;
+
+		const std::string tempPath{ (fs::temp_directory_path() / "benchmark.dds").string() };
+		for (const std::string& filepath : { std::string("Data\\Textures\\grass11.bmp"), std::string("Data\\Models\\Sky\\Mountains\\1.jpg") })
+		{
+			Helpers::ImageLoader source;
+			if (!source.Load(filepath))
+				continue;
+
+			for (Helpers::CompressedFormat format : { Helpers::KFormatBC1, Helpers::KFormatBC3 })
+			{
+				const Clock::time_point mipsStart{ Clock::now() };
+				std::vector<std::vector<BYTE>> mips;
+				Helpers::BuildMipChain(source.GetData(), source.Width(), source.Height(), mips);
+				const double mipsMs{ ElapsedMs(mipsStart, Clock::now()) };
+
+				// Includes building the mip chain again, as baking does
+				const Clock::time_point encodeStart{ Clock::now() };
+				Helpers::CompressedImage image;
+				Helpers::CompressImage(source.GetData(), source.Width(), source.Height(), format, image);
+				const double encodeMs{ ElapsedMs(encodeStart, Clock::now()) };
+
+				size_t numTexels{ (size_t)source.Width() * source.Height() };
+				for (const std::vector<BYTE>& mip : mips)
+					numTexels += mip.size() / 4;
+
+				std::vector<BYTE> decoded;
+				Helpers::DecompressLevel(image.levels[0], format, decoded);
+				const double psnr{ Helpers::ComputePSNR(source.GetData(), decoded.data(), source.Width(), source.Height()) };
+
+				// The file must give back exactly the blocks that went in
+				Helpers::CompressedImage reloaded;
+				bool roundTrip{ Helpers::SaveDDS(tempPath, image) && Helpers::LoadDDS(tempPath, reloaded) &&
+					reloaded.format == image.format && reloaded.levels.size() == image.levels.size() };
+				for (size_t i = 0; roundTrip && i < image.levels.size(); i++)
+					roundTrip = reloaded.levels[i].data == image.levels[i].data;
+
+				const double ratio{ (double)Helpers::MipChainBytes(source.Width(), source.Height(), 1) / image.SizeInBytes() };
+				std::cout << std::left << std::setw(40) << filepath << std::right << std::setw(8) << Helpers::FormatName(format)
+					<< std::fixed << std::setprecision(2) << std::setw(10) << mipsMs << std::setw(10) << encodeMs
+					<< std::setw(10) << numTexels / (encodeMs * 1000.0) << std::setw(10) << ratio << std::setw(10) << psnr
+					<< std::setw(10) << (psnr >= KMinPSNR ? "passed" : "FAILED") << std::setw(10) << (roundTrip ? "passed" : "FAILED") << std::endl;
+			}
+		}
+
+		std::error_code error;
+		fs::remove(tempPath, error);
+	}
+
+	// Loads every DDS file shipped under Data natively and checks its size, format and mip count against what the files hold,
+	// and that level 0 decodes to the same texels as FreeImage. Also times both, FreeImage expands the blocks to RGBA8.
+	void DDSFiles()
+	{
+		struct Expected
+		{
+			std::string filepath;
+			int width;
+			int height;
+			Helpers::CompressedFormat format;
+			size_t numLevels;
+		};
+
+		// Mars was saved without mips so its count is 0, read as a single level
+		const std::vector<Expected> KShipped{
+			{ "Data\\Textures\\dirt_earth-n-moss_df_.dds", 1024, 1024, Helpers::KFormatBC3, 11 },
+			{ "Data\\Textures\\grass_green-01_df_.dds", 1024, 1024, Helpers::KFormatBC3, 11 },
+			{ "Data\\Models\\Sky\\Mars\\Mar_F.dds", 512, 512, Helpers::KFormatBC1, 1 },
+			{ "Data\\Models\\Sky\\Mars\\Mar_B.dds", 512, 512, Helpers::KFormatBC1, 1 },
+			{ "Data\\Models\\Sky\\Mars\\Mar_U.dds", 512, 512, Helpers::KFormatBC1, 1 },
+			{ "Data\\Models\\Sky\\Mars\\Mar_D.dds", 512, 512, Helpers::KFormatBC1, 1 },
+			{ "Data\\Models\\Sky\\Mars\\Mar_R.dds", 512, 512, Helpers::KFormatBC1, 1 },
+			{ "Data\\Models\\Sky\\Mars\\Mar_L.dds", 512, 512, Helpers::KFormatBC1, 1 }
+		};
+
+		// Decoders differ only in rounding the interpolated colours
+		const double KMinPSNR{ 40.0 };
+
+		std::cout << "\nNative DDS loading against FreeImage" << std::endl;
+		std::cout << std::left << std::setw(44) << "File" << std::right << std::setw(12) << "Size" << std::setw(8) << "Format"
+			<< std::setw(8) << "Mips" << std::setw(10) << "KB" << std::setw(10) << "Native ms" << std::setw(14) << "FreeImage ms"
+			<< std::setw(10) << "PSNR" << std::setw(10) << "Result" << std::endl;
+
+		for (const Expected& expected : KShipped)
+		{
+			const Clock::time_point nativeStart{ Clock::now() };
+			Helpers::CompressedImage image;
+			const bool loaded{ Helpers::LoadDDS(expected.filepath, image) };
+			const double nativeMs{ ElapsedMs(nativeStart, Clock::now()) };
+
+			const Clock::time_point freeImageStart{ Clock::now() };
+			Helpers::ImageLoader reference;
+			const bool referenceLoaded{ reference.Load(expected.filepath) };
+			const double freeImageMs{ ElapsedMs(freeImageStart, Clock::now()) };
+
+			bool passed{ loaded && image.Width() == expected.width && image.Height() == expected.height &&
+				image.format == expected.format && image.levels.size() == expected.numLevels };
+
+			// FreeImage gives the bottom row first, the DDS holds the top row first
+			double psnr{ 0 };
+			std::vector<BYTE> decoded;
+			if (passed && referenceLoaded && reference.Width() == image.Width() && reference.Height() == image.Height() &&
+				Helpers::DecompressLevel(image.levels[0], image.format, decoded))
+			{
+				const size_t rowBytes{ (size_t)image.Width() * 4 };
+				std::vector<BYTE> flipped(decoded.size());
+				for (int y = 0; y < image.Height(); y++)
+					memcpy(flipped.data() + (size_t)(image.Height() - 1 - y) * rowBytes, decoded.data() + (size_t)y * rowBytes, rowBytes);
+
+				psnr = Helpers::ComputePSNR(reference.GetData(), flipped.data(), image.Width(), image.Height());
+			}
+			passed = passed && psnr >= KMinPSNR;
+
+			std::cout << std::left << std::setw(44) << expected.filepath << std::right << std::setw(12)
+				<< (std::to_string(image.Width()) + "x" + std::to_string(image.Height())) << std::setw(8) << Helpers::FormatName(image.format)
+				<< std::setw(8) << image.levels.size() << std::setw(10) << image.SizeInBytes() / 1024 << std::fixed << std::setprecision(2)
+				<< std::setw(10) << nativeMs << std::setw(14) << freeImageMs << std::setw(10) << psnr
+				<< std::setw(10) << (passed ? "passed" : "FAILED") << std::endl;
+		}
+	}
+
+	// Memory committed by this process, which is what the image buffers add to
+	static size_t PrivateBytes()
+	{
+		PROCESS_MEMORY_COUNTERS_EX counters{};
+		counters.cb = sizeof(counters);
+		GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&counters, sizeof(counters));
+		return counters.PrivateUsage;
+	}
+
+	// Polls committed memory on another thread until stopped. Windows keeps one peak for the whole process
+	// and it cannot be reset, so each run is measured from its own start.
+	class PeakMemorySampler
+	{
+	private:
+		std::atomic<bool> m_running{ true };
+		size_t m_baseline{ PrivateBytes() };
+		size_t m_peak{ m_baseline };
+		std::thread m_thread;
+	public:
+		PeakMemorySampler() : m_thread([this]()
+			{
+				while (m_running)
+				{
+					m_peak = std::max(m_peak, PrivateBytes());
+					std::this_thread::yield();
+				}
+			})
+		{
+		}
+
+		// Highest point above the start in MB
+		double Stop()
+		{
+			m_running = false;
+			m_thread.join();
+			return (m_peak - m_baseline) / (1024.0 * 1024.0);
+		}
+	};
+
+	// Load time and peak memory for the skybox faces, copying into a new buffer as before, zero copy and into a reused buffer.
+	// Each face is freed before the next is loaded, so the peak is what one image costs.
+	void ImageLoading(const std::string& skyFolder)
+	{
+		std::cout << "\nImage loading, each sky's faces loaded one at a time" << std::endl;
+		std::cout << std::left << std::setw(12) << "Sky" << std::setw(12) << "Method" << std::right << std::setw(8) << "Faces"
+			<< std::setw(12) << "Image MB" << std::setw(10) << "ms" << std::setw(10) << "Peak MB" << std::setw(10) << "Same" << std::endl;
+
+		for (const fs::directory_entry& sky : fs::directory_iterator(skyFolder))
+		{
+			std::vector<std::string> faces;
+			for (const fs::directory_entry& file : fs::directory_iterator(sky.path()))
+			{
+				std::string extension{ file.path().extension().string() };
+				std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)std::tolower((unsigned char)c); });
+				if (extension == ".jpg" || extension == ".png" || extension == ".tga" || extension == ".bmp")
+					faces.push_back(file.path().string());
+			}
+			if (faces.empty())
+				continue;
+
+			// The old Load: decode, convert to 32 bits, then copy into a new buffer
+			std::vector<size_t> checksums;
+			size_t imageBytes{ 0 };
+			PeakMemorySampler copySampler;
+			const Clock::time_point copyStart{ Clock::now() };
+			for (const std::string& face : faces)
+			{
+				FIBITMAP* bitmap{ FreeImage_Load(FreeImage_GetFileType(face.c_str(), 0), face.c_str()) };
+				if (!bitmap)
+					continue;
+
+				FIBITMAP* bitmap32{ FreeImage_GetBPP(bitmap) == 32 ? bitmap : FreeImage_ConvertTo32Bits(bitmap) };
+				const size_t bytes{ (size_t)FreeImage_GetWidth(bitmap) * FreeImage_GetHeight(bitmap) * 4 };
+				BYTE* data{ new BYTE[bytes] };
+				memcpy(data, FreeImage_GetBits(bitmap32), bytes);
+				FreeImage_Unload(bitmap32);
+				if (bitmap32 != bitmap)
+					FreeImage_Unload(bitmap);
+
+				checksums.push_back(std::accumulate(data, data + bytes, (size_t)0));
+				imageBytes += bytes;
+				delete[] data;
+			}
+			const double copyMs{ ElapsedMs(copyStart, Clock::now()) };
+			const double copyPeakMB{ copySampler.Stop() };
+
+			// Load now keeps the decoded bitmap or converts once into its own buffer
+			size_t face{ 0 };
+			bool loadSame{ true };
+			PeakMemorySampler loadSampler;
+			const Clock::time_point loadStart{ Clock::now() };
+			for (const std::string& filepath : faces)
+			{
+				Helpers::ImageLoader image;
+				if (!image.Load(filepath))
+					continue;
+
+				const size_t bytes{ (size_t)image.Width() * image.Height() * 4 };
+				loadSame = loadSame && face < checksums.size() && std::accumulate(image.GetData(), image.GetData() + bytes, (size_t)0) == checksums[face];
+				face++;
+			}
+			const double loadMs{ ElapsedMs(loadStart, Clock::now()) };
+			const double loadPeakMB{ loadSampler.Stop() };
+
+			// LoadInto a buffer kept between faces as a pool would, counted in the peak
+			face = 0;
+			bool intoSame{ true };
+			PeakMemorySampler intoSampler;
+			const Clock::time_point intoStart{ Clock::now() };
+			{
+				std::vector<BYTE> pooled;
+				for (const std::string& filepath : faces)
+				{
+					Helpers::ImageLoader image;
+					const bool loaded{ image.LoadInto(filepath, [&](int width, int height)
+						{
+							pooled.resize((size_t)width * height * 4);
+							return pooled.data();
+						}) };
+					if (!loaded)
+						continue;
+
+					intoSame = intoSame && face < checksums.size() && std::accumulate(pooled.begin(), pooled.end(), (size_t)0) == checksums[face];
+					face++;
+				}
+			}
+			const double intoMs{ ElapsedMs(intoStart, Clock::now()) };
+			const double intoPeakMB{ intoSampler.Stop() };
+
+			const std::string name{ sky.path().filename().string() };
+			const double imageMB{ imageBytes / (1024.0 * 1024.0) };
+			std::cout << std::fixed << std::setprecision(2)
+				<< std::left << std::setw(12) << name << std::setw(12) << "Copy" << std::right << std::setw(8) << faces.size()
+				<< std::setw(12) << imageMB << std::setw(10) << copyMs << std::setw(10) << copyPeakMB << std::setw(10) << "-" << std::endl
+				<< std::left << std::setw(12) << name << std::setw(12) << "Load" << std::right << std::setw(8) << faces.size()
+				<< std::setw(12) << imageMB << std::setw(10) << loadMs << std::setw(10) << loadPeakMB
+				<< std::setw(10) << (loadSame ? "passed" : "FAILED") << std::endl
+				<< std::left << std::setw(12) << name << std::setw(12) << "LoadInto" << std::right << std::setw(8) << faces.size()
+				<< std::setw(12) << imageMB << std::setw(10) << intoMs << std::setw(10) << intoPeakMB
+				<< std::setw(10) << (intoSame ? "passed" : "FAILED") << std::endl;
+		}
+	}
+
+	// Times binning 16, 256 and 4096 lights into clusters, on one thread and across the job system. A camera looks over a
+	// flat ground lit by point and spot lights, every eighth pixel is traced to the ground and the lights its cluster lists
+	// are compared against every light that actually reaches that point, none of which may be missing.
+	void ClusteredLighting()
+	{
+		const glm::ivec2 KViewport{ 1280, 720 };
+		const int KPixelStep{ 8 };
+		const int KRepeats{ 20 };
+
+		const glm::vec3 cameraPosition{ 0.0f, 400.0f, 0.0f };
+		const glm::mat4 view{ glm::lookAt(cameraPosition, glm::vec3(0.0f, 0.0f, -3000.0f), glm::vec3(0.0f, 1.0f, 0.0f)) };
+		const glm::mat4 projection{ glm::perspective(glm::radians(45.0f), KViewport.x / (float)KViewport.y, 1.0f, 40000.0f) };
+		const glm::mat3 viewToWorld{ glm::inverse(glm::mat3(view)) };
+
+		std::cout << "\nClustered lighting, " << Helpers::ClusteredLights::KClustersX << "x" << Helpers::ClusteredLights::KClustersY << "x"
+			<< Helpers::ClusteredLights::KClustersZ << " clusters at " << KViewport.x << "x" << KViewport.y << std::endl;
+		std::cout << std::right << std::setw(8) << "Lights" << std::setw(12) << "1 thread ms" << std::setw(10) << "Jobs ms"
+			<< std::setw(10) << "Indices" << std::setw(12) << "Shaded/px" << std::setw(12) << "Reach/px" << std::setw(10) << "Max/px"
+			<< std::setw(10) << "Result" << std::endl;
+
+		for (size_t numLights : { 16, 256, 4096 })
+		{
+			// Spread over the ground in front of the camera, one in four a spot light shining down
+			std::mt19937 random{ 7 };
+			std::uniform_real_distribution<float> unit{ 0.0f, 1.0f };
+			std::vector<Helpers::Light> lights(numLights);
+			for (size_t i = 0; i < numLights; i++)
+			{
+				Helpers::Light& light{ lights[i] };
+				light.position = glm::vec3((unit(random) - 0.5f) * 12000.0f, 30.0f + unit(random) * 90.0f, -unit(random) * 12000.0f);
+				light.range = 300.0f + unit(random) * 600.0f;
+				if (i % 4 == 0)
+				{
+					light.range *= 1.5f;
+					light.direction = glm::normalize(glm::vec3(unit(random) - 0.5f, -2.0f, unit(random) - 0.5f));
+					light.cosInner = std::cos(glm::radians(25.0f));
+					light.cosOuter = std::cos(glm::radians(35.0f));
+				}
+			}
+
+			Helpers::ClusteredLights clustered;
+			double serialMs{ 0 };
+			double parallelMs{ 0 };
+			for (int repeat = 0; repeat < KRepeats; repeat++)
+			{
+				clustered.Build(lights.data(), lights.size(), view, projection, KViewport, false);
+				serialMs += clustered.BinMs();
+				clustered.Build(lights.data(), lights.size(), view, projection, KViewport, true);
+				parallelMs += clustered.BinMs();
+			}
+
+			const std::vector<Helpers::ClusteredLights::Cluster>& clusters{ clustered.GetClusters() };
+			const std::vector<uint32_t>& indices{ clustered.GetIndices() };
+
+			size_t numPixels{ 0 };
+			size_t numShaded{ 0 };
+			size_t numReaching{ 0 };
+			size_t maxShaded{ 0 };
+			size_t numMissing{ 0 };
+			for (int y = KPixelStep / 2; y < KViewport.y; y += KPixelStep)
+			{
+				for (int x = KPixelStep / 2; x < KViewport.x; x += KPixelStep)
+				{
+					// View space ray with a depth of one, so the distance along it to the ground is the view depth
+					const glm::vec2 pixel{ x + 0.5f, y + 0.5f };
+					const glm::vec2 ndc{ pixel / glm::vec2(KViewport) * 2.0f - 1.0f };
+					const glm::vec3 ray{ viewToWorld * glm::vec3(ndc.x / projection[0][0], ndc.y / projection[1][1], -1.0f) };
+					if (ray.y >= 0.0f)
+						continue;
+
+					const float depth{ -cameraPosition.y / ray.y };
+					if (depth > 40000.0f)
+						continue;
+
+					const glm::vec3 point{ cameraPosition + ray * depth };
+					const Helpers::ClusteredLights::Cluster& cluster{ clusters[clustered.ClusterAt(pixel.x, pixel.y, depth)] };
+					const uint32_t* first{ indices.data() + cluster.offset };
+					const uint32_t* last{ first + cluster.count };
+
+					numPixels++;
+					numShaded += cluster.count;
+					maxShaded = std::max<size_t>(maxShaded, cluster.count);
+
+					// Just inside the range so rounding at a cluster's edge is not counted as a miss
+					for (uint32_t i = 0; i < (uint32_t)lights.size(); i++)
+					{
+						const Helpers::Light& light{ lights[i] };
+						const glm::vec3 toPoint{ point - light.position };
+						if (glm::dot(toPoint, toPoint) >= light.range * light.range * 0.999f)
+							continue;
+						if (light.cosOuter > -1.0f && glm::dot(glm::normalize(toPoint), light.direction) <= light.cosOuter)
+							continue;
+
+						numReaching++;
+						if (!std::binary_search(first, last, i))
+							numMissing++;
+					}
+				}
+			}
+
+			const double pixels{ (double)std::max<size_t>(numPixels, 1) };
+			std::cout << std::fixed << std::setprecision(3) << std::setw(8) << numLights << std::setw(12) << serialMs / KRepeats
+				<< std::setw(10) << parallelMs / KRepeats << std::setw(10) << indices.size() << std::setprecision(2)
+				<< std::setw(12) << numShaded / pixels << std::setw(12) << numReaching / pixels << std::setw(10) << maxShaded
+				<< std::setw(10) << (numMissing == 0 ? "passed" : "FAILED") << std::endl;
+		}
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "ExternalLibraryHeaders.h"
+
+/*
+	Timing runs for the engine systems. These are not part of the normal program flow,
+	define RUN_BENCHMARKS in Simulation.cpp to have them run (and report to the output pane) at start up.
+*/
+
+namespace Benchmarks
+{
+	// Run every benchmark below in turn
+	void RunAll();
+
+	// Compares a cold ASSIMP import against the binary mesh cache for every model under modelsFolder
+	void ModelCache(const std::string& modelsFolder);
+
+	// Checks the packed vertex formats decode back within tolerance and reports the bytes saved for every model
+	void VertexPacking(const std::string& modelsFolder);
+
+	// Flies a scripted camera over the chunked terrain and reports the triangles submitted per frame with and without culling
+	void TerrainCulling();
+
+	// Verifies the stitched LOD element lists and reports triangles per frame as the terrain grows
+	void TerrainLod();
+
+	// Times building terrain vertices from a resampled height source at several grid sizes
+	void TerrainBuild();
+
+	// Samples per second for each noise fractal, scalar, SSE and spread across the job system
+	void NoiseThroughput();
+
+	// Checks and times the terrain grid normals against per triangle accumulation
+	void GridNormals();
+
+	// Times recording, sorting and dispatching the render queue at 10k and 100k commands, and checks the sort order
+	void RenderQueue();
+
+	// Times the mip chain and BC1/BC3 encoder on the terrain and a sky texture, checks the PSNR and the DDS round trip
+	void TextureCompression();
+
+	// Loads every DDS file shipped under Data natively and checks its size, format and mip count, and that it decodes like FreeImage
+	void DDSFiles();
+
+	// Load time and peak memory for the skybox faces, copying into a new buffer as before, zero copy and into a reused buffer
+	void ImageLoading(const std::string& skyFolder);
+
+	// Times binning 16, 256 and 4096 lights into clusters and reports the lights each pixel shades against those that reach it
+	void ClusteredLighting();
+}
@@ -0,0 +1,455 @@
+#include "ClusteredLights.h"
+#include "JobSystem.h"
+#include <xmmintrin.h>
+#include <chrono>
+
+namespace Helpers
+{
+	static_assert(sizeof(ClusteredLights::GpuLight) == 64, "GpuLight must match the std430 Light struct in lights.glsl");
+	static_assert(sizeof(ClusteredLights::GpuClusterHeader) == 32, "GpuClusterHeader must match ClusterBuffer in lights.glsl");
+	static_assert(ClusteredLights::KClustersX % 4 == 0, "Clusters are tested four tiles at a time");
+	static_assert(ClusteredLights::KClustersX * ClusteredLights::KClustersY <= 256, "The cluster in a slice is packed into 8 bits while binning");
+
+	// Point lights have no cone, any direction is inside it
+	static constexpr float KPointLightCos{ -2.0f };
+
+	ClusteredLights::ClusteredLights()
+	{
+		m_lightHeader.ambient = glm::vec4(0.3f, 0.3f, 0.3f, 0.0f);
+		m_lightHeader.sunDirection = glm::vec4(glm::normalize(glm::vec3(0.4f, 1.0f, 0.3f)), 0.0f);
+		m_lightHeader.sunColour = glm::vec4(0.7f, 0.7f, 0.65f, 0.0f);
+	}
+
+	ClusteredLights::~ClusteredLights()
+	{
+		DeleteBuffer();
+	}
+
+	// Light every fragment gets, and a directional light, direction pointing towards it
+	void ClusteredLights::SetAmbient(const glm::vec3& colour)
+	{
+		m_lightHeader.ambient = glm::vec4(colour, 0.0f);
+	}
+
+	void ClusteredLights::SetSun(const glm::vec3& direction, const glm::vec3& colour)
+	{
+		m_lightHeader.sunDirection = glm::vec4(glm::normalize(direction), 0.0f);
+		m_lightHeader.sunColour = glm::vec4(colour, 0.0f);
+	}
+
+	// The view space box of every cluster, only redone when the projection or viewport changes
+	void ClusteredLights::BuildClusterBounds(const glm::mat4& projection, const glm::ivec2& viewportSize)
+	{
+		if (projection == m_projection && viewportSize == m_viewportSize)
+			return;
+
+		m_projection = projection;
+		m_viewportSize = viewportSize;
+		m_nearPlane = projection[3][2] / (projection[2][2] - 1.0f);
+		m_farPlane = projection[3][2] / (projection[2][2] + 1.0f);
+
+		// Slices get deeper the further they are, so each is roughly as deep as it is wide
+		const float logRatio{ std::log(m_farPlane / m_nearPlane) };
+		m_sliceScale = KClustersZ / logRatio;
+		m_sliceBias = -KClustersZ * std::log(m_nearPlane) / logRatio;
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			m_boundsMin[axis].resize(KNumClusters);
+			m_boundsMax[axis].resize(KNumClusters);
+		}
+
+		const float xScale{ 1.0f / projection[0][0] };
+		const float yScale{ 1.0f / projection[1][1] };
+		for (int z = 0; z < KClustersZ; z++)
+		{
+			const float sliceNear{ m_nearPlane * std::pow(m_farPlane / m_nearPlane, (float)z / KClustersZ) };
+			const float sliceFar{ m_nearPlane * std::pow(m_farPlane / m_nearPlane, (float)(z + 1) / KClustersZ) };
+			for (int y = 0; y < KClustersY; y++)
+			{
+				const float ndcMinY{ 2.0f * y / KClustersY - 1.0f };
+				const float ndcMaxY{ 2.0f * (y + 1) / KClustersY - 1.0f };
+				for (int x = 0; x < KClustersX; x++)
+				{
+					const float ndcMinX{ 2.0f * x / KClustersX - 1.0f };
+					const float ndcMaxX{ 2.0f * (x + 1) / KClustersX - 1.0f };
+
+					// The tile's sides spread out with depth so the box has to cover both ends of the slice
+					const size_t cluster{ ((size_t)z * KClustersY + y) * KClustersX + x };
+					m_boundsMin[0][cluster] = std::min(ndcMinX * sliceNear, ndcMinX * sliceFar) * xScale;
+					m_boundsMax[0][cluster] = std::max(ndcMaxX * sliceNear, ndcMaxX * sliceFar) * xScale;
+					m_boundsMin[1][cluster] = std::min(ndcMinY * sliceNear, ndcMinY * sliceFar) * yScale;
+					m_boundsMax[1][cluster] = std::max(ndcMaxY * sliceNear, ndcMaxY * sliceFar) * yScale;
+					m_boundsMin[2][cluster] = -sliceFar;
+					m_boundsMax[2][cluster] = -sliceNear;
+				}
+			}
+		}
+	}
+
+	// View space bounding sphere of the light and the clusters it could touch. Spot cones get the smallest sphere around
+	// them, which for narrow cones is far smaller than the one around the whole range.
+	void ClusteredLights::BoundLight(const Light& light, const glm::mat4& view, LightBounds& bounds) const
+	{
+		glm::vec3 centre{ light.position };
+		float radius{ light.range };
+		if (light.cosOuter > -1.0f)
+		{
+			const float cosAngle{ glm::clamp(light.cosOuter, 0.0f, 1.0f) };
+			if (cosAngle < glm::root_two<float>() * 0.5f)
+			{
+				// Wider than 90 degrees across, the sphere through the rim of the cone's cap
+				centre += light.direction * (light.range * cosAngle);
+				radius = light.range * std::sqrt(1.0f - cosAngle * cosAngle);
+			}
+			else
+			{
+				// The sphere through the apex and the rim
+				radius = light.range / (2.0f * cosAngle);
+				centre += light.direction * radius;
+			}
+		}
+
+		const glm::vec3 viewCentre{ view * glm::vec4(centre, 1.0f) };
+		bounds.sphere = glm::vec4(viewCentre, radius);
+
+		// Empty unless something below finds it in view
+		bounds.first = glm::ivec3(0);
+		bounds.last = glm::ivec3(-1);
+
+		const float depthMin{ -viewCentre.z - radius };
+		const float depthMax{ -viewCentre.z + radius };
+		if (depthMax < m_nearPlane || depthMin > m_farPlane)
+			return;
+
+		const auto slice = [this](float depth)
+		{
+			return glm::clamp((int)std::floor(std::log(depth) * m_sliceScale + m_sliceBias), 0, KClustersZ - 1);
+		};
+		bounds.first.z = slice(std::max(depthMin, m_nearPlane));
+		bounds.last.z = slice(std::min(depthMax, m_farPlane));
+
+		// Crossing the near plane it could cover the whole screen
+		if (depthMin <= m_nearPlane)
+		{
+			bounds.first.x = bounds.first.y = 0;
+			bounds.last.x = KClustersX - 1;
+			bounds.last.y = KClustersY - 1;
+			return;
+		}
+
+		// Project the sphere's view space box. Each edge is furthest out at whichever end of the depth range pushes it out more.
+		const float scales[2]{ m_projection[0][0], m_projection[1][1] };
+		const int tiles[2]{ KClustersX, KClustersY };
+		for (int axis = 0; axis < 2; axis++)
+		{
+			const float low{ viewCentre[axis] - radius };
+			const float high{ viewCentre[axis] + radius };
+			const float ndcLow{ scales[axis] * low / (low <= 0.0f ? depthMin : depthMax) };
+			const float ndcHigh{ scales[axis] * high / (high >= 0.0f ? depthMin : depthMax) };
+			if (ndcHigh < -1.0f || ndcLow > 1.0f)
+			{
+				bounds.last = glm::ivec3(-1);
+				return;
+			}
+
+			bounds.first[axis] = glm::clamp((int)std::floor((ndcLow + 1.0f) * 0.5f * tiles[axis]), 0, tiles[axis] - 1);
+			bounds.last[axis] = glm::clamp((int)std::floor((ndcHigh + 1.0f) * 0.5f * tiles[axis]), 0, tiles[axis] - 1);
+		}
+	}
+
+	// Tests every light reaching the slice against the slice's clusters, four tiles a row at a time, then sorts the hits by
+	// cluster. Lights are visited in order so each cluster's list comes out sorted. Offsets are from the slice's start.
+	void ClusteredLights::BinSlice(int slice)
+	{
+		std::vector<uint32_t>& pairs{ m_slicePairs[slice] };
+		pairs.clear();
+
+		const __m128 zero{ _mm_setzero_ps() };
+		for (uint32_t light = 0; light < (uint32_t)m_lightBounds.size(); light++)
+		{
+			const LightBounds& bounds{ m_lightBounds[light] };
+			if (slice < bounds.first.z || slice > bounds.last.z)
+				continue;
+
+			const __m128 centreX{ _mm_set1_ps(bounds.sphere.x) };
+			const __m128 centreY{ _mm_set1_ps(bounds.sphere.y) };
+			const __m128 centreZ{ _mm_set1_ps(bounds.sphere.z) };
+			const __m128 radiusSq{ _mm_set1_ps(bounds.sphere.w * bounds.sphere.w) };
+
+			const int firstGroup{ bounds.first.x & ~3 };
+			for (int y = bounds.first.y; y <= bounds.last.y; y++)
+			{
+				const size_t row{ ((size_t)slice * KClustersY + y) * KClustersX };
+				for (int x = firstGroup; x <= bounds.last.x; x += 4)
+				{
+					// Distance from the sphere's centre to each box, zero along an axis when inside it
+					const size_t cluster{ row + x };
+					const __m128 dx{ _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&m_boundsMin[0][cluster]), centreX),
+						_mm_sub_ps(centreX, _mm_loadu_ps(&m_boundsMax[0][cluster]))), zero) };
+					const __m128 dy{ _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&m_boundsMin[1][cluster]), centreY),
+						_mm_sub_ps(centreY, _mm_loadu_ps(&m_boundsMax[1][cluster]))), zero) };
+					const __m128 dz{ _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&m_boundsMin[2][cluster]), centreZ),
+						_mm_sub_ps(centreZ, _mm_loadu_ps(&m_boundsMax[2][cluster]))), zero) };
+					const __m128 distanceSq{ _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)) };
+					int hits{ _mm_movemask_ps(_mm_cmple_ps(distanceSq, radiusSq)) };
+
+					// Drop the tiles either side of the projected range
+					for (int lane = 0; lane < 4; lane++)
+					{
+						if (x + lane < bounds.first.x || x + lane > bounds.last.x)
+							hits &= ~(1 << lane);
+					}
+
+					for (int lane = 0; lane < 4; lane++)
+					{
+						if (hits & (1 << lane))
+							pairs.push_back((uint32_t)((y * KClustersX + x + lane) << 24) | light);
+					}
+				}
+			}
+		}
+
+		// Counting sort by cluster, stable so the light order holds
+		uint32_t counts[KClustersX * KClustersY]{};
+		for (uint32_t pair : pairs)
+			counts[pair >> 24]++;
+
+		Cluster* clusters{ m_clusters.data() + (size_t)slice * KClustersX * KClustersY };
+		uint32_t offset{ 0 };
+		for (int i = 0; i < KClustersX * KClustersY; i++)
+		{
+			clusters[i] = { offset, counts[i] };
+			counts[i] = offset;
+			offset += clusters[i].count;
+		}
+
+		std::vector<uint32_t>& indices{ m_sliceIndices[slice] };
+		indices.resize(pairs.size());
+		for (uint32_t pair : pairs)
+			indices[counts[pair >> 24]++] = pair & 0xFFFFFF;
+	}
+
+	// Bins the lights into clusters for a symmetric perspective projection, the near and far planes are taken from it.
+	// With parallel false everything runs on the calling thread, for timing.
+	void ClusteredLights::Build(const Light* lights, size_t numLights, const glm::mat4& view, const glm::mat4& projection,
+		const glm::ivec2& viewportSize, bool parallel)
+	{
+		const std::chrono::high_resolution_clock::time_point start{ std::chrono::high_resolution_clock::now() };
+
+		const auto run = [parallel](size_t count, size_t grainSize, auto&& fn)
+		{
+			if (parallel)
+				JobSystem::Get().ParallelFor(count, grainSize, fn);
+			else
+				fn((size_t)0, count);
+		};
+
+		BuildClusterBounds(projection, viewportSize);
+
+		numLights = std::min(numLights, KMaxLights);
+		m_lightBounds.resize(numLights);
+		m_gpuLights.resize(numLights);
+		run(numLights, 256, [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+				{
+					const Light& light{ lights[i] };
+					BoundLight(light, view, m_lightBounds[i]);
+
+					GpuLight& gpuLight{ m_gpuLights[i] };
+					gpuLight.positionRange = glm::vec4(light.position, light.range);
+					gpuLight.colour = glm::vec4(light.colour * light.intensity, 0.0f);
+					gpuLight.directionCosOuter = glm::vec4(light.direction, light.cosOuter > -1.0f ? light.cosOuter : KPointLightCos);
+					gpuLight.cosInner = glm::vec4(std::max(light.cosInner, light.cosOuter + 0.001f), 0.0f, 0.0f, 0.0f);
+				}
+			});
+
+		m_clusters.resize(KNumClusters);
+		run(KClustersZ, 1, [this](size_t begin, size_t end)
+			{
+				for (size_t slice = begin; slice < end; slice++)
+					BinSlice((int)slice);
+			});
+
+		// Join the slices into one list
+		uint32_t total{ 0 };
+		for (int slice = 0; slice < KClustersZ; slice++)
+		{
+			m_sliceOffsets[slice] = total;
+			total += (uint32_t)m_sliceIndices[slice].size();
+		}
+
+		m_indices.resize(total);
+		run(KClustersZ, 1, [this](size_t begin, size_t end)
+			{
+				for (size_t slice = begin; slice < end; slice++)
+				{
+					const std::vector<uint32_t>& indices{ m_sliceIndices[slice] };
+					if (!indices.empty())
+						memcpy(m_indices.data() + m_sliceOffsets[slice], indices.data(), indices.size() * sizeof(uint32_t));
+
+					Cluster* clusters{ m_clusters.data() + slice * KClustersX * KClustersY };
+					for (int i = 0; i < KClustersX * KClustersY; i++)
+						clusters[i].offset += m_sliceOffsets[slice];
+				}
+			});
+
+		m_binMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	static size_t AlignUp(size_t bytes, size_t alignment)
+	{
+		return (bytes + alignment - 1) / alignment * alignment;
+	}
+
+	// Makes a buffer of KNumParts parts of at least partBytes. Without OpenGL 4.4 it is one part refilled with glBufferSubData.
+	void ClusteredLights::CreateBuffer(size_t partBytes)
+	{
+		DeleteBuffer();
+
+		GLint alignment{ 256 };
+		glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		m_alignment = (size_t)std::max(alignment, 1);
+		m_partBytes = AlignUp(partBytes, m_alignment);
+
+		glGenBuffers(1, &m_buffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffer);
+		if (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage)
+		{
+			// Only written by the CPU, coherent so nothing needs flushing
+			const GLbitfield flags{ GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT };
+			glBufferStorage(GL_SHADER_STORAGE_BUFFER, m_partBytes * KNumParts, nullptr, flags);
+			m_mapped = (BYTE*)glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, m_partBytes * KNumParts, flags);
+		}
+
+		if (!m_mapped)
+		{
+			std::cout << "Light buffers cannot be persistently mapped, updating them with glBufferSubData" << std::endl;
+			glBufferData(GL_SHADER_STORAGE_BUFFER, m_partBytes, nullptr, GL_STREAM_DRAW);
+		}
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		m_part = 0;
+	}
+
+	void ClusteredLights::DeleteBuffer()
+	{
+		for (GLsync& fence : m_fences)
+		{
+			if (fence)
+				glDeleteSync(fence);
+			fence = nullptr;
+		}
+
+		if (!m_buffer)
+			return;
+
+		// GL keeps the storage until draws already queued are done with it
+		if (m_mapped)
+		{
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffer);
+			glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		}
+		glDeleteBuffers(1, &m_buffer);
+		m_buffer = 0;
+		m_mapped = nullptr;
+	}
+
+	// Copies the last Build into the next part of the buffer, grown by half again when it does not fit
+	void ClusteredLights::Upload()
+	{
+		GpuClusterHeader clusterHeader;
+		clusterHeader.scale = glm::vec4(KClustersX / (float)std::max(m_viewportSize.x, 1), KClustersY / (float)std::max(m_viewportSize.y, 1),
+			m_sliceScale, m_sliceBias);
+		clusterHeader.dims = glm::uvec4(KClustersX, KClustersY, KClustersZ, (GLuint)m_gpuLights.size());
+
+		// A range cannot be bound empty so there is always room for one index
+		m_sectionBytes[0] = sizeof(m_lightHeader) + m_gpuLights.size() * sizeof(GpuLight);
+		m_sectionBytes[1] = sizeof(clusterHeader) + m_clusters.size() * sizeof(Cluster);
+		m_sectionBytes[2] = std::max<size_t>(m_indices.size(), 1) * sizeof(uint32_t);
+
+		const auto partBytes = [this]()
+		{
+			return AlignUp(m_sectionBytes[0], m_alignment) + AlignUp(m_sectionBytes[1], m_alignment) + m_sectionBytes[2];
+		};
+
+		if (!m_buffer || partBytes() > m_partBytes)
+		{
+			CreateBuffer(partBytes() + partBytes() / 2);
+		}
+		else if (m_mapped)
+		{
+			m_part = (m_part + 1) % KNumParts;
+
+			// Three frames back, the driver rarely queues that many so this should not block
+			if (GLsync& fence{ m_fences[m_part] })
+			{
+				if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+				{
+					m_numWaits++;
+					glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(1000000000));
+				}
+				glDeleteSync(fence);
+				fence = nullptr;
+			}
+		}
+
+		m_sectionOffsets[0] = m_mapped ? m_partBytes * m_part : 0;
+		m_sectionOffsets[1] = m_sectionOffsets[0] + AlignUp(m_sectionBytes[0], m_alignment);
+		m_sectionOffsets[2] = m_sectionOffsets[1] + AlignUp(m_sectionBytes[1], m_alignment);
+
+		const std::pair<const void*, size_t> pieces[5]
+		{
+			{ &m_lightHeader, sizeof(m_lightHeader) }, { m_gpuLights.data(), m_gpuLights.size() * sizeof(GpuLight) },
+			{ &clusterHeader, sizeof(clusterHeader) }, { m_clusters.data(), m_clusters.size() * sizeof(Cluster) },
+			{ m_indices.data(), m_indices.size() * sizeof(uint32_t) }
+		};
+		const size_t pieceOffsets[5]{ m_sectionOffsets[0], m_sectionOffsets[0] + sizeof(m_lightHeader),
+			m_sectionOffsets[1], m_sectionOffsets[1] + sizeof(clusterHeader), m_sectionOffsets[2] };
+
+		if (m_mapped)
+		{
+			for (int i = 0; i < 5; i++)
+			{
+				if (pieces[i].second > 0)
+					memcpy(m_mapped + pieceOffsets[i], pieces[i].first, pieces[i].second);
+			}
+			return;
+		}
+
+		// Orphaned first so the driver hands back fresh memory rather than waiting on last frame's draws
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, m_partBytes, nullptr, GL_STREAM_DRAW);
+		for (int i = 0; i < 5; i++)
+		{
+			if (pieces[i].second > 0)
+				glBufferSubData(GL_SHADER_STORAGE_BUFFER, pieceOffsets[i], pieces[i].second, pieces[i].first);
+		}
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+
+	// Binds the part Upload wrote to the three binding points, before drawing with a lit program
+	void ClusteredLights::Bind() const
+	{
+		const GLuint bindings[3]{ KLightBinding, KClusterBinding, KIndexBinding };
+		for (int i = 0; i < 3; i++)
+			glBindBufferRange(GL_SHADER_STORAGE_BUFFER, bindings[i], m_buffer, m_sectionOffsets[i], m_sectionBytes[i]);
+	}
+
+	// Call once the frame's draws are issued, GL is reading the part until then
+	void ClusteredLights::EndFrame()
+	{
+		if (m_mapped && !m_fences[m_part])
+			m_fences[m_part] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	// Cluster a fragment at pixel x, y with depth along the view direction would look in, the same sums the shader does
+	int ClusteredLights::ClusterAt(float x, float y, float viewDepth) const
+	{
+		const int tileX{ glm::clamp((int)(x * KClustersX / m_viewportSize.x), 0, KClustersX - 1) };
+		const int tileY{ glm::clamp((int)(y * KClustersY / m_viewportSize.y), 0, KClustersY - 1) };
+		const int slice{ glm::clamp((int)std::floor(std::log(viewDepth) * m_sliceScale + m_sliceBias), 0, KClustersZ - 1) };
+		return (slice * KClustersY + tileY) * KClustersX + tileX;
+	}
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include "ExternalLibraryHeaders.h"
+
+namespace Helpers
+{
+	// A point light, or a spot light if cosOuter is above -1
+	struct Light
+	{
+		glm::vec3 position;
+
+		// Distance the light reaches, it fades to nothing there
+		float range{ 100.0f };
+
+		glm::vec3 colour{ 1.0f };
+		float intensity{ 1.0f };
+
+		// Spot lights only, the way the cone points and the cosines of its half angles. Full strength inside
+		// the inner angle fading to nothing at the outer one.
+		glm::vec3 direction{ 0.0f, -1.0f, 0.0f };
+		float cosInner{ -2.0f };
+		float cosOuter{ -2.0f };
+	};
+
+	// Clustered forward lighting. The view frustum is cut into KClustersX x KClustersY screen tiles and KClustersZ
+	// slices, spaced exponentially in depth, and each light is binned into the clusters its bounds touch. Fragments find
+	// their cluster from their pixel and depth and only shade the lights listed for it. Binning runs on the CPU each
+	// frame, slices are spread across the job system and four clusters are tested against a light at a time with SSE.
+	// The results go to one persistently mapped buffer split in three like FrameUniforms, a fence per part, so the CPU never
+	// writes a part GL may still be reading. Shaders see the lights through Data/Shaders/Include/lights.glsl, which must match
+	// the Gpu structs below.
+	class ClusteredLights
+	{
+	public:
+		static constexpr int KClustersX{ 16 };
+		static constexpr int KClustersY{ 9 };
+		static constexpr int KClustersZ{ 24 };
+		static constexpr int KNumClusters{ KClustersX * KClustersY * KClustersZ };
+
+		// Lights past this are ignored, well inside the 24 bits light indices are packed into while binning
+		static constexpr size_t KMaxLights{ 1 << 16 };
+
+		// Binding points of the buffers, also in lights.glsl
+		static constexpr GLuint KLightBinding{ 2 };
+		static constexpr GLuint KClusterBinding{ 3 };
+		static constexpr GLuint KIndexBinding{ 4 };
+
+		// std430 layouts, every member is 16 byte aligned
+		struct GpuLight
+		{
+			// w is the range
+			glm::vec4 positionRange;
+
+			// Colour times intensity, w unused
+			glm::vec4 colour;
+
+			// w is the cosine of the outer angle, -2 for point lights
+			glm::vec4 directionCosOuter;
+
+			// x is the cosine of the inner angle
+			glm::vec4 cosInner;
+		};
+
+		struct GpuLightHeader
+		{
+			glm::vec4 ambient;
+
+			// Towards the sun, and its colour
+			glm::vec4 sunDirection;
+			glm::vec4 sunColour;
+		};
+
+		struct GpuClusterHeader
+		{
+			// x and y take pixels to tiles, z and w are the scale and bias taking log view depth to a slice
+			glm::vec4 scale;
+
+			// Tiles across and down, slices, and the number of lights
+			glm::uvec4 dims;
+		};
+
+		// Offset into the index list and the number of lights there
+		struct Cluster
+		{
+			uint32_t offset;
+			uint32_t count;
+		};
+	private:
+		// View space box of every cluster as separate arrays so four neighbouring tiles load into one register
+		std::vector<float> m_boundsMin[3];
+		std::vector<float> m_boundsMax[3];
+
+		// Projection the boxes were built for
+		glm::mat4 m_projection{ 0.0f };
+		float m_nearPlane{ 1.0f };
+		float m_farPlane{ 1000.0f };
+		float m_sliceScale{ 0.0f };
+		float m_sliceBias{ 0.0f };
+		glm::ivec2 m_viewportSize{ 0 };
+
+		// Each light's view space bounding sphere and the range of clusters it may touch, empty if off screen
+		struct LightBounds
+		{
+			glm::vec4 sphere;
+			glm::ivec3 first;
+			glm::ivec3 last;
+		};
+		std::vector<LightBounds> m_lightBounds;
+
+		// Built a slice at a time, the slices are then joined into m_indices
+		std::vector<uint32_t> m_slicePairs[KClustersZ];
+		std::vector<uint32_t> m_sliceIndices[KClustersZ];
+		uint32_t m_sliceOffsets[KClustersZ]{};
+
+		std::vector<GpuLight> m_gpuLights;
+		GpuLightHeader m_lightHeader{};
+		std::vector<Cluster> m_clusters;
+		std::vector<uint32_t> m_indices;
+
+		// Each part holds the lights, the clusters and the indices, each section aligned for glBindBufferRange
+		static constexpr int KNumParts{ 3 };
+		GLuint m_buffer{ 0 };
+		BYTE* m_mapped{ nullptr };
+		size_t m_partBytes{ 0 };
+		size_t m_alignment{ 256 };
+		GLsync m_fences[KNumParts]{};
+		int m_part{ 0 };
+		size_t m_sectionOffsets[3]{};
+		size_t m_sectionBytes[3]{};
+		size_t m_numWaits{ 0 };
+
+		double m_binMs{ 0 };
+
+		void BuildClusterBounds(const glm::mat4& projection, const glm::ivec2& viewportSize);
+		void BoundLight(const Light& light, const glm::mat4& view, LightBounds& bounds) const;
+		void BinSlice(int slice);
+		void CreateBuffer(size_t partBytes);
+		void DeleteBuffer();
+	public:
+		ClusteredLights();
+		~ClusteredLights();
+
+		ClusteredLights(const ClusteredLights&) = delete;
+		ClusteredLights& operator=(const ClusteredLights&) = delete;
+
+		// Light every fragment gets, and a directional light, direction pointing towards it
+		void SetAmbient(const glm::vec3& colour);
+		void SetSun(const glm::vec3& direction, const glm::vec3& colour);
+
+		// Bins the lights into clusters for a symmetric perspective projection, the near and far planes are taken from it.
+		// With parallel false everything runs on the calling thread, for timing.
+		void Build(const Light* lights, size_t numLights, const glm::mat4& view, const glm::mat4& projection,
+			const glm::ivec2& viewportSize, bool parallel = true);
+
+		// Copies the last Build into the next part of the buffer, grown by half again when it does not fit
+		void Upload();
+
+		// Binds the part Upload wrote to the three binding points, before drawing with a lit program
+		void Bind() const;
+
+		// Call once the frame's draws are issued, GL is reading the part until then
+		void EndFrame();
+
+		// Cluster a fragment at pixel x, y with depth along the view direction would look in, the same sums the shader does
+		int ClusterAt(float x, float y, float viewDepth) const;
+
+		const std::vector<Cluster>& GetClusters() const { return m_clusters; }
+		const std::vector<uint32_t>& GetIndices() const { return m_indices; }
+
+		// Milliseconds the last Build took
+		double BinMs() const { return m_binMs; }
+
+		// Times Upload had to wait for GL to finish with a part, should stay at 0 with three of them
+		size_t NumWaits() const { return m_numWaits; }
+	};
+}
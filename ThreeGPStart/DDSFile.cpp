@@ -0,0 +1,311 @@
+#include "DDSFile.h"
+#include <fstream>
+#include <filesystem>
+namespace fs = std::filesystem;
+
+namespace Helpers
+{
+	// File layout from the DirectX documentation, all little endian
+	static constexpr uint32_t KDDSMagic{ 0x20534444 };	// "DDS "
+
+	static constexpr uint32_t KDDSDCaps{ 0x1 };
+	static constexpr uint32_t KDDSDHeight{ 0x2 };
+	static constexpr uint32_t KDDSDWidth{ 0x4 };
+	static constexpr uint32_t KDDSDPixelFormat{ 0x1000 };
+	static constexpr uint32_t KDDSDMipMapCount{ 0x20000 };
+	static constexpr uint32_t KDDSDLinearSize{ 0x80000 };
+	static constexpr uint32_t KDDSDDepth{ 0x800000 };
+
+	static constexpr uint32_t KDDPFFourCC{ 0x4 };
+
+	static constexpr uint32_t KDDSCapsComplex{ 0x8 };
+	static constexpr uint32_t KDDSCapsTexture{ 0x1000 };
+	static constexpr uint32_t KDDSCapsMipMap{ 0x400000 };
+
+	static constexpr uint32_t KDDSCaps2CubeMap{ 0x200 };
+	static constexpr uint32_t KDDSCaps2Volume{ 0x200000 };
+
+	static constexpr uint32_t KD3D10ResourceDimensionTexture2D{ 3 };
+	static constexpr uint32_t KD3D10ResourceMiscTextureCube{ 0x4 };
+
+	// Larger than any texture GL will take, stops a damaged header asking for gigabytes
+	static constexpr uint32_t KMaxDimension{ 16384 };
+
+	static constexpr uint32_t MakeFourCC(char a, char b, char c, char d)
+	{
+		return (uint32_t)a | ((uint32_t)b << 8) | ((uint32_t)c << 16) | ((uint32_t)d << 24);
+	}
+
+	static constexpr uint32_t KFourCCDXT1{ MakeFourCC('D', 'X', 'T', '1') };
+	static constexpr uint32_t KFourCCDXT3{ MakeFourCC('D', 'X', 'T', '3') };
+	static constexpr uint32_t KFourCCDXT5{ MakeFourCC('D', 'X', 'T', '5') };
+	static constexpr uint32_t KFourCCATI1{ MakeFourCC('A', 'T', 'I', '1') };
+	static constexpr uint32_t KFourCCBC4U{ MakeFourCC('B', 'C', '4', 'U') };
+	static constexpr uint32_t KFourCCATI2{ MakeFourCC('A', 'T', 'I', '2') };
+	static constexpr uint32_t KFourCCBC5U{ MakeFourCC('B', 'C', '5', 'U') };
+	static constexpr uint32_t KFourCCDX10{ MakeFourCC('D', 'X', '1', '0') };
+
+	// The DXGI_FORMAT values for the block compressed formats, the sRGB ones load as linear
+	enum DXGIFormat : uint32_t
+	{
+		KDXGIBC1Unorm = 71,
+		KDXGIBC1UnormSRGB = 72,
+		KDXGIBC2Unorm = 74,
+		KDXGIBC2UnormSRGB = 75,
+		KDXGIBC3Unorm = 77,
+		KDXGIBC3UnormSRGB = 78,
+		KDXGIBC4Unorm = 80,
+		KDXGIBC5Unorm = 83,
+		KDXGIBC7Unorm = 98,
+		KDXGIBC7UnormSRGB = 99
+	};
+
+	struct DDSPixelFormat
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t fourCC;
+		uint32_t rgbBitCount;
+		uint32_t redMask;
+		uint32_t greenMask;
+		uint32_t blueMask;
+		uint32_t alphaMask;
+	};
+
+	struct DDSHeader
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t height;
+		uint32_t width;
+		uint32_t pitchOrLinearSize;
+		uint32_t depth;
+		uint32_t mipMapCount;
+		uint32_t reserved1[11];
+		DDSPixelFormat pixelFormat;
+		uint32_t caps;
+		uint32_t caps2;
+		uint32_t caps3;
+		uint32_t caps4;
+		uint32_t reserved2;
+	};
+
+	// Follows the header when the FourCC is DX10
+	struct DDSHeaderDX10
+	{
+		uint32_t dxgiFormat;
+		uint32_t resourceDimension;
+		uint32_t miscFlag;
+		uint32_t arraySize;
+		uint32_t miscFlags2;
+	};
+
+	static_assert(sizeof(DDSHeader) == 124, "DDS header must match the file layout");
+	static_assert(sizeof(DDSHeaderDX10) == 20, "DDS DX10 header must match the file layout");
+
+	static bool FormatFromFourCC(uint32_t fourCC, CompressedFormat& format)
+	{
+		switch (fourCC)
+		{
+		case KFourCCDXT1:
+			format = KFormatBC1;
+			return true;
+		case KFourCCDXT3:
+			format = KFormatBC2;
+			return true;
+		case KFourCCDXT5:
+			format = KFormatBC3;
+			return true;
+		case KFourCCATI1:
+		case KFourCCBC4U:
+			format = KFormatBC4;
+			return true;
+		case KFourCCATI2:
+		case KFourCCBC5U:
+			format = KFormatBC5;
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	static bool FormatFromDXGI(uint32_t dxgiFormat, CompressedFormat& format)
+	{
+		switch (dxgiFormat)
+		{
+		case KDXGIBC1Unorm:
+		case KDXGIBC1UnormSRGB:
+			format = KFormatBC1;
+			return true;
+		case KDXGIBC2Unorm:
+		case KDXGIBC2UnormSRGB:
+			format = KFormatBC2;
+			return true;
+		case KDXGIBC3Unorm:
+		case KDXGIBC3UnormSRGB:
+			format = KFormatBC3;
+			return true;
+		case KDXGIBC4Unorm:
+			format = KFormatBC4;
+			return true;
+		case KDXGIBC5Unorm:
+			format = KFormatBC5;
+			return true;
+		case KDXGIBC7Unorm:
+		case KDXGIBC7UnormSRGB:
+			format = KFormatBC7;
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	// True if the file extension is .dds in any case
+	bool IsDDSFile(const std::string& filepath)
+	{
+		std::string extension{ fs::path(filepath).extension().string() };
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)std::tolower((unsigned char)c); });
+		return extension == ".dds";
+	}
+
+	// Writes a block compressed image and its mip chain as a DDS file. BC7 needs the DX10 header, the rest use a FourCC.
+	// Returns false on error.
+	bool SaveDDS(const std::string& filepath, const CompressedImage& image)
+	{
+		if (image.levels.empty() || image.format >= KNumCompressedFormats)
+			return false;
+
+		std::ofstream file(filepath, std::ios::binary);
+		if (!file)
+			return false;
+
+		static const uint32_t KFourCCs[KNumCompressedFormats]{ KFourCCDXT1, KFourCCDXT3, KFourCCDXT5, KFourCCATI1, KFourCCATI2, KFourCCDX10 };
+
+		DDSHeader header{};
+		header.size = sizeof(DDSHeader);
+		header.flags = KDDSDCaps | KDDSDHeight | KDDSDWidth | KDDSDPixelFormat | KDDSDMipMapCount | KDDSDLinearSize;
+		header.height = image.Height();
+		header.width = image.Width();
+		header.pitchOrLinearSize = (uint32_t)image.levels[0].data.size();
+		header.mipMapCount = (uint32_t)image.levels.size();
+		header.pixelFormat.size = sizeof(DDSPixelFormat);
+		header.pixelFormat.flags = KDDPFFourCC;
+		header.pixelFormat.fourCC = KFourCCs[image.format];
+		header.caps = KDDSCapsTexture | (image.levels.size() > 1 ? KDDSCapsComplex | KDDSCapsMipMap : 0);
+
+		file.write((const char*)&KDDSMagic, sizeof(KDDSMagic));
+		file.write((const char*)&header, sizeof(header));
+		if (header.pixelFormat.fourCC == KFourCCDX10)
+		{
+			DDSHeaderDX10 headerDX10{};
+			headerDX10.dxgiFormat = KDXGIBC7Unorm;
+			headerDX10.resourceDimension = KD3D10ResourceDimensionTexture2D;
+			headerDX10.arraySize = 1;
+			file.write((const char*)&headerDX10, sizeof(headerDX10));
+		}
+
+		for (const CompressedLevel& level : image.levels)
+			file.write((const char*)level.data.data(), level.data.size());
+
+		return (bool)file;
+	}
+
+	// Reads a block compressed 2D DDS file, legacy or DX10 header, keeping the blocks compressed.
+	// Returns false if the file is missing, damaged or not one of the CompressedFormats.
+	bool LoadDDS(const std::string& filepath, CompressedImage& image)
+	{
+		std::ifstream file(filepath, std::ios::binary | std::ios::ate);
+		if (!file)
+		{
+			std::cout << "File does not exist: " << filepath << std::endl;
+			return false;
+		}
+
+		const uint64_t fileBytes{ (uint64_t)file.tellg() };
+		file.seekg(0);
+
+		uint32_t magic{ 0 };
+		DDSHeader header{};
+		file.read((char*)&magic, sizeof(magic));
+		file.read((char*)&header, sizeof(header));
+		if (!file || magic != KDDSMagic || header.size != sizeof(DDSHeader) || header.pixelFormat.size != sizeof(DDSPixelFormat))
+		{
+			std::cout << "Not a DDS file: " << filepath << std::endl;
+			return false;
+		}
+
+		if (header.width == 0 || header.height == 0 || header.width > KMaxDimension || header.height > KMaxDimension)
+		{
+			std::cout << "DDS file has an invalid size: " << filepath << std::endl;
+			return false;
+		}
+
+		// Cube maps, arrays and volumes need a different GL target
+		bool isTexture2D{ !(header.caps2 & (KDDSCaps2CubeMap | KDDSCaps2Volume)) && !((header.flags & KDDSDDepth) && header.depth > 1) };
+
+		CompressedFormat format{ KFormatBC1 };
+		bool knownFormat{ false };
+		if (header.pixelFormat.flags & KDDPFFourCC)
+		{
+			if (header.pixelFormat.fourCC == KFourCCDX10)
+			{
+				DDSHeaderDX10 headerDX10{};
+				file.read((char*)&headerDX10, sizeof(headerDX10));
+				knownFormat = file && FormatFromDXGI(headerDX10.dxgiFormat, format);
+				isTexture2D = isTexture2D && headerDX10.resourceDimension == KD3D10ResourceDimensionTexture2D &&
+					headerDX10.arraySize <= 1 && !(headerDX10.miscFlag & KD3D10ResourceMiscTextureCube);
+			}
+			else
+			{
+				knownFormat = FormatFromFourCC(header.pixelFormat.fourCC, format);
+			}
+		}
+
+		if (!knownFormat)
+		{
+			std::cout << "DDS file is not in a supported block compressed format: " << filepath << std::endl;
+			return false;
+		}
+
+		if (!isTexture2D)
+		{
+			std::cout << "DDS file is not a single 2D texture: " << filepath << std::endl;
+			return false;
+		}
+
+		// Files without mips may leave the count at 0, and no chain goes below 1x1
+		uint32_t maxLevels{ 1 };
+		while ((std::max(header.width, header.height) >> maxLevels) > 0)
+			maxLevels++;
+
+		const uint32_t numLevels{ std::min(std::max(header.mipMapCount, 1u), maxLevels) };
+
+		// Check the levels fit in the file before allocating them
+		uint64_t dataBytes{ 0 };
+		for (uint32_t i = 0; i < numLevels; i++)
+			dataBytes += CompressedLevelBytes(format, std::max((int)header.width >> i, 1), std::max((int)header.height >> i, 1));
+
+		if ((uint64_t)file.tellg() + dataBytes > fileBytes)
+		{
+			std::cout << "DDS file is shorter than its header says: " << filepath << std::endl;
+			return false;
+		}
+
+		image.format = format;
+		image.levels.resize(numLevels);
+		int width{ (int)header.width };
+		int height{ (int)header.height };
+		for (CompressedLevel& level : image.levels)
+		{
+			level.width = width;
+			level.height = height;
+			level.data.resize(CompressedLevelBytes(format, width, height));
+			file.read((char*)level.data.data(), level.data.size());
+
+			width = std::max(width / 2, 1);
+			height = std::max(height / 2, 1);
+		}
+
+		return (bool)file;
+	}
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "ExternalLibraryHeaders.h"
+#include "TextureCompression.h"
+
+namespace Helpers
+{
+	// True if the file extension is .dds in any case
+	bool IsDDSFile(const std::string& filepath);
+
+	// Writes a block compressed image and its mip chain as a DDS file. BC7 needs the DX10 header, the rest use a FourCC.
+	// Returns false on error.
+	bool SaveDDS(const std::string& filepath, const CompressedImage& image);
+
+	// Reads a block compressed 2D DDS file, legacy or DX10 header, keeping the blocks compressed.
+	// Rows stay in file order, top first, the opposite way up to ImageLoader which gives the bottom row first.
+	// Returns false if the file is missing, damaged or not one of the CompressedFormats.
+	bool LoadDDS(const std::string& filepath, CompressedImage& image);
+}
@@ -0,0 +1,19 @@
+// Written once a frame for every program by FrameUniforms, the layout and binding must match FrameUniforms::FrameData
+layout (std140, binding = 0) uniform FrameData
+{
+	mat4 view_xform;
+	mat4 projection_xform;
+
+	// Projection times view
+	mat4 combined_xform;
+
+	// Without the view's translation, for the sky, and its inverse
+	mat4 sky_xform;
+	mat4 inverse_sky_xform;
+
+	vec4 camera_position;
+
+	// Seconds since the first frame, and since the last
+	float time;
+	float delta_time;
+};
@@ -0,0 +1,104 @@
+// Lights binned into screen space clusters by ClusteredLights, the layouts and bindings must match ClusteredLights.h.
+// A fragment finds its cluster from its pixel and view depth and shades only the lights listed there.
+#include "camera.glsl"
+#include "materials.glsl"
+
+struct Light
+{
+	// World space, w is the range
+	vec4 position_range;
+
+	// Colour times intensity
+	vec4 colour;
+
+	// Spot lights only, w is the cosine of the outer angle, below -1 for point lights
+	vec4 direction_cos_outer;
+
+	// x is the cosine of the inner angle
+	vec4 cos_inner;
+};
+
+layout (std430, binding = 2) readonly buffer LightBuffer
+{
+	vec4 ambient_light;
+
+	// Towards the sun, and its colour
+	vec4 sun_direction;
+	vec4 sun_colour;
+
+	Light lights[];
+};
+
+layout (std430, binding = 3) readonly buffer ClusterBuffer
+{
+	// x and y take pixels to tiles, z and w are the scale and bias taking log view depth to a slice
+	vec4 cluster_scale;
+
+	// Tiles across and down, slices, and the number of lights
+	uvec4 cluster_dims;
+
+	// Offset into light_indices and the number of lights there
+	uvec2 clusters[];
+};
+
+layout (std430, binding = 4) readonly buffer LightIndexBuffer
+{
+	uint light_indices[];
+};
+
+// Same sums as ClusteredLights::ClusterAt
+uint ClusterIndex(vec2 pixel, float view_depth)
+{
+	uvec2 tile = min(uvec2(pixel * cluster_scale.xy), cluster_dims.xy - 1u);
+	uint slice = uint(clamp(floor(log(view_depth) * cluster_scale.z + cluster_scale.w), 0.0, float(cluster_dims.z - 1u)));
+	return (slice * cluster_dims.y + tile.y) * cluster_dims.x + tile.x;
+}
+
+// Diffuse and Blinn-Phong specular from one light, before its colour and falloff
+vec3 ShadeLight(vec3 N, vec3 V, vec3 L, vec3 diffuse, Material material)
+{
+	float NdotL = max(dot(N, L), 0.0);
+	vec3 H = normalize(L + V);
+	float specular = NdotL > 0.0 ? pow(max(dot(N, H), 0.0), max(material.specular_colour.a, 1.0)) : 0.0;
+	return diffuse * NdotL + material.specular_colour.rgb * specular;
+}
+
+// Ambient, the sun and every light in the fragment's cluster, with the material's colours each times the texel.
+// Also gives the number of lights looked at.
+vec3 ShadeClustered(vec3 position, vec3 normal, vec3 texel, Material material, out uint num_lights)
+{
+	vec3 N = normalize(normal);
+	vec3 V = normalize(camera_position.xyz - position);
+	vec3 diffuse = texel * material.diffuse_colour.rgb;
+
+	vec3 colour = texel * (material.ambient_colour.rgb * ambient_light.rgb + material.emissive_colour.rgb);
+	colour += ShadeLight(N, V, sun_direction.xyz, diffuse, material) * sun_colour.rgb;
+
+	float view_depth = -(view_xform * vec4(position, 1.0)).z;
+	uvec2 cluster = clusters[ClusterIndex(gl_FragCoord.xy, view_depth)];
+	num_lights = cluster.y;
+
+	for (uint i = 0u; i < cluster.y; i++)
+	{
+		Light light = lights[light_indices[cluster.x + i]];
+
+		vec3 to_light = light.position_range.xyz - position;
+		float distance_sq = dot(to_light, to_light);
+		float range = light.position_range.w;
+		if (distance_sq >= range * range)
+			continue;
+
+		vec3 L = to_light * inversesqrt(distance_sq);
+
+		// Inverse square, half strength 100 units out, windowed so it reaches zero at the range the light was binned with
+		float window = clamp(1.0 - pow(distance_sq / (range * range), 2.0), 0.0, 1.0);
+		float falloff = window * window / (distance_sq * 0.0001 + 1.0);
+
+		if (light.direction_cos_outer.w >= -1.0)
+			falloff *= smoothstep(light.direction_cos_outer.w, light.cos_inner.x, dot(-L, light.direction_cos_outer.xyz));
+
+		colour += ShadeLight(N, V, L, diffuse, material) * light.colour.rgb * falloff;
+	}
+
+	return colour;
+}
@@ -0,0 +1,15 @@
+// Every material, written at load time by MaterialTable. The layout and binding must match MaterialTable::GpuMaterial.
+struct Material
+{
+	vec4 diffuse_colour;
+	vec4 ambient_colour;
+	vec4 emissive_colour;
+
+	// rgb is the colour, a the specular factor
+	vec4 specular_colour;
+};
+
+layout (std430, binding = 1) readonly buffer MaterialBuffer
+{
+	Material materials[];
+};
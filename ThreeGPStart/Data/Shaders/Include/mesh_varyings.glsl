@@ -0,0 +1,19 @@
+// Passed from mesh_shader.vert to mesh_shader.frag, so both sides always agree
+#ifdef VERTEX_SHADER
+#define VARYING out
+#else
+#define VARYING in
+#endif
+
+#ifdef VERTEX_COLOUR
+VARYING vec3 varying_colour;
+#else
+VARYING vec2 varying_coord;
+VARYING vec3 varying_normal;
+VARYING vec3 varying_position;
+
+// Entry in the material table, 0 is plain white
+flat VARYING uint varying_material;
+#endif
+
+#undef VARYING
@@ -0,0 +1,43 @@
+#version 460
+
+// Same permutations as mesh_shader.vert
+
+#include "Include/mesh_varyings.glsl"
+
+#ifndef VERTEX_COLOUR
+#include "Include/materials.glsl"
+
+uniform sampler2D sampler_tex;
+
+#ifdef LIT
+#include "Include/lights.glsl"
+
+// Non zero to show the number of lights shaded rather than the colour
+uniform int show_light_count;
+#endif
+#endif
+
+out vec4 fragment_colour;
+
+void main(void)
+{
+#ifdef VERTEX_COLOUR
+	fragment_colour = vec4(varying_colour, 1.0);
+#else
+	vec3 tex_colour = texture(sampler_tex, varying_coord).rgb;
+	Material material = materials[varying_material];
+#ifdef LIT
+	uint num_lights;
+	vec3 colour = ShadeClustered(varying_position, varying_normal, tex_colour, material, num_lights);
+
+	// Blue through green to red at 32 lights
+	if (show_light_count != 0)
+		colour = num_lights == 0u ? vec3(0.0) : mix(vec3(0.0, 0.0, 1.0), vec3(1.0, 0.0, 0.0), min(float(num_lights) / 32.0, 1.0)) +
+			vec3(0.0, 1.0 - abs(min(float(num_lights) / 16.0, 2.0) - 1.0), 0.0);
+
+	fragment_colour = vec4(colour, 1.0);
+#else
+	fragment_colour = vec4(tex_colour * material.diffuse_colour.rgb + material.emissive_colour.rgb, 1.0);
+#endif
+#endif
+}
@@ -0,0 +1,65 @@
+#version 460
+
+// Permutations, each is built as its own program by the preprocessor
+//	INSTANCED		the model transform and material are per instance attributes rather than the model_xform uniform
+//	ARENA			the model transform and material come from StaticMeshArena's draw data, found through gl_BaseInstance
+// Otherwise RenderQueue passes the material as the base instance of a single instance draw.
+//	VERTEX_COLOUR	a colour per vertex instead of a normal and texture coordinate
+//	LIT				shaded by the sun and the clustered lights, see Include/lights.glsl, ignored with VERTEX_COLOUR
+
+#include "Include/camera.glsl"
+#include "Include/mesh_varyings.glsl"
+
+layout (location=0) in vec3 vertex_position;
+
+#ifdef VERTEX_COLOUR
+layout (location=1) in vec3 vertex_colour;
+#else
+layout (location=1) in vec3 vertex_normal;
+layout (location=2) in vec2 vertex_texcoord;
+#endif
+
+#ifdef INSTANCED
+// Takes locations 3 to 6
+layout (location=3) in mat4 instance_xform;
+layout (location=7) in uint instance_material;
+#elif defined(ARENA)
+// One entry per draw of a multi draw, must match StaticMeshArena::DrawData
+struct DrawData
+{
+	mat4 model_xform;
+	uint material;
+};
+
+layout (std430, binding = 0) readonly buffer DrawBuffer
+{
+	DrawData draws[];
+};
+#else
+uniform mat4 model_xform;
+#endif
+
+void main(void)
+{
+#ifdef INSTANCED
+	mat4 world_xform = instance_xform;
+	uint material = instance_material;
+#elif defined(ARENA)
+	mat4 world_xform = draws[gl_BaseInstance].model_xform;
+	uint material = draws[gl_BaseInstance].material;
+#else
+	mat4 world_xform = model_xform;
+	uint material = uint(gl_BaseInstance);
+#endif
+
+#ifdef VERTEX_COLOUR
+	varying_colour = vertex_colour;
+#else
+	varying_normal = mat3(world_xform) * vertex_normal;
+	varying_coord = vertex_texcoord;
+	varying_material = material;
+	varying_position = mat4x3(world_xform) * vec4(vertex_position, 1.0f);
+#endif
+
+	gl_Position = combined_xform * world_xform * vec4(vertex_position, 1.0);
+}
@@ -0,0 +1,14 @@
+#version 420
+
+uniform samplerCube sampler_sky;
+
+in vec3 varying_direction;
+
+out vec4 fragment_colour;
+
+void main(void)
+{
+	// z is flipped to match the faces to the sky meshes they came with, which the model importer mirrored
+	vec3 direction = vec3(varying_direction.xy, -varying_direction.z);
+	fragment_colour = vec4(texture(sampler_sky, direction).rgb, 1.0);
+}
@@ -0,0 +1,18 @@
+#version 420
+
+#include "Include/camera.glsl"
+
+out vec3 varying_direction;
+
+void main(void)
+{
+	// One triangle covering the screen, corners (-1,-1) (3,-1) (-1,3) from the vertex index
+	vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2) * 2.0 - 1.0;
+
+	// The inverse of the projection and view rotation takes a point on the far plane back to a world direction
+	vec4 direction = inverse_sky_xform * vec4(position, 1.0, 1.0);
+	varying_direction = direction.xyz / direction.w;
+
+	// On the far plane, behind everything already drawn
+	gl_Position = vec4(position, 1.0, 1.0);
+}
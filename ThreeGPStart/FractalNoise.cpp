@@ -0,0 +1,275 @@
+#include "FractalNoise.h"
+#include "JobSystem.h"
+#include <smmintrin.h>
+
+namespace Helpers
+{
+	// Brings single octave gradient noise into roughly -1 to 1
+	static constexpr float KGradientScale{ 0.66f };
+
+	// Seed offsets for the two lookups that warp the input of KNoiseWarped
+	static constexpr unsigned int KWarpSeedX{ 101 };
+	static constexpr unsigned int KWarpSeedY{ 211 };
+
+	// Scalar versions, these are the reference for the SSE versions below and must do the same sums in the same order
+
+	static unsigned int Hash(int x, int y, unsigned int seed)
+	{
+		unsigned int h{ ((unsigned int)x * 73856093u) ^ ((unsigned int)y * 19349663u) ^ seed };
+		h ^= h >> 13;
+		h *= 0x5bd1e995u;
+		h ^= h >> 15;
+		return h;
+	}
+
+	// Dot product with one of eight gradients picked by the low bits of the hash
+	static float Gradient(unsigned int hash, float x, float y)
+	{
+		const float u{ (hash & 4) ? y : x };
+		const float v{ (hash & 4) ? x : y };
+		return ((hash & 1) ? -u : u) + ((hash & 2) ? -2.0f * v : 2.0f * v);
+	}
+
+	static float GradientNoise(float x, float y, unsigned int seed)
+	{
+		const float floorX{ std::floor(x) };
+		const float floorY{ std::floor(y) };
+		const int ix{ (int)floorX };
+		const int iy{ (int)floorY };
+		const float fx{ x - floorX };
+		const float fy{ y - floorY };
+
+		// Quintic fade so the second derivative is continuous between cells
+		const float u{ fx * fx * fx * (fx * (fx * 6.0f - 15.0f) + 10.0f) };
+		const float v{ fy * fy * fy * (fy * (fy * 6.0f - 15.0f) + 10.0f) };
+
+		const float n00{ Gradient(Hash(ix, iy, seed), fx, fy) };
+		const float n10{ Gradient(Hash(ix + 1, iy, seed), fx - 1.0f, fy) };
+		const float n01{ Gradient(Hash(ix, iy + 1, seed), fx, fy - 1.0f) };
+		const float n11{ Gradient(Hash(ix + 1, iy + 1, seed), fx - 1.0f, fy - 1.0f) };
+
+		const float lower{ n00 + (n10 - n00) * u };
+		const float upper{ n01 + (n11 - n01) * u };
+		return (lower + (upper - lower) * v) * KGradientScale;
+	}
+
+	// SSE versions, four samples in each register. Needs SSE4.1 for the floor and 32 bit multiply.
+
+	static __m128i Hash4(__m128i x, __m128i y, __m128i seed)
+	{
+		__m128i h{ _mm_xor_si128(_mm_xor_si128(_mm_mullo_epi32(x, _mm_set1_epi32(73856093)),
+			_mm_mullo_epi32(y, _mm_set1_epi32(19349663))), seed) };
+		h = _mm_xor_si128(h, _mm_srli_epi32(h, 13));
+		h = _mm_mullo_epi32(h, _mm_set1_epi32(0x5bd1e995));
+		h = _mm_xor_si128(h, _mm_srli_epi32(h, 15));
+		return h;
+	}
+
+	static __m128 Gradient4(__m128i hash, __m128 x, __m128 y)
+	{
+		const __m128i zero{ _mm_setzero_si128() };
+		const __m128 swap{ _mm_castsi128_ps(_mm_cmpgt_epi32(_mm_and_si128(hash, _mm_set1_epi32(4)), zero)) };
+		const __m128 u{ _mm_blendv_ps(x, y, swap) };
+		const __m128 v{ _mm_blendv_ps(y, x, swap) };
+
+		// Negate by flipping the sign bit where the hash bit is set
+		const __m128 signBit{ _mm_set1_ps(-0.0f) };
+		const __m128 flipU{ _mm_and_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(_mm_and_si128(hash, _mm_set1_epi32(1)), zero)), signBit) };
+		const __m128 flipV{ _mm_and_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(_mm_and_si128(hash, _mm_set1_epi32(2)), zero)), signBit) };
+
+		return _mm_add_ps(_mm_xor_ps(u, flipU), _mm_xor_ps(_mm_mul_ps(_mm_set1_ps(2.0f), v), flipV));
+	}
+
+	static __m128 Fade4(__m128 t)
+	{
+		const __m128 inner{ _mm_add_ps(_mm_mul_ps(t, _mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(6.0f)), _mm_set1_ps(15.0f))), _mm_set1_ps(10.0f)) };
+		return _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(t, t), t), inner);
+	}
+
+	static __m128 GradientNoise4(__m128 x, __m128 y, unsigned int seed)
+	{
+		const __m128 floorX{ _mm_floor_ps(x) };
+		const __m128 floorY{ _mm_floor_ps(y) };
+		const __m128i ix{ _mm_cvttps_epi32(floorX) };
+		const __m128i iy{ _mm_cvttps_epi32(floorY) };
+		const __m128 fx{ _mm_sub_ps(x, floorX) };
+		const __m128 fy{ _mm_sub_ps(y, floorY) };
+
+		const __m128 u{ Fade4(fx) };
+		const __m128 v{ Fade4(fy) };
+
+		const __m128i seeds{ _mm_set1_epi32((int)seed) };
+		const __m128i one{ _mm_set1_epi32(1) };
+		const __m128i ix1{ _mm_add_epi32(ix, one) };
+		const __m128i iy1{ _mm_add_epi32(iy, one) };
+		const __m128 fx1{ _mm_sub_ps(fx, _mm_set1_ps(1.0f)) };
+		const __m128 fy1{ _mm_sub_ps(fy, _mm_set1_ps(1.0f)) };
+
+		const __m128 n00{ Gradient4(Hash4(ix, iy, seeds), fx, fy) };
+		const __m128 n10{ Gradient4(Hash4(ix1, iy, seeds), fx1, fy) };
+		const __m128 n01{ Gradient4(Hash4(ix, iy1, seeds), fx, fy1) };
+		const __m128 n11{ Gradient4(Hash4(ix1, iy1, seeds), fx1, fy1) };
+
+		const __m128 lower{ _mm_add_ps(n00, _mm_mul_ps(_mm_sub_ps(n10, n00), u)) };
+		const __m128 upper{ _mm_add_ps(n01, _mm_mul_ps(_mm_sub_ps(n11, n01), u)) };
+		return _mm_mul_ps(_mm_add_ps(lower, _mm_mul_ps(_mm_sub_ps(upper, lower), v)), _mm_set1_ps(KGradientScale));
+	}
+
+	FractalNoise::FractalNoise(const NoiseSettings& settings) : m_settings(settings)
+	{
+		m_settings.octaves = std::max(m_settings.octaves, 1);
+
+		// fBm is divided by the sum of the octave amplitudes to keep it in range
+		float amplitude{ 1.0f };
+		float totalAmplitude{ 0.0f };
+		for (int octave = 0; octave < m_settings.octaves; octave++)
+		{
+			totalAmplitude += amplitude;
+			amplitude *= m_settings.gain;
+		}
+		m_fbmScale = 1.0f / totalAmplitude;
+	}
+
+	// Sums the octaves. Ridged folds each octave about zero and squares it, giving sharp creases.
+	template<bool Ridged>
+	static float Octaves(const NoiseSettings& settings, float fbmScale, float x, float y, unsigned int seed)
+	{
+		float sum{ 0.0f };
+		float amplitude{ 1.0f };
+		float frequency{ settings.frequency };
+		for (int octave = 0; octave < settings.octaves; octave++)
+		{
+			float noise{ GradientNoise(x * frequency, y * frequency, seed + octave) };
+			if (Ridged)
+			{
+				noise = 1.0f - std::abs(noise);
+				noise = noise * noise;
+			}
+
+			sum += noise * amplitude;
+			amplitude *= settings.gain;
+			frequency *= settings.lacunarity;
+		}
+
+		return Ridged ? sum * fbmScale * 2.0f - 1.0f : sum * fbmScale;
+	}
+
+	template<bool Ridged>
+	static __m128 Octaves4(const NoiseSettings& settings, float fbmScale, __m128 x, __m128 y, unsigned int seed)
+	{
+		__m128 sum{ _mm_setzero_ps() };
+		float amplitude{ 1.0f };
+		float frequency{ settings.frequency };
+		for (int octave = 0; octave < settings.octaves; octave++)
+		{
+			const __m128 scale{ _mm_set1_ps(frequency) };
+			__m128 noise{ GradientNoise4(_mm_mul_ps(x, scale), _mm_mul_ps(y, scale), seed + octave) };
+			if (Ridged)
+			{
+				noise = _mm_sub_ps(_mm_set1_ps(1.0f), _mm_andnot_ps(_mm_set1_ps(-0.0f), noise));
+				noise = _mm_mul_ps(noise, noise);
+			}
+
+			sum = _mm_add_ps(sum, _mm_mul_ps(noise, _mm_set1_ps(amplitude)));
+			amplitude *= settings.gain;
+			frequency *= settings.lacunarity;
+		}
+
+		sum = _mm_mul_ps(sum, _mm_set1_ps(fbmScale));
+		return Ridged ? _mm_sub_ps(_mm_mul_ps(sum, _mm_set1_ps(2.0f)), _mm_set1_ps(1.0f)) : sum;
+	}
+
+	// One sample at x, y
+	float FractalNoise::Evaluate(NoiseFractal fractal, float x, float y) const
+	{
+		switch (fractal)
+		{
+		case KNoiseGradient:
+			return GradientNoise(x * m_settings.frequency, y * m_settings.frequency, m_settings.seed);
+		case KNoiseFbm:
+			return Octaves<false>(m_settings, m_fbmScale, x, y, m_settings.seed);
+		case KNoiseRidged:
+			return Octaves<true>(m_settings, m_fbmScale, x, y, m_settings.seed);
+		case KNoiseWarped:
+		{
+			const float distance{ m_settings.warpStrength / m_settings.frequency };
+			const float warpX{ Octaves<false>(m_settings, m_fbmScale, x, y, m_settings.seed + KWarpSeedX) * distance };
+			const float warpY{ Octaves<false>(m_settings, m_fbmScale, x, y, m_settings.seed + KWarpSeedY) * distance };
+			return Octaves<false>(m_settings, m_fbmScale, x + warpX, y + warpY, m_settings.seed);
+		}
+		default:
+			return 0.0f;
+		}
+	}
+
+	// Four samples, each array holds four values
+	void FractalNoise::Evaluate4(NoiseFractal fractal, const float* x, const float* y, float* out) const
+	{
+		const __m128 px{ _mm_loadu_ps(x) };
+		const __m128 py{ _mm_loadu_ps(y) };
+
+		__m128 result{ _mm_setzero_ps() };
+		switch (fractal)
+		{
+		case KNoiseGradient:
+		{
+			const __m128 scale{ _mm_set1_ps(m_settings.frequency) };
+			result = GradientNoise4(_mm_mul_ps(px, scale), _mm_mul_ps(py, scale), m_settings.seed);
+			break;
+		}
+		case KNoiseFbm:
+			result = Octaves4<false>(m_settings, m_fbmScale, px, py, m_settings.seed);
+			break;
+		case KNoiseRidged:
+			result = Octaves4<true>(m_settings, m_fbmScale, px, py, m_settings.seed);
+			break;
+		case KNoiseWarped:
+		{
+			const __m128 distance{ _mm_set1_ps(m_settings.warpStrength / m_settings.frequency) };
+			const __m128 warpX{ _mm_mul_ps(Octaves4<false>(m_settings, m_fbmScale, px, py, m_settings.seed + KWarpSeedX), distance) };
+			const __m128 warpY{ _mm_mul_ps(Octaves4<false>(m_settings, m_fbmScale, px, py, m_settings.seed + KWarpSeedY), distance) };
+			result = Octaves4<false>(m_settings, m_fbmScale, _mm_add_ps(px, warpX), _mm_add_ps(py, warpY), m_settings.seed);
+			break;
+		}
+		default:
+			break;
+		}
+
+		_mm_storeu_ps(out, result);
+	}
+
+	// Fills a width x height grid x major i.e. the sample at (x, z) is at x * height + z, lines are spread across the job system
+	void FractalNoise::FillGrid(NoiseFractal fractal, int width, int height, std::vector<float>& out) const
+	{
+		out.resize((size_t)std::max(width, 0) * std::max(height, 0));
+		if (out.empty())
+			return;
+
+		JobSystem::Get().ParallelFor((size_t)width, 8, [&](size_t begin, size_t end)
+			{
+				const float offsets[4]{ 0.0f, 1.0f, 2.0f, 3.0f };
+				for (size_t x = begin; x < end; x++)
+				{
+					float* line{ out.data() + x * height };
+					const float xs[4]{ (float)x, (float)x, (float)x, (float)x };
+
+					int z{ 0 };
+					for (; z + 4 <= height; z += 4)
+					{
+						const float zs[4]{ z + offsets[0], z + offsets[1], z + offsets[2], z + offsets[3] };
+						Evaluate4(fractal, xs, zs, line + z);
+					}
+
+					// Any left over go through the four wide version too so every sample matches
+					if (z < height)
+					{
+						const float zs[4]{ z + offsets[0], z + offsets[1], z + offsets[2], z + offsets[3] };
+						float results[4];
+						Evaluate4(fractal, xs, zs, results);
+						for (int i = 0; z < height; z++, i++)
+							line[z] = results[i];
+					}
+				}
+			});
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+// Gradient noise and the fractals built on it, evaluated four samples at a time with SSE
+
+#include "ExternalLibraryHeaders.h"
+
+namespace Helpers
+{
+	// The fractals FractalNoise can produce
+	enum NoiseFractal
+	{
+		KNoiseGradient,		// A single octave
+		KNoiseFbm,			// Octaves summed with falling amplitude, rolling hills
+		KNoiseRidged,		// Octaves folded about zero so the creases become sharp ridges
+		KNoiseWarped,		// fBm with its input pushed around by two more fBm lookups, gives twisted flowing shapes
+		KNumNoiseFractals
+	};
+
+	struct NoiseSettings
+	{
+		// The same seed always gives the same noise
+		unsigned int seed{ 1337 };
+		int octaves{ 6 };
+
+		// Features are roughly 1 / frequency input units across
+		float frequency{ 1.0f / 64.0f };
+
+		// Each octave multiplies the frequency by lacunarity and the amplitude by gain
+		float lacunarity{ 2.0f };
+		float gain{ 0.5f };
+
+		// How far KNoiseWarped moves its input, in features
+		float warpStrength{ 1.0f };
+	};
+
+	// Deterministic 2D noise. Results are roughly in the range -1 to 1.
+	// The scalar functions are the reference for the four wide ones and give the same results.
+	class FractalNoise
+	{
+	private:
+		NoiseSettings m_settings;
+		float m_fbmScale{ 1.0f };
+	public:
+		explicit FractalNoise(const NoiseSettings& settings = NoiseSettings());
+
+		const NoiseSettings& GetSettings() const { return m_settings; }
+
+		// One sample at x, y
+		float Evaluate(NoiseFractal fractal, float x, float y) const;
+
+		// Four samples, each array holds four values
+		void Evaluate4(NoiseFractal fractal, const float* x, const float* y, float* out) const;
+
+		// Fills a width x height grid x major i.e. the sample at (x, z) is at x * height + z, lines are spread across the job system
+		void FillGrid(NoiseFractal fractal, int width, int height, std::vector<float>& out) const;
+	};
+}
@@ -0,0 +1,107 @@
+#include "FrameUniforms.h"
+
+namespace Helpers
+{
+	static_assert(sizeof(FrameUniforms::FrameData) == 5 * 64 + 16 + 16, "FrameData must match the std140 block in camera.glsl");
+
+	FrameUniforms::~FrameUniforms()
+	{
+		for (GLsync fence : m_fences)
+		{
+			if (fence)
+				glDeleteSync(fence);
+		}
+
+		if (m_buffer)
+		{
+			if (m_mapped)
+			{
+				glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+				glUnmapBuffer(GL_UNIFORM_BUFFER);
+				glBindBuffer(GL_UNIFORM_BUFFER, 0);
+			}
+			glDeleteBuffers(1, &m_buffer);
+		}
+	}
+
+	// Creates the buffer. Without OpenGL 4.4 the block is updated with glBufferSubData instead. Returns false on error.
+	bool FrameUniforms::Create()
+	{
+		if (m_buffer)
+			return false;
+
+		GLint alignment{ 256 };
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		m_partBytes = (sizeof(FrameData) + alignment - 1) / alignment * alignment;
+
+		glGenBuffers(1, &m_buffer);
+		glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+		if (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage)
+		{
+			// Only written by the CPU, coherent so nothing needs flushing
+			const GLbitfield flags{ GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT };
+			glBufferStorage(GL_UNIFORM_BUFFER, m_partBytes * KNumParts, nullptr, flags);
+			m_mapped = (BYTE*)glMapBufferRange(GL_UNIFORM_BUFFER, 0, m_partBytes * KNumParts, flags);
+		}
+
+		if (!m_mapped)
+		{
+			std::cout << "Frame uniforms cannot be persistently mapped, updating them with glBufferSubData" << std::endl;
+			glBufferData(GL_UNIFORM_BUFFER, m_partBytes, nullptr, GL_DYNAMIC_DRAW);
+		}
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+		return true;
+	}
+
+	// Writes this frame's values into the next part and binds it to KBinding, call before any draws
+	void FrameUniforms::Update(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition, float deltaTime)
+	{
+		m_time += deltaTime;
+
+		FrameData data;
+		data.view = view;
+		data.projection = projection;
+		data.viewProjection = projection * view;
+		data.skyViewProjection = projection * glm::mat4(glm::mat3(view));
+		data.inverseSkyViewProjection = glm::inverse(data.skyViewProjection);
+		data.cameraPosition = glm::vec4(cameraPosition, 1.0f);
+		data.time = m_time;
+		data.deltaTime = deltaTime;
+		data.padding[0] = data.padding[1] = 0;
+
+		if (!m_mapped)
+		{
+			glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+			glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(data), &data);
+			glBindBuffer(GL_UNIFORM_BUFFER, 0);
+			glBindBufferRange(GL_UNIFORM_BUFFER, KBinding, m_buffer, 0, sizeof(data));
+			return;
+		}
+
+		m_part = (m_part + 1) % KNumParts;
+
+		// Three frames back, the driver rarely queues that many so this should not block
+		if (GLsync& fence{ m_fences[m_part] })
+		{
+			if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+			{
+				m_numWaits++;
+				glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(1000000000));
+			}
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+
+		const size_t offset{ m_partBytes * m_part };
+		memcpy(m_mapped + offset, &data, sizeof(data));
+		glBindBufferRange(GL_UNIFORM_BUFFER, KBinding, m_buffer, offset, sizeof(data));
+	}
+
+	// Call once the frame's draws are issued, GL is reading the part until then
+	void FrameUniforms::EndFrame()
+	{
+		if (m_mapped && !m_fences[m_part])
+			m_fences[m_part] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "ExternalLibraryHeaders.h"
+
+namespace Helpers
+{
+	// The camera and timing values every program reads, written once a frame to a std140 uniform block at a fixed binding
+	// rather than set on each program. The buffer is persistently mapped and split in three so the CPU writes one
+	// part while GL may still be reading the two before it, a fence per part says when it is free again.
+	// Shaders see it through Data/Shaders/Include/camera.glsl, which must match FrameData.
+	class FrameUniforms
+	{
+	public:
+		// Binding point of the FrameData block, also in camera.glsl
+		static constexpr GLuint KBinding{ 0 };
+
+		// std140 layout, every member is 16 byte aligned
+		struct FrameData
+		{
+			glm::mat4 view;
+			glm::mat4 projection;
+			glm::mat4 viewProjection;
+
+			// The view without its translation, for things at infinity like the sky, and its inverse
+			glm::mat4 skyViewProjection;
+			glm::mat4 inverseSkyViewProjection;
+
+			// w is unused
+			glm::vec4 cameraPosition;
+
+			// Seconds since the first frame, and since the last
+			float time;
+			float deltaTime;
+			float padding[2];
+		};
+	private:
+		static constexpr int KNumParts{ 3 };
+
+		GLuint m_buffer{ 0 };
+		BYTE* m_mapped{ nullptr };
+
+		// Bytes between parts, FrameData rounded up to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+		size_t m_partBytes{ 0 };
+		GLsync m_fences[KNumParts]{};
+		int m_part{ 0 };
+
+		float m_time{ 0 };
+		size_t m_numWaits{ 0 };
+	public:
+		FrameUniforms() = default;
+		~FrameUniforms();
+
+		FrameUniforms(const FrameUniforms&) = delete;
+		FrameUniforms& operator=(const FrameUniforms&) = delete;
+
+		// Creates the buffer. Without OpenGL 4.4 the block is updated with glBufferSubData instead. Returns false on error.
+		bool Create();
+
+		// Writes this frame's values into the next part and binds it to KBinding, call before any draws
+		void Update(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition, float deltaTime);
+
+		// Call once the frame's draws are issued, GL is reading the part until then
+		void EndFrame();
+
+		// Times Update had to wait for GL to finish with a part, should stay at 0 with three of them
+		size_t NumWaits() const { return m_numWaits; }
+	};
+}
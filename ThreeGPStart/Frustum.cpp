@@ -0,0 +1,41 @@
+#include "Frustum.h"
+
+namespace Helpers
+{
+	// Pull the planes out of a combined projection * view matrix (Gribb and Hartmann)
+	void Frustum::Extract(const glm::mat4& viewProjection)
+	{
+		// glm is column major so a row is spread across the columns
+		glm::vec4 rows[4];
+		for (int i = 0; i < 4; i++)
+			rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+
+		m_planes[0] = rows[3] + rows[0];	// left
+		m_planes[1] = rows[3] - rows[0];	// right
+		m_planes[2] = rows[3] + rows[1];	// bottom
+		m_planes[3] = rows[3] - rows[1];	// top
+		m_planes[4] = rows[3] + rows[2];	// near
+		m_planes[5] = rows[3] - rows[2];	// far
+
+		for (glm::vec4& plane : m_planes)
+			plane /= glm::length(glm::vec3(plane));
+	}
+
+	// Returns false only if the box is completely outside one of the planes
+	bool Frustum::IntersectsAABB(const glm::vec3& minExtents, const glm::vec3& maxExtents) const
+	{
+		for (const glm::vec4& plane : m_planes)
+		{
+			// The corner furthest along the plane normal, if that is behind the plane so is the whole box
+			const glm::vec3 corner{
+				plane.x >= 0 ? maxExtents.x : minExtents.x,
+				plane.y >= 0 ? maxExtents.y : minExtents.y,
+				plane.z >= 0 ? maxExtents.z : minExtents.z };
+
+			if (glm::dot(glm::vec3(plane), corner) + plane.w < 0)
+				return false;
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "ExternalLibraryHeaders.h"
+
+namespace Helpers
+{
+	// View frustum as six planes, used to skip geometry the camera cannot see
+	class Frustum
+	{
+	private:
+		// Plane normals point into the frustum, w is the distance term
+		glm::vec4 m_planes[6];
+	public:
+		Frustum() = default;
+		explicit Frustum(const glm::mat4& viewProjection) { Extract(viewProjection); }
+
+		// Pull the planes out of a combined projection * view matrix
+		void Extract(const glm::mat4& viewProjection);
+
+		// Returns false only if the box is completely outside, so may return true for some boxes that are just outside a corner
+		bool IntersectsAABB(const glm::vec3& minExtents, const glm::vec3& maxExtents) const;
+	};
+}
@@ -0,0 +1,184 @@
+#include "GLState.h"
+
+namespace Helpers
+{
+	// Index into the per unit bindings, KNumTextureTargets if the target is not tracked
+	static int TargetIndex(GLenum target)
+	{
+		switch (target)
+		{
+		case GL_TEXTURE_2D:
+			return GLState::KTexture2D;
+		case GL_TEXTURE_CUBE_MAP:
+			return GLState::KTextureCubeMap;
+		case GL_TEXTURE_2D_ARRAY:
+			return GLState::KTexture2DArray;
+		default:
+			return GLState::KNumTextureTargets;
+		}
+	}
+
+	GLState::GLState()
+	{
+		Invalidate();
+	}
+
+	// The state of the one OpenGL context
+	GLState& GLState::Get()
+	{
+		static GLState state;
+		return state;
+	}
+
+	// Forget everything so the next call of each kind is issued
+	void GLState::Invalidate()
+	{
+		m_program = KUnknown;
+		m_vertexArray = KUnknown;
+		m_activeUnit = KUnknown;
+		for (GLuint unit = 0; unit < KMaxTextureUnits; unit++)
+			for (int target = 0; target < KNumTextureTargets; target++)
+				m_textures[unit][target] = KUnknown;
+
+		m_depthTest = -1;
+		m_cullFace = -1;
+		m_blend = -1;
+		m_depthMask = -1;
+		m_depthFunc = KUnknown;
+		m_polygonMode = KUnknown;
+
+		// The viewport is kept so GetViewport still works, it is only ever set through here
+	}
+
+	// Counts the call and returns true if it needs issuing
+	bool GLState::Changes(bool changes)
+	{
+		if (changes)
+			m_numIssued++;
+		else
+			m_numSkipped++;
+
+		return changes;
+	}
+
+	int* GLState::CapabilityState(GLenum capability)
+	{
+		switch (capability)
+		{
+		case GL_DEPTH_TEST:
+			return &m_depthTest;
+		case GL_CULL_FACE:
+			return &m_cullFace;
+		case GL_BLEND:
+			return &m_blend;
+		default:
+			return nullptr;
+		}
+	}
+
+	void GLState::UseProgram(GLuint program)
+	{
+		if (Changes(m_program != program))
+		{
+			glUseProgram(program);
+			m_program = program;
+		}
+	}
+
+	void GLState::BindVertexArray(GLuint vertexArray)
+	{
+		if (Changes(m_vertexArray != vertexArray))
+		{
+			glBindVertexArray(vertexArray);
+			m_vertexArray = vertexArray;
+		}
+	}
+
+	void GLState::ActiveTexture(GLuint unit)
+	{
+		if (Changes(m_activeUnit != unit))
+		{
+			glActiveTexture(GL_TEXTURE0 + unit);
+			m_activeUnit = unit;
+		}
+	}
+
+	// Binds texture to target on unit, selecting the unit first if needed
+	void GLState::BindTexture(GLuint unit, GLenum target, GLuint texture)
+	{
+		const int targetIndex{ TargetIndex(target) };
+		if (unit < KMaxTextureUnits && targetIndex < KNumTextureTargets && !Changes(m_textures[unit][targetIndex] != texture))
+			return;
+
+		ActiveTexture(unit);
+		glBindTexture(target, texture);
+
+		if (unit < KMaxTextureUnits && targetIndex < KNumTextureTargets)
+			m_textures[unit][targetIndex] = texture;
+		else
+			m_numIssued++;
+	}
+
+	// GL_DEPTH_TEST, GL_CULL_FACE and GL_BLEND are tracked, anything else is always issued
+	void GLState::Enable(GLenum capability)
+	{
+		int* state{ CapabilityState(capability) };
+		if (Changes(!state || *state != 1))
+		{
+			glEnable(capability);
+			if (state)
+				*state = 1;
+		}
+	}
+
+	void GLState::Disable(GLenum capability)
+	{
+		int* state{ CapabilityState(capability) };
+		if (Changes(!state || *state != 0))
+		{
+			glDisable(capability);
+			if (state)
+				*state = 0;
+		}
+	}
+
+	void GLState::DepthMask(GLboolean write)
+	{
+		const int value{ write ? 1 : 0 };
+		if (Changes(m_depthMask != value))
+		{
+			glDepthMask(write);
+			m_depthMask = value;
+		}
+	}
+
+	void GLState::DepthFunc(GLenum func)
+	{
+		if (Changes(m_depthFunc != func))
+		{
+			glDepthFunc(func);
+			m_depthFunc = func;
+		}
+	}
+
+	// Applies to front and back faces, the only choice in the core profile
+	void GLState::PolygonMode(GLenum mode)
+	{
+		if (Changes(m_polygonMode != mode))
+		{
+			glPolygonMode(GL_FRONT_AND_BACK, mode);
+			m_polygonMode = mode;
+		}
+	}
+
+	void GLState::Viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+	{
+		const glm::ivec4 viewport{ x, y, width, height };
+		if (Changes(!m_viewportKnown || m_viewport != viewport))
+		{
+			glViewport(x, y, width, height);
+			m_viewport = viewport;
+			m_viewportKnown = true;
+		}
+	}
+}
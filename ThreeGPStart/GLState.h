@@ -0,0 +1,86 @@
+#pragma once
+
+#include "ExternalLibraryHeaders.h"
+
+namespace Helpers
+{
+	// Shadow copy of the OpenGL state the renderer changes. Calls that would not change anything are dropped.
+	// Everything that binds programs, vertex arrays or textures, or changes the tracked capabilities, should go through here.
+	// Code that changes the state directly must call Invalidate afterwards. ImGui restores what it changes so is fine.
+	class GLState
+	{
+	public:
+		static constexpr GLuint KMaxTextureUnits{ 16 };
+
+		// Texture targets with a shadow binding per unit, others are always issued
+		enum TextureTarget
+		{
+			KTexture2D,
+			KTextureCubeMap,
+			KTexture2DArray,
+			KNumTextureTargets
+		};
+	private:
+		// Stands for a value not known yet, so the next call is always issued
+		static constexpr GLuint KUnknown{ 0xFFFFFFFF };
+
+		GLuint m_program{ KUnknown };
+		GLuint m_vertexArray{ KUnknown };
+		GLuint m_activeUnit{ KUnknown };
+		GLuint m_textures[KMaxTextureUnits][KNumTextureTargets];
+
+		// -1 unknown, otherwise 0 or 1
+		int m_depthTest{ -1 };
+		int m_cullFace{ -1 };
+		int m_blend{ -1 };
+		int m_depthMask{ -1 };
+
+		GLenum m_depthFunc{ KUnknown };
+		GLenum m_polygonMode{ KUnknown };
+		glm::ivec4 m_viewport{ 0 };
+		bool m_viewportKnown{ false };
+
+		size_t m_numIssued{ 0 };
+		size_t m_numSkipped{ 0 };
+
+		// Counts the call and returns true if it needs issuing
+		bool Changes(bool changes);
+		int* CapabilityState(GLenum capability);
+		void ActiveTexture(GLuint unit);
+	public:
+		GLState();
+
+		// The state of the one OpenGL context
+		static GLState& Get();
+
+		// Forget everything so the next call of each kind is issued
+		void Invalidate();
+
+		void UseProgram(GLuint program);
+		void BindVertexArray(GLuint vertexArray);
+
+		// Binds texture to target on unit, selecting the unit first if needed
+		void BindTexture(GLuint unit, GLenum target, GLuint texture);
+
+		// GL_DEPTH_TEST, GL_CULL_FACE and GL_BLEND are tracked, anything else is always issued
+		void Enable(GLenum capability);
+		void Disable(GLenum capability);
+		void SetEnabled(GLenum capability, bool enabled) { enabled ? Enable(capability) : Disable(capability); }
+
+		void DepthMask(GLboolean write);
+		void DepthFunc(GLenum func);
+
+		// Applies to front and back faces, the only choice in the core profile
+		void PolygonMode(GLenum mode);
+
+		void Viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+		// The last viewport set through here, saves asking OpenGL with glGetIntegerv
+		const glm::ivec4& GetViewport() const { return m_viewport; }
+
+		// Calls issued to OpenGL and dropped as redundant since the last reset
+		size_t NumIssued() const { return m_numIssued; }
+		size_t NumSkipped() const { return m_numSkipped; }
+		void ResetCounters() { m_numIssued = 0; m_numSkipped = 0; }
+	};
+}
@@ -0,0 +1,177 @@
+#include "GpuModel.h"
+#include "VertexFormat.h"
+#include "ImageLoader.h"
+#include "DDSFile.h"
+#include "JobSystem.h"
+#include <filesystem>
+namespace fs = std::filesystem;
+
+namespace Helpers
+{
+	GpuModel::~GpuModel()
+	{
+		for (Part& part : m_parts)
+		{
+			glDeleteVertexArrays(1, &part.vertexArray);
+			glDeleteBuffers(1, &part.vertexBuffer);
+			glDeleteBuffers(1, &part.elementBuffer);
+		}
+	}
+
+	// Uploads every mesh. Material textures are looked for in the model's folder. Ones textures does not already
+	// have are decoded across the job system then added to it, or streamed in over the next frames if a streamer is given.
+	// The colours of each material go in materialTable if one is given, the table still needs uploading after.
+	// With an arena each mesh is added to it, still to be uploaded, and only meshes whose layout it rejects get a VAO.
+	// Returns false if the model has no meshes, a missing texture is reported but not an error.
+	bool GpuModel::Create(ModelLoader& loader, const std::string& modelFilepath, TextureManager& textures, TextureStreamer* streamer,
+		MaterialTable* materialTable, StaticMeshArena* arena)
+	{
+		const std::vector<Mesh>& meshes{ loader.GetMeshVector() };
+		const std::vector<Material>& materials{ loader.GetMaterialVector() };
+		if (meshes.empty() || !m_parts.empty())
+			return false;
+
+		// Only the materials a mesh actually uses, each decoded once however many meshes share it
+		std::vector<size_t> usedMaterials;
+		for (const Mesh& mesh : meshes)
+		{
+			if (mesh.materialIndex < materials.size() && !materials[mesh.materialIndex].diffuseTextureFilename.empty() &&
+				std::find(usedMaterials.begin(), usedMaterials.end(), mesh.materialIndex) == usedMaterials.end())
+				usedMaterials.push_back(mesh.materialIndex);
+		}
+
+		// Decode the ones not already uploaded in parallel, then upload on this thread
+		const fs::path folder{ fs::path(modelFilepath).parent_path() };
+		std::vector<std::string> texturePaths(usedMaterials.size());
+		std::vector<GLuint> materialTextures(materials.size(), 0);
+		std::vector<size_t> toDecode;
+		for (size_t i = 0; i < usedMaterials.size(); i++)
+		{
+			texturePaths[i] = (folder / materials[usedMaterials[i]].diffuseTextureFilename).string();
+			std::shared_ptr<Texture> texture{ textures.Find(texturePaths[i]) };
+
+			// DDS files are only read, not decoded, so there is nothing to gain from loading them in parallel
+			if (!texture && IsDDSFile(texturePaths[i]))
+				texture = textures.Load(texturePaths[i]);
+			else if (!texture && streamer)
+				texture = textures.Stream(texturePaths[i], *streamer);
+
+			if (texture)
+			{
+				materialTextures[usedMaterials[i]] = texture->GetId();
+				m_textures.push_back(texture);
+			}
+			else if (!IsDDSFile(texturePaths[i]) && !streamer)
+			{
+				toDecode.push_back(i);
+			}
+		}
+
+		std::vector<ImageLoader> images(toDecode.size());
+		JobSystem::Get().ParallelFor(toDecode.size(), 1, [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+					images[i].Load(texturePaths[toDecode[i]]);
+			});
+
+		for (size_t i = 0; i < toDecode.size(); i++)
+		{
+			std::shared_ptr<Texture> texture{ textures.Add(texturePaths[toDecode[i]], images[i]) };
+			if (!texture)
+			{
+				std::cout << "Model texture not found: " << texturePaths[toDecode[i]] << std::endl;
+				continue;
+			}
+
+			materialTextures[usedMaterials[toDecode[i]]] = texture->GetId();
+			m_textures.push_back(texture);
+		}
+
+		// Every material goes in the table, not just textured ones, identical ones share an entry
+		std::vector<uint32_t> materialIndices(materials.size(), 0);
+		if (materialTable)
+		{
+			for (size_t i = 0; i < materials.size(); i++)
+				materialIndices[i] = materialTable->Add(materials[i]);
+		}
+
+		for (const Mesh& mesh : meshes)
+		{
+			Part part;
+			if (mesh.materialIndex < materialTextures.size())
+			{
+				part.texture = materialTextures[mesh.materialIndex];
+				part.material = materialIndices[mesh.materialIndex];
+			}
+
+			if (arena)
+				part.arenaMesh = arena->AddMesh(mesh);
+
+			if (part.arenaMesh == StaticMeshArena::KInvalidMesh)
+			{
+				// One interleaved buffer with packed normals, uvs and (where possible) 16 bit elements
+				const InterleavedMesh packed{ BuildInterleavedMesh(mesh) };
+				part.vertexArray = packed.CreateVAO(part.vertexBuffer, part.elementBuffer);
+				part.numElements = packed.numElements;
+				part.elementType = packed.elementType;
+				m_gpuBytes += packed.PackedBytes();
+			}
+			else
+			{
+				part.numElements = arena->GetMesh(part.arenaMesh).numElements;
+			}
+
+			m_parts.push_back(part);
+		}
+
+		return true;
+	}
+
+	// Paths differing only in separators or . and .. steps are the same model
+	std::string GpuModelCache::Key(const std::string& filepath)
+	{
+		return fs::path(filepath).lexically_normal().make_preferred().string();
+	}
+
+	// The model if it is still in use, otherwise nullptr. Check before importing a model again.
+	std::shared_ptr<GpuModel> GpuModelCache::Find(const std::string& filepath)
+	{
+		const auto found{ m_models.find(Key(filepath)) };
+		if (found == m_models.end())
+			return nullptr;
+
+		std::shared_ptr<GpuModel> model{ found->second.lock() };
+		if (model)
+			m_numReused++;
+
+		return model;
+	}
+
+	// Uploads the loaded model unless the same file is already in use, in which case that is shared
+	std::shared_ptr<GpuModel> GpuModelCache::Add(const std::string& filepath, ModelLoader& loader, TextureManager& textures,
+		TextureStreamer* streamer, MaterialTable* materialTable, StaticMeshArena* arena)
+	{
+		if (std::shared_ptr<GpuModel> existing{ Find(filepath) })
+			return existing;
+
+		std::shared_ptr<GpuModel> model{ std::make_shared<GpuModel>() };
+		if (!model->Create(loader, filepath, textures, streamer, materialTable, arena))
+			return nullptr;
+
+		m_models[Key(filepath)] = model;
+		return model;
+	}
+
+	// Models currently alive
+	size_t GpuModelCache::NumModels() const
+	{
+		size_t count{ 0 };
+		for (const auto& entry : m_models)
+		{
+			if (!entry.second.expired())
+				count++;
+		}
+
+		return count;
+	}
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "ExternalLibraryHeaders.h"
+#include "Mesh.h"
+#include "TextureManager.h"
+#include "MaterialTable.h"
+#include "StaticMeshArena.h"
+#include <unordered_map>
+
+namespace Helpers
+{
+	// Every mesh of a loaded model uploaded to OpenGL, plus the diffuse texture of each material the meshes use.
+	// Owns its buffers and VAOs and deletes them when destroyed, the textures come from a TextureManager.
+	// Meshes given to a StaticMeshArena live in its buffers instead and the part has no VAO of its own.
+	class GpuModel
+	{
+	public:
+		struct Part
+		{
+			GLuint vertexArray{ 0 };
+			GLuint vertexBuffer{ 0 };
+			GLuint elementBuffer{ 0 };
+			GLuint numElements{ 0 };
+			GLenum elementType{ GL_UNSIGNED_INT };
+
+			// Diffuse texture of the mesh's material, 0 if it has none or it failed to load
+			GLuint texture{ 0 };
+
+			// Entry in the MaterialTable, 0 (the default) if none was given
+			uint32_t material{ 0 };
+
+			// The mesh in the StaticMeshArena, KInvalidMesh if the part has its own VAO
+			size_t arenaMesh{ StaticMeshArena::KInvalidMesh };
+		};
+	private:
+		std::vector<Part> m_parts;
+
+		// Held so the textures live as long as the model, they may be shared with other models
+		std::vector<std::shared_ptr<Texture>> m_textures;
+		size_t m_gpuBytes{ 0 };
+	public:
+		GpuModel() = default;
+		~GpuModel();
+
+		GpuModel(const GpuModel&) = delete;
+		GpuModel& operator=(const GpuModel&) = delete;
+
+		// Uploads every mesh. Material textures are looked for in the model's folder. Ones textures does not already
+		// have are decoded across the job system then added to it, or streamed in over the next frames if a streamer is given.
+		// The colours of each material go in materialTable if one is given, the table still needs uploading after.
+		// With an arena each mesh is added to it, still to be uploaded, and only meshes whose layout it rejects get a VAO.
+		// Returns false if the model has no meshes, a missing texture is reported but not an error.
+		bool Create(ModelLoader& loader, const std::string& modelFilepath, TextureManager& textures, TextureStreamer* streamer = nullptr,
+			MaterialTable* materialTable = nullptr, StaticMeshArena* arena = nullptr);
+
+		const std::vector<Part>& GetParts() const { return m_parts; }
+
+		// Bytes of vertex and element data in the model's own buffers, not counting textures or meshes in an arena
+		size_t GpuBytes() const { return m_gpuBytes; }
+	};
+
+	// Hands out shared GpuModels keyed by file path, so a model used in several places is only uploaded once.
+	// Only weak references are kept: a model is freed when the last user lets go of it, and uploaded again if asked for after.
+	class GpuModelCache
+	{
+	private:
+		std::unordered_map<std::string, std::weak_ptr<GpuModel>> m_models;
+		size_t m_numReused{ 0 };
+
+		static std::string Key(const std::string& filepath);
+	public:
+		// The model if it is still in use, otherwise nullptr. Check before importing a model again.
+		std::shared_ptr<GpuModel> Find(const std::string& filepath);
+
+		// Uploads the loaded model unless the same file is already in use, in which case that is shared
+		std::shared_ptr<GpuModel> Add(const std::string& filepath, ModelLoader& loader, TextureManager& textures,
+			TextureStreamer* streamer = nullptr, MaterialTable* materialTable = nullptr, StaticMeshArena* arena = nullptr);
+
+		// Models currently alive, and how many requests were served by one already uploaded
+		size_t NumModels() const;
+		size_t NumReused() const { return m_numReused; }
+	};
+}
@@ -1,4 +1,5 @@
 #include "Helper.h"
+#include "GLState.h"
 
 #include <fstream>
 #include <sstream>
@@ -150,7 +151,7 @@ namespace Helpers
 		// The framebuffer size needs to be retrieved for glViewport.
 		int fbwidth, fbheight;
 		glfwGetFramebufferSize(window, &fbwidth, &fbheight);
-		glViewport(0, 0, fbwidth, fbheight);
+		GLState::Get().Viewport(0, 0, fbwidth, fbheight);
 
 		glfwSwapInterval(0);
 
@@ -222,9 +223,6 @@ namespace Helpers
 	// Load and compile a shader of shaderType from file shaderFilename
 	GLuint LoadAndCompileShader(GLenum shaderType, const std::string& shaderFilename)
 	{
-		// Create shaders
-		GLuint shaderId{ glCreateShader(shaderType) };
-
 		std::string vShaderString = stringFromFile(shaderFilename);
 		if (vShaderString.empty())
 		{
@@ -232,18 +230,105 @@ namespace Helpers
 			return 0;
 		}
 
-		const char* asChar{ vShaderString.c_str() };
+		return CompileShader(shaderType, vShaderString, shaderFilename);
+	}
 
-		std::cout << "Compiling Shader" << shaderFilename << std::endl;
+	// Compile a shader of shaderType from source already in memory, name is for the log. Returns 0 on error.
+	GLuint CompileShader(GLenum shaderType, const std::string& source, const std::string& name)
+	{
+		// Create shaders
+		GLuint shaderId{ glCreateShader(shaderType) };
+
+		const char* asChar{ source.c_str() };
+
+		std::cout << "Compiling Shader" << name << std::endl;
 
 		glShaderSource(shaderId, 1, (const GLchar * *)& asChar, NULL);
 		glCompileShader(shaderId);
 
 		if (!DidShaderCompileOK(shaderId))
+		{
+			glDeleteShader(shaderId);
 			return 0;
+		}
 
 		std::cout << "Compiled OK" << std::endl;
 
 		return shaderId;
 	}
+
+	// 64 bit FNV-1a style hash. Consumes 8 bytes per step rather than 1 as it is used on whole model files
+	uint64_t HashBytes(const void* data, size_t size, uint64_t seed)
+	{
+		const uint64_t prime{ 1099511628211ull };
+		const BYTE* bytes{ (const BYTE*)data };
+
+		uint64_t hash{ seed };
+		size_t i{ 0 };
+		for (; i + 8 <= size; i += 8)
+		{
+			uint64_t word;
+			memcpy(&word, bytes + i, 8);
+			hash = (hash ^ word) * prime;
+		}
+
+		for (; i < size; i++)
+			hash = (hash ^ bytes[i]) * prime;
+
+		// Final avalanche so that similar inputs end up far apart
+		hash ^= hash >> 33;
+		hash *= 0xff51afd7ed558ccdull;
+		hash ^= hash >> 33;
+
+		return hash;
+	}
+
+	// Map the file into memory, returns false if it does not exist or is empty
+	bool MappedFile::Open(const std::string& filepath)
+	{
+		Close();
+
+		m_file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (m_file == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(m_file, &fileSize) || fileSize.QuadPart == 0)
+		{
+			Close();
+			return false;
+		}
+
+		m_mapping = CreateFileMappingA(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (!m_mapping)
+		{
+			Close();
+			return false;
+		}
+
+		m_data = (const BYTE*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!m_data)
+		{
+			Close();
+			return false;
+		}
+
+		m_size = (size_t)fileSize.QuadPart;
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		if (m_data)
+			UnmapViewOfFile(m_data);
+		if (m_mapping)
+			CloseHandle(m_mapping);
+		if (m_file != INVALID_HANDLE_VALUE)
+			CloseHandle(m_file);
+
+		m_data = nullptr;
+		m_mapping = nullptr;
+		m_file = INVALID_HANDLE_VALUE;
+		m_size = 0;
+	}
 }
\ No newline at end of file
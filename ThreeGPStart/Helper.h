@@ -25,6 +25,35 @@ namespace Helpers
 	// Load and compile a shader of shaderType from file shaderFilename. Returns 0 on error.
 	GLuint LoadAndCompileShader(GLenum shaderType, const std::string& shaderFilename);
 
+	// Compile a shader of shaderType from source already in memory, name is for the log. Returns 0 on error.
+	GLuint CompileShader(GLenum shaderType, const std::string& source, const std::string& name);
+
+	// 64 bit FNV-1a style hash of a block of memory, seed allows hashes to be chained
+	uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 14695981039346656037ull);
+
+	// Read only memory mapping of a whole file, unmapped when this goes out of scope
+	class MappedFile
+	{
+	private:
+		HANDLE m_file{ INVALID_HANDLE_VALUE };
+		HANDLE m_mapping{ nullptr };
+		const BYTE* m_data{ nullptr };
+		size_t m_size{ 0 };
+	public:
+		MappedFile() = default;
+		~MappedFile() { Close(); }
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		// Map the file into memory, returns false if it does not exist or is empty
+		bool Open(const std::string& filepath);
+		void Close();
+
+		const BYTE* GetData() const { return m_data; }
+		size_t Size() const { return m_size; }
+	};
+
 	// Helper to output a glm::vec3
 	inline std::string ToString(glm::vec3 v) {
 		return "Pos x:" + std::to_string(v.x) +
@@ -13,11 +13,12 @@ namespace Helpers
 		const int x = (int)(u * (m_width - 1));
 		const int y = (int)(v * (m_height - 1));
 
-		BYTE alpha{ m_data[(x + y * m_width) * 4 + 3] };
+		const BYTE* data{ GetData() };
+		BYTE alpha{ data[(x + y * m_width) * 4 + 3] };
 		if (alpha == 0)
 			return 0;
 
-		BYTE red{ m_data[(x + y * m_width) * 4] };
+		BYTE red{ data[(x + y * m_width) * 4] };
 
 		if (alpha == 255 || red == 0)
 			return red;
@@ -26,15 +27,14 @@ namespace Helpers
 		return calc;
 	}
 
-	// Attempt to load an image from the file and path provided. Returns false on error.
-	bool ImageLoader::Load(const std::string& filepath)
+	// Reads the file with whichever FreeImage plugin matches it. Returns nullptr on error.
+	FIBITMAP* ImageLoader::Decode(const std::string& filepath)
 	{
-		
 		// First check file exists
 		if (!exists(fs::path(filepath)))
 		{
 			std::cout << "File does not exist: " << filepath << std::endl;
-			return false;
+			return nullptr;
 		}
 
 		// Determine the format of the image.
@@ -51,87 +51,173 @@ namespace Helpers
 			if (!FreeImage_FIFSupportsReading(format))
 			{
 				std::cout << "Detected image format cannot be read!" << std::endl;
-				return false;
+				return nullptr;
 			}
 		}
 
 		// If we're here we have a known image format, so load the image into a bitmap
 		FIBITMAP* bitmap{ FreeImage_Load(format, filepath.c_str()) };
+		if (!bitmap)
+			std::cout << "ImageLoader::Load could not decode: " << filepath << std::endl;
+
+		return bitmap;
+	}
 
-		// How many bits-per-pixel is the source image?
-		unsigned int bitsPerPixel{ FreeImage_GetBPP(bitmap) };
-				
-		// Grab size
-		m_width = FreeImage_GetWidth(bitmap);
-		m_height = FreeImage_GetHeight(bitmap);
+	// Writes the bitmap as tightly packed RGBA8 rows into destination. Returns false if the format cannot be converted.
+	bool ImageLoader::ConvertToRGBA(FIBITMAP* bitmap, BYTE* destination)
+	{
+		const unsigned int width{ FreeImage_GetWidth(bitmap) };
+		const unsigned int height{ FreeImage_GetHeight(bitmap) };
+		const unsigned int bitsPerPixel{ FreeImage_GetBPP(bitmap) };
+		const FREE_IMAGE_TYPE imageType{ FreeImage_GetImageType(bitmap) };
+		const size_t rowBytes{ (size_t)width * 4 };
 
-		// Convert our image to 32 bits (8 bits per channel, Red/Green/Blue/Alpha) if not already
-		FIBITMAP* bitmap32{ nullptr };
-		if (bitsPerPixel == 32)
+		if (imageType == FIT_BITMAP && bitsPerPixel == 32)
 		{
-			bitmap32 = bitmap;
+			// Note: FreeImage was rebuilt with RGBA order so 32 bit rows are already what GL wants
+			for (unsigned int y = 0; y < height; y++)
+				memcpy(destination + y * rowBytes, FreeImage_GetScanLine(bitmap, y), rowBytes);
+			return true;
 		}
-		else
+
+		if (imageType == FIT_BITMAP && bitsPerPixel == 24)
 		{
-			bitmap32 = FreeImage_ConvertTo32Bits(bitmap);
-			if (!bitmap32)
+			// The most common case (JPEG, BMP) expanded here rather than through a temporary 32 bit bitmap
+			for (unsigned int y = 0; y < height; y++)
 			{
-				const FREE_IMAGE_TYPE image_type{ FreeImage_GetImageType(bitmap) };
-				if (image_type == FIT_UINT16)
+				const BYTE* source{ FreeImage_GetScanLine(bitmap, y) };
+				BYTE* row{ destination + y * rowBytes };
+				for (unsigned int x = 0; x < width; x++, source += 3, row += 4)
 				{
-					// FreeImage seems to have an issue converting 16 bit grey scale images to 32 so handling this manually
-					UINT16* textureData{ (UINT16*)FreeImage_GetBits(bitmap) };
-
-					m_data = new GLubyte[(size_t)m_width * (size_t)m_height * 4];
-					size_t count{ 0 };
-					for (size_t i = 0; i < (size_t)m_width * (size_t)m_height * 4; i += 4)
-					{
-						BYTE asByte = (BYTE)(textureData[count++] / 256.0f);
-						m_data[i] = m_data[i + 1] = m_data[i + 2] = asByte;
-						m_data[i + 3] = 255;
-					}
-
-					return true;
+					row[0] = source[FI_RGBA_RED];
+					row[1] = source[FI_RGBA_GREEN];
+					row[2] = source[FI_RGBA_BLUE];
+					row[3] = 255;
 				}
+			}
+			return true;
+		}
+
+		if (imageType == FIT_UINT16)
+		{
+			// FreeImage seems to have an issue converting 16 bit grey scale images to 32 so handling this manually
+			for (unsigned int y = 0; y < height; y++)
+			{
+				const UINT16* source{ (const UINT16*)FreeImage_GetScanLine(bitmap, y) };
+				BYTE* row{ destination + y * rowBytes };
+				for (unsigned int x = 0; x < width; x++, row += 4)
+				{
+					row[0] = row[1] = row[2] = (BYTE)(source[x] / 256.0f);
+					row[3] = 255;
+				}
+			}
+			return true;
+		}
+
+		// Palettised and other bit depths go through FreeImage's own conversion
+		std::unique_ptr<FIBITMAP, BitmapDeleter> bitmap32{ FreeImage_ConvertTo32Bits(bitmap) };
+		if (!bitmap32)
+		{
+			std::cout << "ImageLoader::Load failed to convert image to 32 bits" << std::endl;
+			return false;
+		}
+
+		return ConvertToRGBA(bitmap32.get(), destination);
+	}
+
+	// Attempt to load an image from the file and path provided. Returns false on error.
+	bool ImageLoader::Load(const std::string& filepath)
+	{
+		// Loading again replaces the previous image
+		Release();
+		m_width = 0;
+		m_height = 0;
+
+		std::unique_ptr<FIBITMAP, BitmapDeleter> bitmap{ Decode(filepath) };
+		if (!bitmap)
+			return false;
+
+		m_width = FreeImage_GetWidth(bitmap.get());
+		m_height = FreeImage_GetHeight(bitmap.get());
 
-				std::cout << "ImageLoader::Load failed to convert image to 32 bits" << std::endl;
+		// Already 32 bits per pixel so the decoded bits are used as they are, no copy
+		if (FreeImage_GetImageType(bitmap.get()) == FIT_BITMAP && FreeImage_GetBPP(bitmap.get()) == 32)
+		{
+			m_bitmap = std::move(bitmap);
+			return true;
+		}
+
+		// Otherwise converted once, the original is freed as soon as that is done
+		m_pixels.reset(new BYTE[(size_t)m_width * m_height * 4]);
+		if (!ConvertToRGBA(bitmap.get(), m_pixels.get()))
+		{
+			Release();
+			m_width = 0;
+			m_height = 0;
+			return false;
+		}
 
-				return false;
+		return true;
+	}
+
+	// Decodes into memory the caller provides once the size is known e.g. a pooled buffer or a mapped pixel buffer object.
+	// getDestination must return at least width * height * 4 bytes, or nullptr to give up. Only the size is kept.
+	bool ImageLoader::LoadInto(const std::string& filepath, const std::function<BYTE*(int width, int height)>& getDestination)
+	{
+		Release();
+		m_width = 0;
+		m_height = 0;
+
+		std::unique_ptr<FIBITMAP, BitmapDeleter> bitmap{ Decode(filepath) };
+		if (!bitmap)
+			return false;
+
+		m_width = FreeImage_GetWidth(bitmap.get());
+		m_height = FreeImage_GetHeight(bitmap.get());
+
+		BYTE* destination{ getDestination(m_width, m_height) };
+		return destination && ConvertToRGBA(bitmap.get(), destination);
+	}
+
+	// Frees the pixels, the size is kept
+	void ImageLoader::Release()
+	{
+		m_bitmap.reset();
+		m_pixels.reset();
+	}
+
+	// Reverses the row order in place, FreeImage gives the bottom row first
+	void ImageLoader::FlipVertical()
+	{
+		BYTE* pixels{ GetData() };
+		if (!pixels)
+			return;
+
+		const size_t rowBytes{ (size_t)m_width * 4 };
+		for (int row = 0; row < m_height / 2; row++)
+			std::swap_ranges(pixels + row * rowBytes, pixels + (row + 1) * rowBytes, pixels + (m_height - 1 - row) * rowBytes);
+	}
+
+	// Turns a square image a quarter turn clockwise in place, seen with the first row at the top. Returns false if not square.
+	bool ImageLoader::RotateClockwise()
+	{
+		uint32_t* pixels{ (uint32_t*)GetData() };
+		if (!pixels || m_width != m_height)
+			return false;
+
+		// Each texel in the top left quarter swaps round with the three it turns into
+		const int n{ m_width };
+		for (int row = 0; row < n / 2; row++)
+		{
+			for (int column = 0; column < (n + 1) / 2; column++)
+			{
+				const uint32_t first{ pixels[row * n + column] };
+				pixels[row * n + column] = pixels[(n - 1 - column) * n + row];
+				pixels[(n - 1 - column) * n + row] = pixels[(n - 1 - row) * n + (n - 1 - column)];
+				pixels[(n - 1 - row) * n + (n - 1 - column)] = pixels[column * n + (n - 1 - row)];
+				pixels[column * n + (n - 1 - row)] = first;
 			}
-		}		
-
-		// Get a pointer to the texture data as an array of unsigned bytes.
-		// Note: At this point bitmap32 ALWAYS holds a 32-bit colour version of our image - so we get our data from that.
-		// Also, we don't need to delete or delete[] this textureData because it's not on the heap (so attempting to do
-		// so will cause a crash) - just let it go out of scope and the memory will be returned to the stack.
-		BYTE* textureData{ FreeImage_GetBits(bitmap32) };
-
-		m_data = new GLubyte[(size_t)m_width * (size_t)m_height * 1 * 4];
-
-		// Copy to mine, Note: Freeimage data format is GL_BGRA while I need GL_RGBA
-		// Iterate through the pixels, copying the data
-		// from 'pixels' to 'bits' except in RGBA format.		
-
-		//for (int pix = 0; pix < m_width * m_height; pix++)
-		//{
-		//	m_data[pix * 4 + 0] = textureData[pix * 4 + 2];	//r = 3
-		//	m_data[pix * 4 + 1] = textureData[pix * 4 + 1];	//g = 0
-		//	m_data[pix * 4 + 2] = textureData[pix * 4 + 0];	//b = 1
-		//	m_data[pix * 4 + 3] = textureData[pix * 4 + 3];	//a = 2
-		//}
-		
-		// 15/04/20: Rebuilt FreeImage with correct order so now RGBA so no need to convert = quicker :)
-		memcpy(m_data, textureData, (size_t)m_width * (size_t)m_height * 1 * 4);
-		
-		// Unload the 32-bit colour bitmap
-		FreeImage_Unload(bitmap32);
-
-		// If we had to do a conversion to 32-bit colour, then unload the original
-		// non-32-bit-colour version of the image data too. Otherwise, bitmap32 and
-		// bitmap point at the same data, and that data's already been free'd, so
-		// don't attempt to free it again! (or we'll crash).
-		if (bitsPerPixel != 32)
-			FreeImage_Unload(bitmap);
+		}
 
 		return true;
 	}
@@ -1,20 +1,32 @@
 #pragma once
 
 #include "ExternalLibraryHeaders.h"
+#include <functional>
+#include <memory>
 
 namespace Helpers
 {
 	// Helper utilising FreeImage to load images / textures
 	// Loaded format is guaranteed to be 32 bit RGBA layout
+	// 32 bit images are used straight from the decoded bitmap, others are converted once, so nothing is copied after decoding
 	class ImageLoader
 	{
 	private:
+		struct BitmapDeleter
+		{
+			void operator()(FIBITMAP* bitmap) const { FreeImage_Unload(bitmap); }
+		};
+
 		int m_width{ 0 };
 		int m_height{ 0 };
-		BYTE* m_data{ nullptr };
-	public:
-		~ImageLoader() { delete []m_data; }
 
+		// The pixels are the bits of the 32 bit bitmap, or owned here for formats FreeImage cannot convert
+		std::unique_ptr<FIBITMAP, BitmapDeleter> m_bitmap;
+		std::unique_ptr<BYTE[]> m_pixels;
+
+		static FIBITMAP* Decode(const std::string& filepath);
+		static bool ConvertToRGBA(FIBITMAP* bitmap, BYTE* destination);
+	public:
 		// Width in texels of the image
 		int Width() const { return m_width; }
 
@@ -24,8 +36,21 @@ namespace Helpers
 		// Attempt to load an image from the file and path provided. Returns false on error.
 		bool Load(const std::string& filepath);
 
+		// Decodes into memory the caller provides once the size is known e.g. a pooled buffer or a mapped pixel buffer object.
+		// getDestination must return at least width * height * 4 bytes, or nullptr to give up. Only the size is kept.
+		bool LoadInto(const std::string& filepath, const std::function<BYTE*(int width, int height)>& getDestination);
+
+		// Frees the pixels, the size is kept
+		void Release();
+
+		// Reverses the row order in place, FreeImage gives the bottom row first
+		void FlipVertical();
+
+		// Turns a square image a quarter turn clockwise in place, seen with the first row at the top. Returns false if not square.
+		bool RotateClockwise();
+
 		// Allows access to the raw bytes that make up the image laid out in RGBA format (8 bits per channel)
-		BYTE* GetData() const { return m_data; }
+		BYTE* GetData() const { return m_bitmap ? FreeImage_GetBits(m_bitmap.get()) : m_pixels.get(); }
 
 		// Returns a grey scale value at provided uv, useful for RMA textures
 		BYTE GetGreyValue(float u, float v) const;
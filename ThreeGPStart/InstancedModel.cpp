@@ -0,0 +1,118 @@
+#include "InstancedModel.h"
+#include "VertexFormat.h"
+#include "GLState.h"
+
+namespace Helpers
+{
+	InstancedModel::~InstancedModel()
+	{
+		for (Part& part : m_parts)
+		{
+			glDeleteVertexArrays(1, &part.vertexArray);
+			glDeleteBuffers(1, &part.vertexBuffer);
+			glDeleteBuffers(1, &part.elementBuffer);
+		}
+
+		if (m_instanceBuffer)
+			glDeleteBuffers(1, &m_instanceBuffer);
+		if (m_materialBuffer)
+			glDeleteBuffers(1, &m_materialBuffer);
+	}
+
+	// Uploads every mesh, returns false if there are none. The colours of each material go in materialTable if one is given,
+	// the table still needs uploading after.
+	bool InstancedModel::Create(const std::vector<Mesh>& meshes, const std::vector<Material>& materials, MaterialTable* materialTable)
+	{
+		if (meshes.empty() || !m_parts.empty())
+			return false;
+
+		// Identical materials share an entry
+		std::vector<uint32_t> materialIndices(materials.size(), 0);
+		if (materialTable)
+		{
+			for (size_t i = 0; i < materials.size(); i++)
+				materialIndices[i] = materialTable->Add(materials[i]);
+		}
+
+		glGenBuffers(1, &m_instanceBuffer);
+
+		// Every part's material up front so each VAO can point at its own
+		std::vector<GLuint> partMaterials;
+		for (const Mesh& mesh : meshes)
+			partMaterials.push_back(mesh.materialIndex < materialIndices.size() ? materialIndices[mesh.materialIndex] : 0);
+
+		glGenBuffers(1, &m_materialBuffer);
+		glBindBuffer(GL_ARRAY_BUFFER, m_materialBuffer);
+		glBufferData(GL_ARRAY_BUFFER, partMaterials.size() * sizeof(GLuint), partMaterials.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		for (const Mesh& mesh : meshes)
+		{
+			const InterleavedMesh packed{ BuildInterleavedMesh(mesh) };
+
+			Part part;
+			part.vertexArray = packed.CreateVAO(part.vertexBuffer, part.elementBuffer);
+			part.numElements = packed.numElements;
+			part.elementType = packed.elementType;
+			part.material = partMaterials[m_parts.size()];
+
+			// A mat4 attribute is four vec4 columns, each stepping once per instance rather than per vertex
+			GLState::Get().BindVertexArray(part.vertexArray);
+			glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+			for (GLuint column = 0; column < 4; column++)
+			{
+				const GLuint location{ KInstanceTransformLocation + column };
+				glEnableVertexAttribArray(location);
+				glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(column * sizeof(glm::vec4)));
+				glVertexAttribDivisor(location, 1);
+			}
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+			// Bound with a stride of 0 the attribute never steps, every vertex of every instance reads the part's material
+			glEnableVertexAttribArray(KInstanceMaterialLocation);
+			glVertexAttribIFormat(KInstanceMaterialLocation, 1, GL_UNSIGNED_INT, 0);
+			glVertexAttribBinding(KInstanceMaterialLocation, KInstanceMaterialLocation);
+			glBindVertexBuffer(KInstanceMaterialLocation, m_materialBuffer, m_parts.size() * sizeof(GLuint), 0);
+			GLState::Get().BindVertexArray(0);
+
+			m_parts.push_back(part);
+		}
+
+		return true;
+	}
+
+	// Streams this frame's transforms into the instance buffer, growing it when needed
+	void InstancedModel::Update(const glm::mat4* transforms, size_t count)
+	{
+		m_numInstances = count;
+		if (count == 0)
+			return;
+
+		glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+
+		// Orphan the old storage so the driver need not wait for last frame's draws to finish reading it
+		if (count > m_capacity)
+			m_capacity = std::max(count, m_capacity * 2);
+		glBufferData(GL_ARRAY_BUFFER, m_capacity * sizeof(glm::mat4), nullptr, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(glm::mat4), transforms);
+
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	// Draws every part once for each transform given to the last Update, the instanced program should already be bound
+	void InstancedModel::Draw() const
+	{
+		if (m_numInstances == 0)
+			return;
+
+		GLState& state{ GLState::Get() };
+		for (const Part& part : m_parts)
+		{
+			if (part.texture)
+				state.BindTexture(0, GL_TEXTURE_2D, part.texture);
+
+			state.BindVertexArray(part.vertexArray);
+			glDrawElementsInstanced(GL_TRIANGLES, part.numElements, part.elementType, (void*)0, (GLsizei)m_numInstances);
+		}
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "ExternalLibraryHeaders.h"
+#include "Mesh.h"
+#include "MaterialTable.h"
+
+namespace Helpers
+{
+	// A model drawn many times with one instanced draw per mesh. Every mesh's VAO also reads a per instance
+	// transform from one shared buffer that is refilled each frame, so N copies cost the same calls as one.
+	// Each VAO reads its mesh's material from a second buffer with a stride of 0, so every instance gets the same one
+	// without a uniform change between the draws.
+	class InstancedModel
+	{
+	public:
+		// The per instance transform takes four attribute slots, one per column, see the INSTANCED permutation of Data/Shaders/mesh_shader.vert
+		static constexpr GLuint KInstanceTransformLocation{ 3 };
+		static constexpr GLuint KInstanceMaterialLocation{ 7 };
+
+		struct Part
+		{
+			GLuint vertexArray{ 0 };
+			GLuint vertexBuffer{ 0 };
+			GLuint elementBuffer{ 0 };
+			GLuint numElements{ 0 };
+			GLenum elementType{ GL_UNSIGNED_INT };
+			GLuint texture{ 0 };
+
+			// Entry in the MaterialTable, 0 (the default) if none was given
+			uint32_t material{ 0 };
+		};
+	private:
+		std::vector<Part> m_parts;
+
+		GLuint m_instanceBuffer{ 0 };
+
+		// One MaterialTable entry per part
+		GLuint m_materialBuffer{ 0 };
+		size_t m_capacity{ 0 };
+		size_t m_numInstances{ 0 };
+	public:
+		InstancedModel() = default;
+		~InstancedModel();
+
+		InstancedModel(const InstancedModel&) = delete;
+		InstancedModel& operator=(const InstancedModel&) = delete;
+
+		// Uploads every mesh, returns false if there are none. The colours of each material go in materialTable if one is given,
+		// the table still needs uploading after.
+		bool Create(const std::vector<Mesh>& meshes, const std::vector<Material>& materials = {}, MaterialTable* materialTable = nullptr);
+
+		// Texture bound to unit 0 when the part is drawn, 0 leaves whatever is bound
+		void SetTexture(size_t part, GLuint texture) { m_parts[part].texture = texture; }
+
+		// Streams this frame's transforms into the instance buffer, growing it when needed
+		void Update(const glm::mat4* transforms, size_t count);
+
+		// Draws every part once for each transform given to the last Update, the instanced program should already be bound
+		void Draw() const;
+
+		const std::vector<Part>& GetParts() const { return m_parts; }
+		size_t NumInstances() const { return m_numInstances; }
+	};
+}
@@ -0,0 +1,58 @@
+#include "JobSystem.h"
+
+namespace Helpers
+{
+	// Pass 0 to use one worker per hardware thread (less one for the main thread)
+	JobSystem::JobSystem(size_t numWorkers)
+	{
+		if (numWorkers == 0)
+		{
+			const unsigned int hardwareThreads{ std::thread::hardware_concurrency() };
+			numWorkers = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+		}
+
+		m_workers.reserve(numWorkers);
+		for (size_t i = 0; i < numWorkers; i++)
+			m_workers.emplace_back(&JobSystem::WorkerLoop, this);
+	}
+
+	// Finishes any queued jobs then joins the workers
+	JobSystem::~JobSystem()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stopping = true;
+		}
+		m_jobAvailable.notify_all();
+
+		for (std::thread& worker : m_workers)
+			worker.join();
+	}
+
+	// Shared pool used by the helpers, created on first use
+	JobSystem& JobSystem::Get()
+	{
+		static JobSystem instance;
+		return instance;
+	}
+
+	void JobSystem::WorkerLoop()
+	{
+		for (;;)
+		{
+			std::function<void()> job;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_jobAvailable.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+
+				if (m_jobs.empty())
+					return;
+
+				job = std::move(m_jobs.front());
+				m_jobs.pop_front();
+			}
+
+			job();
+		}
+	}
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "ExternalLibraryHeaders.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <atomic>
+#include <deque>
+
+namespace Helpers
+{
+	// Simple pool of worker threads that runs queued jobs
+	// Note: jobs must not make OpenGL calls, the context belongs to the main thread
+	class JobSystem
+	{
+	private:
+		std::vector<std::thread> m_workers;
+		std::deque<std::function<void()>> m_jobs;
+		std::mutex m_mutex;
+		std::condition_variable m_jobAvailable;
+		bool m_stopping{ false };
+
+		void WorkerLoop();
+	public:
+		// Pass 0 to use one worker per hardware thread (less one for the main thread)
+		explicit JobSystem(size_t numWorkers = 0);
+		~JobSystem();
+
+		JobSystem(const JobSystem&) = delete;
+		JobSystem& operator=(const JobSystem&) = delete;
+
+		// Shared pool used by the helpers
+		static JobSystem& Get();
+
+		size_t NumWorkers() const { return m_workers.size(); }
+
+		// Queue a job to run on a worker, the future holds the result when done
+		template<typename F>
+		auto Submit(F&& job) -> std::future<decltype(job())>
+		{
+			using ResultType = decltype(job());
+			auto task = std::make_shared<std::packaged_task<ResultType()>>(std::forward<F>(job));
+			std::future<ResultType> result{ task->get_future() };
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_jobs.emplace_back([task]() { (*task)(); });
+			}
+			m_jobAvailable.notify_one();
+			return result;
+		}
+
+		// Splits [0, count) into blocks of grainSize and calls fn(begin, end) for each block across the workers
+		// The calling thread works through blocks too so this is safe to call from inside a job
+		template<typename F>
+		void ParallelFor(size_t count, size_t grainSize, F&& fn)
+		{
+			if (count == 0)
+				return;
+
+			grainSize = std::max<size_t>(grainSize, 1);
+			const size_t numBlocks{ (count + grainSize - 1) / grainSize };
+			if (numBlocks == 1 || m_workers.empty())
+			{
+				fn((size_t)0, count);
+				return;
+			}
+
+			struct SharedState
+			{
+				std::atomic<size_t> nextBlock{ 0 };
+				std::atomic<size_t> blocksDone{ 0 };
+				std::mutex mutex;
+				std::condition_variable finished;
+			};
+			auto state = std::make_shared<SharedState>();
+			auto* function = &fn;
+
+			auto runBlocks = [state, function, count, grainSize, numBlocks]()
+			{
+				size_t block;
+				while ((block = state->nextBlock.fetch_add(1)) < numBlocks)
+				{
+					const size_t begin{ block * grainSize };
+					(*function)(begin, std::min(begin + grainSize, count));
+
+					if (state->blocksDone.fetch_add(1) + 1 == numBlocks)
+					{
+						std::lock_guard<std::mutex> lock(state->mutex);
+						state->finished.notify_all();
+					}
+				}
+			};
+
+			const size_t numHelpers{ std::min(m_workers.size(), numBlocks - 1) };
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				for (size_t i = 0; i < numHelpers; i++)
+					m_jobs.emplace_back(runBlocks);
+			}
+			m_jobAvailable.notify_all();
+
+			runBlocks();
+
+			std::unique_lock<std::mutex> lock(state->mutex);
+			state->finished.wait(lock, [&state, numBlocks]() { return state->blocksDone.load() == numBlocks; });
+		}
+	};
+}
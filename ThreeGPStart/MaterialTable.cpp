@@ -0,0 +1,77 @@
+#include "MaterialTable.h"
+#include "Helper.h"
+
+namespace Helpers
+{
+	static_assert(sizeof(MaterialTable::GpuMaterial) == 64, "GpuMaterial must match the std430 struct in materials.glsl");
+
+	MaterialTable::MaterialTable()
+	{
+		// Without a specular colour, the Material default shines everywhere
+		Material matte;
+		matte.specularColour = glm::vec4(0.0f);
+		Add(matte);
+	}
+
+	MaterialTable::~MaterialTable()
+	{
+		if (m_buffer)
+			glDeleteBuffers(1, &m_buffer);
+	}
+
+	// Returns the material's index, shared with any identical material already added
+	uint32_t MaterialTable::Add(const Material& material)
+	{
+		GpuMaterial packed;
+		packed.diffuseColour = material.diffuseColour;
+		packed.ambientColour = material.ambientColour;
+		packed.emissiveColour = material.emissiveColour;
+		packed.specularColour = glm::vec4(glm::vec3(material.specularColour), material.specularFactor);
+
+		const uint64_t hash{ HashBytes(&packed, sizeof(packed)) };
+		const auto range{ m_lookup.equal_range(hash) };
+		for (auto entry = range.first; entry != range.second; ++entry)
+		{
+			if (memcmp(&m_materials[entry->second], &packed, sizeof(packed)) == 0)
+				return entry->second;
+		}
+
+		const uint32_t index{ (uint32_t)m_materials.size() };
+		m_materials.push_back(packed);
+		m_lookup.emplace(hash, index);
+		m_dirty = true;
+		return index;
+	}
+
+	// Copies the table to the GPU if anything was added since the last call
+	void MaterialTable::Upload()
+	{
+		if (!m_dirty)
+			return;
+
+		if (!m_buffer)
+			glGenBuffers(1, &m_buffer);
+
+		// Only grows, materials are added at load time so this is rare
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffer);
+		const size_t bytes{ m_materials.size() * sizeof(GpuMaterial) };
+		if (bytes > m_capacity)
+		{
+			glBufferData(GL_SHADER_STORAGE_BUFFER, bytes, m_materials.data(), GL_STATIC_DRAW);
+			m_capacity = bytes;
+		}
+		else
+		{
+			glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, bytes, m_materials.data());
+		}
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+		m_dirty = false;
+	}
+
+	// Binds the table to KBinding, once a frame before drawing
+	void MaterialTable::Bind() const
+	{
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, KBinding, m_buffer);
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "ExternalLibraryHeaders.h"
+#include "Mesh.h"
+#include <unordered_map>
+
+namespace Helpers
+{
+	// Every material's colours packed into one shader storage buffer at load time. Draws pick theirs with an index, so
+	// changing material is one integer rather than a uniform per colour, and a multi draw can mix materials.
+	// Identical materials share an entry. Entry 0 is the default, matte white with no emission, for draws without one.
+	class MaterialTable
+	{
+	public:
+		// Binding point of the table in the shaders, see Data/Shaders/Include/materials.glsl
+		static constexpr GLuint KBinding{ 1 };
+
+		// Matches the std430 Material struct in materials.glsl
+		struct GpuMaterial
+		{
+			glm::vec4 diffuseColour;
+			glm::vec4 ambientColour;
+			glm::vec4 emissiveColour;
+
+			// rgb is the colour, a the specular factor
+			glm::vec4 specularColour;
+		};
+	private:
+		std::vector<GpuMaterial> m_materials;
+
+		// Hash of the packed bytes to the entries with that hash
+		std::unordered_multimap<uint64_t, uint32_t> m_lookup;
+
+		GLuint m_buffer{ 0 };
+		size_t m_capacity{ 0 };
+		bool m_dirty{ true };
+	public:
+		MaterialTable();
+		~MaterialTable();
+
+		MaterialTable(const MaterialTable&) = delete;
+		MaterialTable& operator=(const MaterialTable&) = delete;
+
+		// Returns the material's index, shared with any identical material already added
+		uint32_t Add(const Material& material);
+
+		// Copies the table to the GPU if anything was added since the last call
+		void Upload();
+
+		// Binds the table to KBinding, once a frame before drawing
+		void Bind() const;
+
+		const GpuMaterial& Get(uint32_t index) const { return m_materials[index]; }
+		size_t NumMaterials() const { return m_materials.size(); }
+	};
+}
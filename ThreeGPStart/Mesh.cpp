@@ -72,7 +72,7 @@ namespace Helpers
 	}
 
 	// Load a 3D model form a provided file and path, return false on error
-	bool ModelLoader::LoadFromFile(const std::string& objFilename)
+	bool ModelLoader::LoadFromFile(const std::string& objFilename, bool useCache)
 	{
 		m_filename = objFilename;
 
@@ -101,6 +101,27 @@ namespace Helpers
 			aiProcess_GlobalScale |							// KD: Needed for FBX which uses cm rather than metres
 			0;
 
+		// KD: Need to scale down FBX which uses cm rather than metres
+		const bool isFbx{ objFilename.find(".fbx") != std::string::npos };
+		const float globalScale{ isFbx ? 0.01f : 1.0f };
+
+		// The cache is only valid for the exact source file bytes and import settings
+		const std::string cacheFilename{ objFilename + ".meshcache" };
+		uint64_t cacheKey{ 0 };
+		if (useCache)
+		{
+			MappedFile source;
+			if (source.Open(objFilename))
+			{
+				cacheKey = HashBytes(source.GetData(), source.Size());
+				cacheKey = HashBytes(&ppsteps, sizeof(ppsteps), cacheKey);
+				cacheKey = HashBytes(&globalScale, sizeof(globalScale), cacheKey);
+
+				if (LoadFromCache(cacheFilename, cacheKey))
+					return true;
+			}
+		}
+
 		// Create an instance of the Importer class
 		Assimp::Importer importer;
 
@@ -112,9 +133,8 @@ namespace Helpers
 		importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE, aiPrimitiveType_LINE | aiPrimitiveType_POINT);
 		importer.SetPropertyInteger(AI_CONFIG_GLOB_MEASURE_TIME, 1);
 
-		// KD: Need to scale down FBX which uses cm rather than metres
-		if (objFilename.find(".fbx")!=std::string::npos)
-			importer.SetPropertyFloat(AI_CONFIG_GLOBAL_SCALE_FACTOR_KEY, 0.01f);
+		if (isFbx)
+			importer.SetPropertyFloat(AI_CONFIG_GLOBAL_SCALE_FACTOR_KEY, globalScale);
 
 		const aiScene* scene = importer.ReadFile(objFilename.c_str(), ppsteps);
 
@@ -124,7 +144,14 @@ namespace Helpers
 			return false;
 		}
 
-		return PopulateFromAssimpScene(scene);
+		if (!PopulateFromAssimpScene(scene))
+			return false;
+
+		// Failing to write the cache is not an error, we just pay for ASSIMP again next time
+		if (cacheKey != 0 && !SaveToCache(cacheFilename, cacheKey))
+			std::cout << "Could not write mesh cache: " << cacheFilename << std::endl;
+
+		return true;
 	}
 
 	// Parse the ASSIMP data into our format
@@ -111,6 +111,10 @@ namespace Helpers
 
 		bool PopulateFromAssimpScene(const aiScene* scene);
 
+		// Binary mesh cache, see MeshCache.cpp
+		bool LoadFromCache(const std::string& cacheFilename, uint64_t cacheKey);
+		bool SaveToCache(const std::string& cacheFilename, uint64_t cacheKey) const;
+
 		// Recursive
 		Node* RecurseCreateNode(aiNode* node, Node* parent);
 		void RecurseDeleteNode(Node* node);
@@ -121,7 +125,8 @@ namespace Helpers
 		~ModelLoader() { RecurseDeleteNode(m_rootNode); }
 
 		// Load a 3D model form a provided file and path, return false on error
-		bool LoadFromFile(const std::string& objFilename);
+		// When useCache is set a binary copy is kept next to the model so later loads can skip ASSIMP
+		bool LoadFromFile(const std::string& objFilename, bool useCache = true);
 
 		// Retrieves the collection of mesh loaded from the 3D model
 		std::vector<Mesh>& GetMeshVector() { return m_meshVector; }
@@ -0,0 +1,330 @@
+#include "Mesh.h"
+#include <fstream>
+#include <filesystem>
+namespace fs = std::filesystem;
+
+/*
+	Binary mesh cache for ModelLoader
+
+	ASSIMP plus all the post processing steps is by far the slowest part of loading a model so after
+	the first load the result is written next to the source file as <model>.meshcache. On later loads
+	the cache is memory mapped and copied straight into the Mesh, Material and Node structures.
+
+	Layout (all values little endian, strings are length prefixed and padded to 4 bytes):
+		Header
+		Mesh	 x numMeshes	- name, counts, then the raw vertex / normal / uv / element arrays
+		Material x numMaterials	- texture filenames then the colours
+		Node	 x numNodes		- depth first, each node stores the index of its parent (-1 for the root)
+
+	The header key is a hash of the source file bytes and the import settings so editing the model or
+	changing the post processing steps invalidates the cache. Bump KMeshCacheVersion whenever the layout changes.
+*/
+
+namespace Helpers
+{
+	static constexpr uint32_t KMeshCacheMagic{ 0x4D504733 }; // "3GPM"
+	static constexpr uint32_t KMeshCacheVersion{ 1 };
+
+	struct MeshCacheHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t key;
+		uint32_t numMeshes;
+		uint32_t numMaterials;
+		uint32_t numNodes;
+		uint32_t padding;
+	};
+
+	struct MeshCacheMeshRecord
+	{
+		uint32_t numVertices;
+		uint32_t numNormals;
+		uint32_t numUVCoords;
+		uint32_t numElements;
+		uint32_t materialIndex;
+	};
+
+	struct MeshCacheMaterialRecord
+	{
+		glm::vec4 diffuseColour;
+		glm::vec4 ambientColour;
+		glm::vec4 emissiveColour;
+		glm::vec4 specularColour;
+		float specularFactor;
+	};
+
+	struct MeshCacheNodeRecord
+	{
+		int32_t parentIndex;
+		glm::mat4 transform;
+		uint32_t numMeshIndices;
+		uint32_t numTranslationKeys;
+		uint32_t numRotationKeys;
+		uint32_t numScaleKeys;
+	};
+
+	// Bounds checked reads from the mapped cache file
+	class MeshCacheReader
+	{
+	private:
+		const BYTE* m_pos;
+		const BYTE* m_end;
+	public:
+		MeshCacheReader(const BYTE* data, size_t size) : m_pos(data), m_end(data + size) {}
+
+		template<typename T>
+		bool Read(T& value)
+		{
+			if ((size_t)(m_end - m_pos) < sizeof(T))
+				return false;
+			memcpy(&value, m_pos, sizeof(T));
+			m_pos += sizeof(T);
+			return true;
+		}
+
+		template<typename T>
+		bool ReadArray(std::vector<T>& values, uint32_t count)
+		{
+			const size_t bytes{ sizeof(T) * count };
+			if ((size_t)(m_end - m_pos) < bytes)
+				return false;
+			values.resize(count);
+			if (bytes)
+				memcpy(values.data(), m_pos, bytes);
+			m_pos += bytes;
+			return true;
+		}
+
+		bool ReadString(std::string& value)
+		{
+			uint32_t length{ 0 };
+			if (!Read(length))
+				return false;
+			const size_t padded{ (length + 3u) & ~3u };
+			if ((size_t)(m_end - m_pos) < padded)
+				return false;
+			value.assign((const char*)m_pos, length);
+			m_pos += padded;
+			return true;
+		}
+	};
+
+	// Writer counterpart, matches the padding rules of the reader
+	class MeshCacheWriter
+	{
+	private:
+		std::ofstream& m_out;
+	public:
+		MeshCacheWriter(std::ofstream& out) : m_out(out) {}
+
+		template<typename T>
+		void Write(const T& value) { m_out.write((const char*)&value, sizeof(T)); }
+
+		template<typename T>
+		void WriteArray(const std::vector<T>& values)
+		{
+			if (!values.empty())
+				m_out.write((const char*)values.data(), sizeof(T) * values.size());
+		}
+
+		void WriteString(const std::string& value)
+		{
+			const uint32_t length{ (uint32_t)value.size() };
+			Write(length);
+			m_out.write(value.data(), length);
+
+			const char zeros[4]{ 0 };
+			m_out.write(zeros, ((length + 3u) & ~3u) - length);
+		}
+	};
+
+	// Flatten the node hierarchy depth first so parents are always written before their children
+	static void FlattenNodes(Node* node, int32_t parentIndex, std::vector<std::pair<Node*, int32_t>>& flattened)
+	{
+		if (!node)
+			return;
+
+		const int32_t myIndex{ (int32_t)flattened.size() };
+		flattened.emplace_back(node, parentIndex);
+
+		for (Node* child : node->childNodes)
+			FlattenNodes(child, myIndex, flattened);
+	}
+
+	// Try to fill this loader from a cache file. Returns false if missing, stale or corrupt.
+	bool ModelLoader::LoadFromCache(const std::string& cacheFilename, uint64_t cacheKey)
+	{
+		MappedFile file;
+		if (!file.Open(cacheFilename))
+			return false;
+
+		MeshCacheReader reader(file.GetData(), file.Size());
+
+		MeshCacheHeader header;
+		if (!reader.Read(header) || header.magic != KMeshCacheMagic || header.version != KMeshCacheVersion || header.key != cacheKey)
+			return false;
+
+		std::vector<Mesh> meshes(header.numMeshes);
+		for (Mesh& mesh : meshes)
+		{
+			MeshCacheMeshRecord record;
+			if (!reader.ReadString(mesh.name) || !reader.Read(record) ||
+				!reader.ReadArray(mesh.vertices, record.numVertices) ||
+				!reader.ReadArray(mesh.normals, record.numNormals) ||
+				!reader.ReadArray(mesh.uvCoords, record.numUVCoords) ||
+				!reader.ReadArray(mesh.elements, record.numElements))
+				return false;
+
+			mesh.materialIndex = record.materialIndex;
+		}
+
+		std::vector<Material> materials(header.numMaterials);
+		for (Material& material : materials)
+		{
+			MeshCacheMaterialRecord record;
+			if (!reader.ReadString(material.diffuseTextureFilename) ||
+				!reader.ReadString(material.specularTextureFilename) ||
+				!reader.Read(record))
+				return false;
+
+			material.diffuseColour = record.diffuseColour;
+			material.ambientColour = record.ambientColour;
+			material.emissiveColour = record.emissiveColour;
+			material.specularColour = record.specularColour;
+			material.specularFactor = record.specularFactor;
+		}
+
+		std::vector<Node*> nodes;
+		nodes.reserve(header.numNodes);
+		bool nodesOK{ true };
+		for (uint32_t i = 0; i < header.numNodes && nodesOK; i++)
+		{
+			Node* node = new Node;
+			nodes.push_back(node);
+
+			MeshCacheNodeRecord record;
+			nodesOK = reader.ReadString(node->name) && reader.Read(record) &&
+				record.parentIndex < (int32_t)i &&
+				reader.ReadArray(node->meshIndices, record.numMeshIndices) &&
+				reader.ReadArray(node->translationAnimationKeys, record.numTranslationKeys) &&
+				reader.ReadArray(node->rotationAnimationKeys, record.numRotationKeys) &&
+				reader.ReadArray(node->scaleAnimationKeys, record.numScaleKeys);
+
+			if (!nodesOK)
+				break;
+
+			node->transform = record.transform;
+			if (record.parentIndex >= 0)
+			{
+				node->parentNode = nodes[record.parentIndex];
+				node->parentNode->childNodes.push_back(node);
+			}
+		}
+
+		if (!nodesOK)
+		{
+			// Children are linked into their parents so deleting the root is not enough for a partial tree
+			for (Node* node : nodes)
+				delete node;
+			return false;
+		}
+
+		m_meshVector = std::move(meshes);
+		m_materials = std::move(materials);
+		RecurseDeleteNode(m_rootNode);
+		m_rootNode = nodes.empty() ? nullptr : nodes[0];
+
+		std::cout << "Loaded OK (from cache)" << std::endl;
+
+		return true;
+	}
+
+	// Write the currently loaded model to a cache file. Returns false on error.
+	bool ModelLoader::SaveToCache(const std::string& cacheFilename, uint64_t cacheKey) const
+	{
+		std::vector<std::pair<Node*, int32_t>> nodes;
+		FlattenNodes(m_rootNode, -1, nodes);
+
+		// Write to a temporary first so a crash part way through never leaves a truncated cache behind
+		const std::string tempFilename{ cacheFilename + ".tmp" };
+		{
+			std::ofstream out(tempFilename, std::ios::binary | std::ios::trunc);
+			if (!out.is_open())
+				return false;
+
+			MeshCacheWriter writer(out);
+
+			MeshCacheHeader header{};
+			header.magic = KMeshCacheMagic;
+			header.version = KMeshCacheVersion;
+			header.key = cacheKey;
+			header.numMeshes = (uint32_t)m_meshVector.size();
+			header.numMaterials = (uint32_t)m_materials.size();
+			header.numNodes = (uint32_t)nodes.size();
+			writer.Write(header);
+
+			for (const Mesh& mesh : m_meshVector)
+			{
+				MeshCacheMeshRecord record;
+				record.numVertices = (uint32_t)mesh.vertices.size();
+				record.numNormals = (uint32_t)mesh.normals.size();
+				record.numUVCoords = (uint32_t)mesh.uvCoords.size();
+				record.numElements = (uint32_t)mesh.elements.size();
+				record.materialIndex = (uint32_t)mesh.materialIndex;
+
+				writer.WriteString(mesh.name);
+				writer.Write(record);
+				writer.WriteArray(mesh.vertices);
+				writer.WriteArray(mesh.normals);
+				writer.WriteArray(mesh.uvCoords);
+				writer.WriteArray(mesh.elements);
+			}
+
+			for (const Material& material : m_materials)
+			{
+				MeshCacheMaterialRecord record;
+				record.diffuseColour = material.diffuseColour;
+				record.ambientColour = material.ambientColour;
+				record.emissiveColour = material.emissiveColour;
+				record.specularColour = material.specularColour;
+				record.specularFactor = material.specularFactor;
+
+				writer.WriteString(material.diffuseTextureFilename);
+				writer.WriteString(material.specularTextureFilename);
+				writer.Write(record);
+			}
+
+			for (const auto& [node, parentIndex] : nodes)
+			{
+				MeshCacheNodeRecord record;
+				record.parentIndex = parentIndex;
+				record.transform = node->transform;
+				record.numMeshIndices = (uint32_t)node->meshIndices.size();
+				record.numTranslationKeys = (uint32_t)node->translationAnimationKeys.size();
+				record.numRotationKeys = (uint32_t)node->rotationAnimationKeys.size();
+				record.numScaleKeys = (uint32_t)node->scaleAnimationKeys.size();
+
+				writer.WriteString(node->name);
+				writer.Write(record);
+				writer.WriteArray(node->meshIndices);
+				writer.WriteArray(node->translationAnimationKeys);
+				writer.WriteArray(node->rotationAnimationKeys);
+				writer.WriteArray(node->scaleAnimationKeys);
+			}
+
+			if (!out.good())
+				return false;
+		}
+
+		std::error_code error;
+		fs::rename(tempFilename, cacheFilename, error);
+		if (error)
+		{
+			fs::remove(tempFilename, error);
+			return false;
+		}
+
+		return true;
+	}
+}
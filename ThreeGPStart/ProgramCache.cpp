@@ -0,0 +1,320 @@
+#include "ProgramCache.h"
+#include "Helper.h"
+#include <fstream>
+#include <iomanip>
+#include <filesystem>
+namespace fs = std::filesystem;
+
+/*
+	Program binary cache
+
+	Layout of each <vertex shader>+<fragment shader>[.<define set hash>].programcache file (little endian):
+		Header
+		The bytes from glGetProgramBinary, header.binarySize of them
+
+	The source hash is taken after preprocessing so it covers the includes and defines too. The driver hash covers
+	GL_VENDOR, GL_RENDERER and GL_VERSION as a driver update can change or reject the binary format. glProgramBinary
+	can still refuse a binary that matches, that is caught by its link status and the program built from source.
+	Bump KProgramCacheVersion whenever the layout changes.
+*/
+
+namespace Helpers
+{
+	static constexpr uint32_t KProgramCacheMagic{ 0x50504733 }; // "3GPP"
+	static constexpr uint32_t KProgramCacheVersion{ 1 };
+
+	struct ProgramCacheHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t sourceHash;
+		uint64_t driverHash;
+		uint32_t binaryFormat;
+		uint32_t binarySize;
+		double compileMs;
+	};
+
+	using Clock = std::chrono::high_resolution_clock;
+
+	static double MsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	static uint64_t HashString(const std::string& text, uint64_t seed)
+	{
+		// The length goes in too so moving text from one string to the next changes the hash
+		const uint64_t length{ text.size() };
+		return HashBytes(text.data(), text.size(), HashBytes(&length, sizeof(length), seed));
+	}
+
+	static std::string GLString(GLenum name)
+	{
+		const GLubyte* value{ glGetString(name) };
+		return value ? (const char*)value : "";
+	}
+
+	// Cache files go in folder, created if missing. Needs the GL context to be current. Without binary
+	// format support or a folder to write to every program is built from source. Returns false in that case.
+	bool ProgramCache::Open(const std::string& folder)
+	{
+		m_folder = folder;
+
+		GLint numFormats{ 0 };
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+		if (numFormats == 0)
+		{
+			std::cout << "The driver has no program binary formats, shaders will always be compiled" << std::endl;
+			return false;
+		}
+
+		std::error_code error;
+		fs::create_directories(folder, error);
+		if (!fs::is_directory(folder, error))
+		{
+			std::cout << "Could not create the program cache folder " << folder << ", shaders will always be compiled" << std::endl;
+			return false;
+		}
+
+		m_driverHash = HashString(GLString(GL_VENDOR), 0);
+		m_driverHash = HashString(GLString(GL_RENDERER), m_driverHash);
+		m_driverHash = HashString(GLString(GL_VERSION), m_driverHash);
+		m_supported = true;
+		return true;
+	}
+
+	// One file per pair of shaders and define set, fragment shaders are shared between programs
+	std::string ProgramCache::CachePath(const std::string& vsPath, const std::string& fsPath, const ShaderDefines& defines) const
+	{
+		std::string name{ fs::path(vsPath).stem().string() + "+" + fs::path(fsPath).stem().string() };
+		if (!defines.empty())
+		{
+			std::ostringstream hash;
+			hash << "." << std::hex << std::setw(16) << std::setfill('0') << HashString(DefinesKey(defines), 0);
+			name += hash.str();
+		}
+
+		return (fs::path(m_folder) / (name + ".programcache")).string();
+	}
+
+	// The file each source string number in a compiler message stands for
+	static void ReportSourceFiles(const PreprocessedShader& shader)
+	{
+		for (size_t i = 1; i < shader.files.size(); i++)
+			std::cout << "Source string " << i << " is " << shader.files[i] << std::endl;
+	}
+
+	// Returns 0 if the file is missing, out of date or the driver will not take the binary
+	GLuint ProgramCache::LoadBinary(const std::string& cachePath, uint64_t sourceHash, Timing& timing) const
+	{
+		MappedFile file;
+		if (!file.Open(cachePath))
+			return 0;
+
+		ProgramCacheHeader header{};
+		if (file.Size() < sizeof(header))
+			return 0;
+		memcpy(&header, file.GetData(), sizeof(header));
+
+		if (header.magic != KProgramCacheMagic || header.version != KProgramCacheVersion ||
+			file.Size() - sizeof(header) < header.binarySize)
+		{
+			std::cout << "Program cache file is damaged: " << cachePath << std::endl;
+			return 0;
+		}
+
+		if (header.sourceHash != sourceHash)
+		{
+			std::cout << "Shader sources changed since " << cachePath << " was written" << std::endl;
+			return 0;
+		}
+
+		if (header.driverHash != m_driverHash)
+		{
+			std::cout << "Graphics driver changed since " << cachePath << " was written" << std::endl;
+			return 0;
+		}
+
+		GLuint program{ glCreateProgram() };
+		glProgramBinary(program, header.binaryFormat, file.GetData() + sizeof(header), header.binarySize);
+
+		GLint linkStatus{ 0 };
+		glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+		if (linkStatus != GL_TRUE)
+		{
+			std::cout << "Graphics driver rejected " << cachePath << std::endl;
+			glDeleteProgram(program);
+			return 0;
+		}
+
+		timing.compileMs = header.compileMs;
+		return program;
+	}
+
+	void ProgramCache::SaveBinary(const std::string& cachePath, uint64_t sourceHash, GLuint program, double compileMs) const
+	{
+		GLint binarySize{ 0 };
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binarySize);
+		if (binarySize <= 0)
+			return;
+
+		std::vector<BYTE> binary(binarySize);
+		GLenum binaryFormat{ 0 };
+		glGetProgramBinary(program, binarySize, &binarySize, &binaryFormat, binary.data());
+
+		ProgramCacheHeader header{};
+		header.magic = KProgramCacheMagic;
+		header.version = KProgramCacheVersion;
+		header.sourceHash = sourceHash;
+		header.driverHash = m_driverHash;
+		header.binaryFormat = binaryFormat;
+		header.binarySize = (uint32_t)binarySize;
+		header.compileMs = compileMs;
+
+		std::ofstream file(cachePath, std::ios::binary);
+		file.write((const char*)&header, sizeof(header));
+		file.write((const char*)binary.data(), binarySize);
+		if (!file)
+			std::cout << "Could not write the program cache file " << cachePath << std::endl;
+	}
+
+	// Loads the program from the cache if it is current, otherwise compiles and links it and stores the result.
+	// Returns 0 if a shader is missing or fails to compile or link.
+	GLuint ProgramCache::CreateProgram(const std::string& vsPath, const std::string& fsPath, const ShaderDefines& defines)
+	{
+		const Clock::time_point start{ Clock::now() };
+
+		Timing timing;
+		timing.name = fs::path(vsPath).filename().string() + " + " + fs::path(fsPath).filename().string();
+		if (!defines.empty())
+			timing.name += " " + DefinesKey(defines);
+
+		// The sources are read either way, the hash needs them and a stale cache needs compiling
+		PreprocessedShader vsSource;
+		PreprocessedShader fsSource;
+		if (!PreprocessShader(vsPath, GL_VERTEX_SHADER, defines, vsSource) ||
+			!PreprocessShader(fsPath, GL_FRAGMENT_SHADER, defines, fsSource))
+			return 0;
+
+		const uint64_t sourceHash{ HashString(fsSource.source, HashString(vsSource.source, 0)) };
+		const std::string cachePath{ CachePath(vsPath, fsPath, defines) };
+
+		if (m_supported)
+		{
+			if (GLuint program{ LoadBinary(cachePath, sourceHash, timing) })
+			{
+				timing.ms = MsSince(start);
+				timing.fromCache = true;
+				m_timings.push_back(timing);
+				return program;
+			}
+		}
+
+		GLuint vertex_shader{ CompileShader(GL_VERTEX_SHADER, vsSource.source, vsPath) };
+		if (vertex_shader == 0)
+			ReportSourceFiles(vsSource);
+
+		GLuint fragment_shader{ CompileShader(GL_FRAGMENT_SHADER, fsSource.source, fsPath) };
+		if (fragment_shader == 0)
+			ReportSourceFiles(fsSource);
+
+		if (vertex_shader == 0 || fragment_shader == 0)
+		{
+			glDeleteShader(vertex_shader);
+			glDeleteShader(fragment_shader);
+			return 0;
+		}
+
+		GLuint program{ glCreateProgram() };
+		glAttachShader(program, vertex_shader);
+		glAttachShader(program, fragment_shader);
+
+		// Without the hint some drivers do not keep the binary around to hand back
+		if (m_supported)
+			glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+		const bool linked{ LinkProgramShaders(program) };
+		glDeleteShader(vertex_shader);
+		glDeleteShader(fragment_shader);
+		if (!linked)
+		{
+			glDeleteProgram(program);
+			return 0;
+		}
+
+		timing.ms = MsSince(start);
+		timing.compileMs = timing.ms;
+		m_timings.push_back(timing);
+
+		if (m_supported)
+			SaveBinary(cachePath, sourceHash, program, timing.ms);
+
+		return program;
+	}
+
+	// The permutation of the shaders for defines, shared with other users of the same one. Returns nullptr on error.
+	std::shared_ptr<ShaderProgram> ProgramCache::GetProgram(const std::string& vsPath, const std::string& fsPath, const ShaderDefines& defines)
+	{
+		const std::string key{ vsPath + "|" + fsPath + "|" + DefinesKey(defines) };
+		const auto found{ m_programs.find(key) };
+		if (found != m_programs.end())
+		{
+			if (std::shared_ptr<ShaderProgram> existing{ found->second.lock() })
+			{
+				m_numShared++;
+				return existing;
+			}
+		}
+
+		std::shared_ptr<ShaderProgram> program{ std::make_shared<ShaderProgram>() };
+		if (!program->Attach(CreateProgram(vsPath, fsPath, defines)))
+			return nullptr;
+
+		m_programs[key] = program;
+		return program;
+	}
+
+	// Permutations alive, and requests served by one already built
+	size_t ProgramCache::NumPrograms() const
+	{
+		size_t count{ 0 };
+		for (const auto& entry : m_programs)
+		{
+			if (!entry.second.expired())
+				count++;
+		}
+
+		return count;
+	}
+
+	// Writes how each program was made and how long it took to the log
+	void ProgramCache::ReportTimings() const
+	{
+		std::cout << "\nProgram creation timings (ms)" << std::endl;
+		std::cout << std::left << std::setw(56) << "Program" << std::right
+			<< std::setw(10) << "Source" << std::setw(10) << "Compile" << std::setw(10) << "Cached" << std::endl;
+
+		double coldMs{ 0 };
+		double warmMs{ 0 };
+		size_t numCached{ 0 };
+		for (const Timing& timing : m_timings)
+		{
+			std::cout << std::left << std::setw(56) << timing.name << std::right << std::fixed << std::setprecision(2)
+				<< std::setw(10) << (timing.fromCache ? "cache" : "compile") << std::setw(10) << timing.compileMs;
+			if (timing.fromCache)
+				std::cout << std::setw(10) << timing.ms;
+			std::cout << std::endl;
+
+			// Compile times from the cache files say what this run would have cost without them
+			coldMs += timing.compileMs;
+			warmMs += timing.ms;
+			if (timing.fromCache)
+				numCached++;
+		}
+
+		std::cout << numCached << " of " << m_timings.size() << " programs from the cache, " << warmMs << " ms";
+		if (numCached > 0)
+			std::cout << " against " << coldMs << " ms compiling";
+		std::cout << std::endl;
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "ExternalLibraryHeaders.h"
+#include "ShaderPreprocessor.h"
+#include "ShaderProgram.h"
+#include <unordered_map>
+
+namespace Helpers
+{
+	// Keeps the driver's linked binary of each program on disk so later runs skip compiling and linking the GLSL.
+	// A cache file is only used when both the shader sources and the driver (vendor, renderer and version) match the
+	// ones it was made with, otherwise the program is built from source and the file rewritten.
+	// Shaders go through PreprocessShader, so each define set is its own branch free program with its own cache file.
+	// Programs in use are shared by file paths and define set, only weak references are kept.
+	class ProgramCache
+	{
+	public:
+		// How one program was made, for the startup log
+		struct Timing
+		{
+			std::string name;
+			double ms{ 0 };
+			bool fromCache{ false };
+
+			// How long building from source took when the cache file was written, 0 if not known
+			double compileMs{ 0 };
+		};
+	private:
+		std::string m_folder;
+		uint64_t m_driverHash{ 0 };
+		bool m_supported{ false };
+		std::vector<Timing> m_timings;
+		std::unordered_map<std::string, std::weak_ptr<ShaderProgram>> m_programs;
+		size_t m_numShared{ 0 };
+
+		std::string CachePath(const std::string& vsPath, const std::string& fsPath, const ShaderDefines& defines) const;
+		GLuint LoadBinary(const std::string& cachePath, uint64_t sourceHash, Timing& timing) const;
+		void SaveBinary(const std::string& cachePath, uint64_t sourceHash, GLuint program, double compileMs) const;
+	public:
+		// Cache files go in folder, created if missing. Needs the GL context to be current. Without binary
+		// format support or a folder to write to every program is built from source. Returns false in that case.
+		bool Open(const std::string& folder);
+
+		// Loads the program from the cache if it is current, otherwise compiles and links it and stores the result.
+		// Returns 0 if a shader is missing or fails to compile or link.
+		GLuint CreateProgram(const std::string& vsPath, const std::string& fsPath, const ShaderDefines& defines = {});
+
+		// The permutation of the shaders for defines, shared with other users of the same one. Returns nullptr on error.
+		std::shared_ptr<ShaderProgram> GetProgram(const std::string& vsPath, const std::string& fsPath, const ShaderDefines& defines = {});
+
+		// Writes how each program was made and how long it took to the log
+		void ReportTimings() const;
+
+		const std::vector<Timing>& GetTimings() const { return m_timings; }
+
+		// Permutations alive, and requests served by one already built
+		size_t NumPrograms() const;
+		size_t NumShared() const { return m_numShared; }
+	};
+}
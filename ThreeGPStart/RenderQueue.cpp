@@ -0,0 +1,174 @@
+#include "RenderQueue.h"
+#include "GLState.h"
+
+namespace Helpers
+{
+	// Key layout from the top bit down. Transparent swaps depth (inverted for back to front) in ahead of program and texture.
+	//   layer 4 | program 12 | texture 16 | depth 24 | unused 8
+	//   layer 4 | back to front depth 24 | program 12 | texture 16 | unused 8
+	static constexpr int KLayerShift{ 60 };
+	static constexpr int KProgramShift{ 48 };
+	static constexpr int KTextureShift{ 32 };
+	static constexpr int KDepthShift{ 8 };
+	static constexpr int KTransparentDepthShift{ 36 };
+	static constexpr int KTransparentProgramShift{ 24 };
+	static constexpr int KTransparentTextureShift{ 8 };
+	static constexpr uint64_t KProgramMask{ 0xFFF };
+	static constexpr uint64_t KTextureMask{ 0xFFFF };
+	static constexpr uint64_t KDepthMax{ 0xFFFFFF };
+
+	// Empties the queue ready for the next frame, keeping the memory
+	void RenderQueue::Clear()
+	{
+		m_commands.clear();
+		m_transforms.clear();
+		m_sorted.clear();
+	}
+
+	// Returns the index to put in Command::transform
+	uint32_t RenderQueue::AddTransform(const glm::mat4& transform)
+	{
+		m_transforms.push_back(transform);
+		return (uint32_t)(m_transforms.size() - 1);
+	}
+
+	// Records a draw, depth is the distance from the camera
+	void RenderQueue::Submit(const Command& command, RenderLayer layer, float depth)
+	{
+		const GLuint program{ command.program ? command.program->GetId() : 0 };
+		m_sorted.push_back({ MakeKey(layer, program, command.texture, depth), (uint32_t)m_commands.size() });
+		m_commands.push_back(command);
+	}
+
+	// Builds the sort key. Program and texture only use their low bits, clashes just make the order a little less tidy.
+	uint64_t RenderQueue::MakeKey(RenderLayer layer, GLuint program, GLuint texture, float depth) const
+	{
+		const float normalisedDepth{ glm::clamp(depth / m_maxDepth, 0.0f, 1.0f) };
+		uint64_t depthBits{ (uint64_t)(normalisedDepth * KDepthMax) };
+
+		uint64_t key{ (uint64_t)(layer & 0xF) << KLayerShift };
+		if (layer == KLayerTransparent)
+		{
+			// Back to front, and depth before state as blending order matters more than state changes
+			depthBits = KDepthMax - depthBits;
+			key |= depthBits << KTransparentDepthShift;
+			key |= ((uint64_t)program & KProgramMask) << KTransparentProgramShift;
+			key |= ((uint64_t)texture & KTextureMask) << KTransparentTextureShift;
+		}
+		else
+		{
+			key |= ((uint64_t)program & KProgramMask) << KProgramShift;
+			key |= ((uint64_t)texture & KTextureMask) << KTextureShift;
+			key |= depthBits << KDepthShift;
+		}
+
+		return key;
+	}
+
+	// Radix sorts the commands by key, eight bits a pass from the lowest byte up.
+	// Passes where every key has the same byte are skipped, which with the unused low byte is always at least one.
+	void RenderQueue::Sort()
+	{
+		const size_t count{ m_sorted.size() };
+		if (count < 2)
+			return;
+
+		m_sortScratch.resize(count);
+		SortItem* source{ m_sorted.data() };
+		SortItem* destination{ m_sortScratch.data() };
+
+		// Count every byte in one go so the passes that would do nothing can be spotted up front
+		std::vector<size_t> histograms(8 * 256, 0);
+		for (size_t i = 0; i < count; i++)
+		{
+			const uint64_t key{ source[i].key };
+			for (int byte = 0; byte < 8; byte++)
+				histograms[byte * 256 + ((key >> (byte * 8)) & 0xFF)]++;
+		}
+
+		for (int byte = 0; byte < 8; byte++)
+		{
+			size_t* histogram{ histograms.data() + byte * 256 };
+			if (histogram[(source[0].key >> (byte * 8)) & 0xFF] == count)
+				continue;
+
+			// Turn the counts into where each bucket starts
+			size_t offset{ 0 };
+			for (int bucket = 0; bucket < 256; bucket++)
+			{
+				const size_t bucketCount{ histogram[bucket] };
+				histogram[bucket] = offset;
+				offset += bucketCount;
+			}
+
+			for (size_t i = 0; i < count; i++)
+				destination[histogram[(source[i].key >> (byte * 8)) & 0xFF]++] = source[i];
+
+			std::swap(source, destination);
+		}
+
+		// An odd number of passes leaves the result in the scratch buffer
+		if (source != m_sorted.data())
+			m_sorted.swap(m_sortScratch);
+	}
+
+	// Dispatches to OpenGL through GLState, only changing the program, texture and vertex array when they differ
+	void RenderQueue::Execute()
+	{
+		m_stats = Stats();
+
+		GLState& state{ GLState::Get() };
+		const ShaderProgram* currentProgram{ nullptr };
+		GLuint currentTexture{ 0xFFFFFFFF };
+		GLenum currentTextureTarget{ GL_TEXTURE_2D };
+		GLuint currentVertexArray{ 0xFFFFFFFF };
+
+		Dispatch([&](const Command& command)
+			{
+				if (command.program != currentProgram)
+				{
+					command.program->Use();
+					currentProgram = command.program;
+					m_stats.programChanges++;
+				}
+
+				if (command.texture != currentTexture || command.textureTarget != currentTextureTarget)
+				{
+					state.BindTexture(0, command.textureTarget, command.texture);
+					currentTexture = command.texture;
+					currentTextureTarget = command.textureTarget;
+					m_stats.textureChanges++;
+				}
+
+				if (command.transform != KNoTransform)
+					command.program->Set("model_xform", m_transforms[command.transform]);
+
+				state.DepthMask(command.depthWrite ? GL_TRUE : GL_FALSE);
+
+				if (command.customDraw)
+				{
+					command.customDraw(command.context, command.argument);
+
+					// Custom draws bind their own vertex array and may bind textures
+					currentVertexArray = 0xFFFFFFFF;
+					currentTexture = 0xFFFFFFFF;
+				}
+				else
+				{
+					if (command.vertexArray != currentVertexArray)
+					{
+						state.BindVertexArray(command.vertexArray);
+						currentVertexArray = command.vertexArray;
+						m_stats.vertexArrayChanges++;
+					}
+
+					// The material rides in the base instance, it has no instanced attributes to offset
+					glDrawElementsInstancedBaseInstance(GL_TRIANGLES, command.numElements, command.elementType, (void*)0, 1, command.material);
+				}
+
+				m_stats.draws++;
+			});
+
+		state.DepthMask(GL_TRUE);
+	}
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "ExternalLibraryHeaders.h"
+#include "ShaderProgram.h"
+
+namespace Helpers
+{
+	// Layers are drawn in this order, whatever else is in the sort key.
+	// The sky follows the opaques so it is only shaded where they left the depth buffer clear.
+	enum RenderLayer : uint8_t
+	{
+		KLayerOpaque,
+		KLayerSky,
+		KLayerTransparent,
+		KLayerOverlay
+	};
+
+	// Draws are recorded into the queue as small commands, each with a 64 bit sort key, then sorted and executed
+	// in key order. The key puts the layer first then, for everything but transparent, program then texture then
+	// depth front to back, so draws sharing state end up next to each other. Transparent draws sort back to front.
+	class RenderQueue
+	{
+	public:
+		// Drawn instead of glDrawElements when set, for things like Terrain that issue their own draws.
+		// Passed the command's context and argument.
+		using CustomDraw = void (*)(void* context, size_t argument);
+
+		// Command::transform for draws that supply their own transforms, model_xform is left alone
+		static constexpr uint32_t KNoTransform{ 0xFFFFFFFF };
+
+		struct Command
+		{
+			ShaderProgram* program{ nullptr };
+			GLuint vertexArray{ 0 };
+			GLuint texture{ 0 };
+			GLenum textureTarget{ GL_TEXTURE_2D };
+			GLenum elementType{ GL_UNSIGNED_INT };
+			GLsizei numElements{ 0 };
+
+			// Index into the transforms added with AddTransform, set as model_xform
+			uint32_t transform{ KNoTransform };
+
+			// Entry in the MaterialTable, drawn as the base instance of a one instance draw so no uniform changes.
+			// Custom draws supply their own, the mesh shader reads 0 (plain white) from a draw without a base instance.
+			uint32_t material{ 0 };
+			bool depthWrite{ true };
+
+			CustomDraw customDraw{ nullptr };
+			void* context{ nullptr };
+			size_t argument{ 0 };
+		};
+
+		// Number of state changes made by the last Execute
+		struct Stats
+		{
+			size_t draws{ 0 };
+			size_t programChanges{ 0 };
+			size_t textureChanges{ 0 };
+			size_t vertexArrayChanges{ 0 };
+		};
+	private:
+		struct SortItem
+		{
+			uint64_t key;
+			uint32_t command;
+		};
+
+		std::vector<Command> m_commands;
+		std::vector<glm::mat4> m_transforms;
+		std::vector<SortItem> m_sorted;
+		std::vector<SortItem> m_sortScratch;
+
+		// Depths are mapped from 0 to this into the key
+		float m_maxDepth{ 40000.0f };
+
+		Stats m_stats;
+	public:
+		// Empties the queue ready for the next frame, keeping the memory
+		void Clear();
+
+		// Depth is the distance from the camera, anything beyond maxDepth sorts as if it were at maxDepth
+		void SetMaxDepth(float maxDepth) { m_maxDepth = maxDepth; }
+
+		// Returns the index to put in Command::transform
+		uint32_t AddTransform(const glm::mat4& transform);
+		const glm::mat4& GetTransform(uint32_t index) const { return m_transforms[index]; }
+
+		// Records a draw, depth is the distance from the camera
+		void Submit(const Command& command, RenderLayer layer, float depth);
+
+		// Builds the sort key. Program and texture only use their low bits, clashes just make the order a little less tidy.
+		uint64_t MakeKey(RenderLayer layer, GLuint program, GLuint texture, float depth) const;
+
+		// Radix sorts the commands by key
+		void Sort();
+
+		// Calls execute(command) for every command in sorted order
+		template<typename F>
+		void Dispatch(F&& execute) const
+		{
+			for (const SortItem& item : m_sorted)
+				execute(m_commands[item.command]);
+		}
+
+		// Dispatches to OpenGL through GLState, only changing the program, texture and vertex array when they differ
+		void Execute();
+
+		size_t Size() const { return m_commands.size(); }
+		const Stats& GetStats() const { return m_stats; }
+
+		// Keys in execution order, for checking the sort
+		uint64_t GetSortedKey(size_t i) const { return m_sorted[i].key; }
+	};
+}
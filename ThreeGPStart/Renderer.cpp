@@ -1,6 +1,12 @@
 #include "Renderer.h"
 #include "Camera.h"
 #include "ImageLoader.h"
+#include "AssetLoader.h"
+#include "VertexFormat.h"
+#include "GLState.h"
+#include "TerrainBuilder.h"
+#include "FractalNoise.h"
+#include <random>
 
 Renderer::Renderer()
 {
@@ -10,9 +16,15 @@ Renderer::Renderer()
 // On exit must clean up any OpenGL resources e.g. the program, the buffers
 Renderer::~Renderer()
 {
-	// TODO: clean up any memory used including OpenGL objects via glDelete* calls
-	glDeleteProgram(m_program);
-	glDeleteBuffers(1, &m_VAO);
+	// The cube is the only geometry not owned by a helper
+	glDeleteVertexArrays(1, &c_VAO);
+	glDeleteBuffers(1, &c_positionsVBO);
+	glDeleteBuffers(1, &c_coloursVBO);
+	glDeleteBuffers(1, &c_elementsEBO);
+
+	// The programs are deleted by Helpers::ShaderProgram
+	// Models are freed when the last reference goes, this one is the only user of the jeep
+	m_jeep.reset();
 }
 
 // Use IMGUI for a simple on screen GUI
@@ -29,56 +41,143 @@ void Renderer::DefineGUI()
 
 	ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
 
-	ImGui::End();
-}
+	ImGui::Text("GL state calls %zu, skipped as redundant %zu", Helpers::GLState::Get().NumIssued(), Helpers::GLState::Get().NumSkipped());
+	size_t uniformUploads{ 0 };
+	size_t uniformsSkipped{ 0 };
+	for (const Helpers::ShaderProgram* program : { m_program.get(), m_programcube.get(), m_programSky.get(), m_programInstanced.get(),
+		m_programArena.get() })
+	{
+		uniformUploads += program->NumUploads();
+		uniformsSkipped += program->NumSkipped();
+	}
+	ImGui::Text("Uniform uploads %zu, skipped as unchanged %zu", uniformUploads, uniformsSkipped);
+	ImGui::Text("Frame uniform buffer waits %zu", m_frameUniforms.NumWaits());
 
-// Load, compile and link the shaders and create a program object to host them
-GLuint Renderer::CreateProgram(std::string vsPath, std::string fsPath)
-{
-	// Create a new program (returns a unqiue id)
-	GLuint program = glCreateProgram();
+	const Helpers::RenderQueue::Stats& queueStats{ m_queue.GetStats() };
+	ImGui::Text("Draws %zu, program changes %zu, texture changes %zu", queueStats.draws, queueStats.programChanges, queueStats.textureChanges);
 
-	// Load and create vertex and fragment shaders
-	GLuint vertex_shader{ Helpers::LoadAndCompileShader(GL_VERTEX_SHADER, vsPath) };
-	GLuint fragment_shader{ Helpers::LoadAndCompileShader(GL_FRAGMENT_SHADER, fsPath) };
-	if (vertex_shader == 0 || fragment_shader == 0)
-		return false;
+	ImGui::Text("GPU models %zu, loads shared %zu", m_models.NumModels(), m_models.NumReused());
+	ImGui::Text("Static multi draws %zu covering %zu meshes", m_arena.NumCalls(), m_arena.NumDraws());
+	ImGui::Text("Materials %zu", m_materials.NumMaterials());
+	ImGui::Text("Shader permutations %zu, requests shared %zu", m_programCache.NumPrograms(), m_programCache.NumShared());
 
-	// Attach the vertex shader to this program (copies it)
-	glAttachShader(program, vertex_shader);
+	const Helpers::TextureManager::Stats textureStats{ m_textures.GetStats() };
+	ImGui::Text("Textures %zu using %.1f MB, loads shared %zu", textureStats.numTextures, textureStats.gpuBytes / (1024.0 * 1024.0),
+		textureStats.numShared);
+	if (ImGui::CollapsingHeader("Textures"))
+	{
+		for (const std::shared_ptr<Helpers::Texture>& texture : m_textures.GetTextures())
+			ImGui::Text("%s %d x %d x %d, %.2f MB, %ld users", texture->GetName().c_str(), texture->Width(), texture->Height(),
+				texture->Layers(), texture->GpuBytes() / (1024.0 * 1024.0), texture.use_count() - 1);
+	}
+	const Helpers::TextureStreamer::Stats& streamStats{ m_streamer.GetStats() };
+	ImGui::Text("Streaming %zu textures, %zu levels %.2f MB this frame, ring %.1f MB in use, waited for space %zu", streamStats.numStreaming,
+		streamStats.numLevelsUploaded, streamStats.bytesUploaded / (1024.0 * 1024.0), streamStats.ringBytesInUse / (1024.0 * 1024.0),
+		streamStats.numRingFull);
+
+	// A set is decoded the first time it is picked, after that switching is just a different texture
+	const std::vector<Helpers::SkySet>& skySets{ m_skybox.GetSets() };
+	if (!skySets.empty() && ImGui::BeginCombo("Sky", skySets[m_skybox.GetCurrent()].name.c_str()))
+	{
+		for (size_t i = 0; i < skySets.size(); i++)
+		{
+			if (ImGui::Selectable(skySets[i].name.c_str(), i == m_skybox.GetCurrent()))
+				m_skybox.Select(i, m_textures);
+		}
+		ImGui::EndCombo();
+	}
 
-	// The attibute location 0 maps to the input stream "vertex_position" in the vertex shader
-	// Not needed if you use (location=0) in the vertex shader itself
-	//glBindAttribLocation(m_program, 0, "vertex_position");
+	ImGui::Checkbox("Instanced apples", &m_instancing);
+	ImGui::SliderInt("Apples", &m_numApples, 0, KMaxApples);
+	ImGui::Text("Render CPU time %.3f ms", m_renderCpuMs);
 
-	// Attach the fragment shader (copies it)
-	glAttachShader(program, fragment_shader);
+	ImGui::SliderInt("Lights", &m_numLights, 0, KMaxLights);
+	ImGui::Checkbox("Show lights shaded per pixel", &m_showLightCount);
+	ImGui::Text("Light binning %.3f ms, %zu light indices, buffer waits %zu", m_lights.BinMs(), m_lights.GetIndices().size(),
+		m_lights.NumWaits());
 
-	// Done with the originals of these as we have made copies
-	glDeleteShader(vertex_shader);
-	glDeleteShader(fragment_shader);
+	ImGui::Checkbox("Terrain frustum culling", &m_terrain.CullingEnabled());
+	ImGui::Checkbox("Terrain LOD", &m_terrain.LodEnabled());
+	ImGui::SliderFloat("LOD distance", &m_terrain.LodDistance(), 1000.0f, 20000.0f);
+	ImGui::Text("Terrain chunks %zu / %zu, triangles %zu", m_terrain.NumVisibleChunks(), m_terrain.NumChunks(), m_terrain.NumTrianglesSubmitted());
 
-	// Link the shaders, checking for errors
-	if (!Helpers::LinkProgramShaders(program))
-		return 0;
+	if (ImGui::CollapsingHeader("Load timings"))
+	{
+		ImGui::Text("Total %.2f ms", m_loadTotalMs);
+		for (const Helpers::AssetLoader::Timing& timing : m_loadTimings)
+			ImGui::Text("%s queued %.2f load %.2f upload %.2f ms", timing.filepath.c_str(), timing.queuedMs, timing.loadMs, timing.uploadMs);
+	}
 
-	return program;
+	ImGui::End();
 }
-float Noise(int x, int y)
+
+// Milliseconds since start, used to time the upload of loaded assets
+static double MsSince(Helpers::AssetLoader::Clock::time_point start)
 {
-	int n = x + y * 57;
-	n = (n >> 13) ^ n;
-	int nn = (n * (n * n * 60493 + 19990303) + 1376312589) & 0x7fffffff;
-	return 1.0f - ((float)nn / 1073741924.0f);
+	return std::chrono::duration<double, std::milli>(Helpers::AssetLoader::Clock::now() - start).count();
 }
 
+static const std::string KJeepModel{ "Data\\Models\\Jeep\\jeep.obj" };
+static const std::string KTerrainTexture{ "Data\\Textures\\grass11.bmp" };
+static const std::string KAppleTexture{ "Data\\Models\\Apple\\2.jpg" };
+static const std::string KMeshVertexShader{ "Data\\Shaders\\mesh_shader.vert" };
+static const std::string KMeshFragmentShader{ "Data\\Shaders\\mesh_shader.frag" };
+
+// Cube map faces in GL order +X, -X, +Y, -Y, +Z, -Z, matched up from how each skybox.x lays its faces out.
+// The Clouds, Hills and Mountains floors are stored turned a quarter from the rest.
+static const std::vector<Helpers::SkySet> KSkySets
+{
+	{ "Clouds", "Data\\Models\\Sky\\Clouds",
+		{ "SkyBox_Right.tga", "SkyBox_Left.tga", "SkyBox_Top.tga", "SkyBox_Bottom.tga", "SkyBox_Front.tga", "SkyBox_Back.tga" },
+		{ false, false, false, true, false, false } },
+	{ "Hills", "Data\\Models\\Sky\\Hills",
+		{ "right.JPG", "left.JPG", "top.JPG", "bottom.JPG", "front.JPG", "back.JPG" },
+		{ false, false, false, true, false, false } },
+	{ "Mars", "Data\\Models\\Sky\\Mars",
+		{ "Mar_R.dds", "Mar_L.dds", "Mar_U.dds", "Mar_D.dds", "Mar_B.dds", "Mar_F.dds" } },
+	{ "Mountains", "Data\\Models\\Sky\\Mountains",
+		{ "2.jpg", "4.jpg", "6.jpg", "5.jpg", "1.jpg", "3.jpg" },
+		{ false, false, false, true, false, false } }
+};
+static constexpr size_t KFirstSkySet{ 3 };
+
 // Load / create geometry into OpenGL buffers	
 bool Renderer::InitialiseGeometry()
 {
-	// Load and compile shaders into m_program
-	m_program = CreateProgram("Data/Shaders/vertex_shader.vert", "Data/Shaders/fragment_shader.frag");
+	// Programs built on an earlier run are loaded as binaries instead of compiled
+	m_programCache.Open("Data\\Shaders\\Cache");
+
+	// Textured and lit meshes with the transform in model_xform, the mesh shaders' other permutations are built from the same files
+	m_program = m_programCache.GetProgram(KMeshVertexShader, KMeshFragmentShader, { { "LIT", "1" } });
+
+	// Vertex coloured for the cube
+	m_programcube = m_programCache.GetProgram(KMeshVertexShader, KMeshFragmentShader, { { "VERTEX_COLOUR", "1" } });
+
+	// Instanced models, the transform is a per instance vertex attribute
+	m_programInstanced = m_programCache.GetProgram(KMeshVertexShader, KMeshFragmentShader, { { "INSTANCED", "1" }, { "LIT", "1" } });
+
+	// Static mesh arena multi draws, the transform and material of each draw come from its draw data
+	m_programArena = m_programCache.GetProgram(KMeshVertexShader, KMeshFragmentShader, { { "ARENA", "1" }, { "LIT", "1" } });
 
-	m_programcube = CreateProgram("Data/Shaders/cubevertex_shader.vert", "Data/Shaders/cubefragment_shader.frag");
+	// Full screen sky, the direction for each pixel comes from the inverse of the view and projection
+	m_programSky = m_programCache.GetProgram("Data\\Shaders\\skyvertex_shader.vert", "Data\\Shaders\\skyfragment_shader.frag");
+
+	if (!m_program || !m_programcube || !m_programInstanced || !m_programArena || !m_programSky)
+		return false;
+
+	// Camera values shared by every program, see Include/camera.glsl
+	if (!m_frameUniforms.Create())
+		return false;
+
+	m_programCache.ReportTimings();
+
+	// Large textures stream in over the first frames rather than holding up the load, 64 MB in flight and 8 MB a frame
+	m_streamer.Create(64 * 1024 * 1024, 8 * 1024 * 1024);
+
+	// Kick off the file loads on the worker pool, the cube and terrain are generated while they decode
+	Helpers::AssetLoader assets;
+	const size_t jeepModelId{ assets.RequestModel(KJeepModel) };
+	const size_t appleModelId{ assets.RequestModel("Data\\Models\\Apple\\apple.obj") };
 
 	//Cube
 	glm::vec3 CubeCorners[8] =
@@ -236,15 +335,13 @@ bool Renderer::InitialiseGeometry()
 		You can look back to last week for examples
 	*/
 
-	GLuint positionsVBO;
-	glGenBuffers(1, &positionsVBO);
-	glBindBuffer(GL_ARRAY_BUFFER, positionsVBO);
+	glGenBuffers(1, &c_positionsVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, c_positionsVBO);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * verts.size(), verts.data(), GL_STATIC_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-	GLuint coloursVBO;
-	glGenBuffers(1, &coloursVBO);
-	glBindBuffer(GL_ARRAY_BUFFER, coloursVBO);
+	glGenBuffers(1, &c_coloursVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, c_coloursVBO);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * colours.size(), colours.data(), GL_STATIC_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
@@ -256,9 +353,8 @@ bool Renderer::InitialiseGeometry()
 		Store the number of elements in the member variable m_numElements
 	*/
 
-	GLuint ElementsEBO;
-	glGenBuffers(1, &ElementsEBO);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ElementsEBO);
+	glGenBuffers(1, &c_elementsEBO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, c_elementsEBO);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * elements.size(), elements.data(), GL_STATIC_DRAW);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
@@ -272,8 +368,8 @@ bool Renderer::InitialiseGeometry()
 
 
 	glGenVertexArrays(1, &c_VAO);
-	glBindVertexArray(c_VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, positionsVBO);
+	Helpers::GLState::Get().BindVertexArray(c_VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, c_positionsVBO);
 	glEnableVertexAttribArray(0);
 	glVertexAttribPointer(
 		0,
@@ -283,7 +379,7 @@ bool Renderer::InitialiseGeometry()
 		0,
 		(void*)0
 	);
-	glBindBuffer(GL_ARRAY_BUFFER, coloursVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, c_coloursVBO);
 	glEnableVertexAttribArray(1);
 	glVertexAttribPointer(
 		1,
@@ -293,89 +389,13 @@ bool Renderer::InitialiseGeometry()
 		0,
 		(void*)0
 	);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ElementsEBO);
-	glBindVertexArray(0);
-
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, c_elementsEBO);
+	Helpers::GLState::Get().BindVertexArray(0);
 
 
-	// Load in the jeep
-	Helpers::ModelLoader loader;
-	if (!loader.LoadFromFile("Data\\Models\\Jeep\\jeep.obj"))
-		return false;
-
-	// Now we can loop through all the mesh in the loaded model:
-	Helpers::ImageLoader texture;
-	if (texture.Load("Data\\Models\\Jeep\\jeep_army.jpg"))
-	{
-		glGenTextures(1, &tex);
-		glBindTexture(GL_TEXTURE_2D, tex);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, texture.Width(), texture.Height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, texture.GetData());
-		glGenerateMipmap(GL_TEXTURE_2D);
-	}
-	else
-	{
-		MessageBox(NULL, L"Texture not found", L"Error", MB_OK | MB_ICONEXCLAMATION);
-		return false;
-	}
-
-	for (const Helpers::Mesh& mesh : loader.GetMeshVector())
-	{
-		m_numElements = mesh.elements.size();
-
-		GLuint meshVBO;
-		glGenBuffers(1, &meshVBO);
-		glBindBuffer(GL_ARRAY_BUFFER, meshVBO);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * mesh.vertices.size(), mesh.vertices.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-		GLuint normalsVBO;
-		glGenBuffers(1, &normalsVBO);
-		glBindBuffer(GL_ARRAY_BUFFER, normalsVBO);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * mesh.normals.size(), mesh.normals.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-		GLuint texcoordsVBO;
-		glGenBuffers(1, &texcoordsVBO);
-		glBindBuffer(GL_ARRAY_BUFFER, texcoordsVBO);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec2) * mesh.uvCoords.size(), mesh.uvCoords.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-		GLuint meshElementsEBO;
-		glGenBuffers(1, &meshElementsEBO);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshElementsEBO);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * mesh.elements.size(), mesh.elements.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
-		std::vector<glm::vec3> verts;
-		std::vector<GLuint> elements;
-		std::vector<glm::vec3> colours;
-
-		glGenVertexArrays(1, &m_VAO);
-		glBindVertexArray(m_VAO);
-
-		glBindBuffer(GL_ARRAY_BUFFER, meshVBO);
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
-
-		glBindBuffer(GL_ARRAY_BUFFER, normalsVBO);
-		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
-
-		glBindBuffer(GL_ARRAY_BUFFER, texcoordsVBO);
-		glEnableVertexAttribArray(2);
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
-
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshElementsEBO);
-		glBindVertexArray(0);
 
-	}
 		//Terrain
 		std::vector<glm::vec3 > tervertices;
-		std::vector<GLuint> terelements;
 		std::vector<glm::vec3 > ternormals;
 		std::vector<glm::vec2 > tertexture;
 
@@ -386,414 +406,335 @@ bool Renderer::InitialiseGeometry()
 		int numVertX = numCellX + 1;
 		int numVertZ = numCellZ + 1;
 
-		//Helpers::ImageLoader HeightMap;
-		//if (!HeightMap.Load("data\Heightmaps\\curvy.gif"))
-		//{
-		//	for (int i = 0; i < numVertX; i++)
-		//	{
-		//		for (int j = 0; j < numVertZ; j++)
-		//		{
-		//			tervertices.push_back(glm::vec3(i * 8, 0, j * 8));
-		//			tertexture.push_back(glm::vec2(j / numCellZ, i / numCellX));
-		//			ternormals.push_back(glm::vec3(0, 0, 0));
-
-		//		}
-		//	}
-		//}
-		//else
-		//{
-		//	float vertexXtoImage = ((float)HeightMap.Width() - 1) / numVertX;
-		//	float vertexZtoImage = ((float)HeightMap.Height() - 1) / numVertZ;
-
-		//	BYTE* imageData = HeightMap.GetData();
-
-		//	for (size_t x = 0; x < numVertX; x++)
-		//	{
-		//		for (size_t z = 0; z < numVertZ; z++)
-		//		{
-		//			int imagex = vertexXtoImage * (numVertX - x);
-		//			int imagez = vertexZtoImage * z;
-
-		//			size_t offset = ((size_t)imagex + (size_t)imagez * HeightMap.Width()) * 4;
-		//			BYTE height = imageData[offset];
-
-		//			tervertices.push_back(glm::vec3(x * 8, (float)height, z * 8));
-		//			tertexture.push_back(glm::vec2(x / numCellZ, z / numCellX));
-		//			ternormals.push_back(glm::vec3(0, 0, 0));
-		//		}
-		//	}
-		//}
-
-
-		for (int i = 0; i < numVertX; i++)
+		// Heights come from fractal noise, one value per vertex, or from the heightmap resampled to fit the grid
+		Helpers::TerrainBuilder terrainBuilder;
+		float heightScale{ 600.0f };
+		if (NoiseGen)
 		{
-			for (int j = 0; j < numVertZ; j++)
-			{
-				tervertices.push_back(glm::vec3(i * 100, 0, j * 150));
-				ternormals.push_back({ 0,1,0 });
-
-				tertexture.push_back({ ((float)i / numVertZ) * 40, ((float)j / numVertX) *40 });
-			}
+			std::vector<float> heights;
+			Helpers::FractalNoise(Helpers::NoiseSettings()).FillGrid(Helpers::KNoiseWarped, numVertX, numVertZ, heights);
+			if (!terrainBuilder.SetHeights(numVertX, numVertZ, std::move(heights)))
+				return false;
 		}
-
-		for (int cellZ = 0; cellZ < numCellZ; cellZ++)
+		else
 		{
-			for (int cellX = 0; cellX < numCellX; cellX++)
-			{
-				int startVertIndex = (cellZ * numVertX) + cellX;
-				if (Swap)
-				{
-					terelements.push_back(startVertIndex);
-					terelements.push_back(startVertIndex + 1);
-					terelements.push_back(startVertIndex + numVertX);
-
-					terelements.push_back(startVertIndex + 1);
-					terelements.push_back(startVertIndex + numVertX + 1);
-					terelements.push_back(startVertIndex + numVertX);
-				}
-				else
-				{
-					terelements.push_back(startVertIndex);
-					terelements.push_back(startVertIndex + 1);
-					terelements.push_back(startVertIndex + numVertX + 1);
-
-					terelements.push_back(startVertIndex);
-					terelements.push_back(startVertIndex + numVertX + 1);
-					terelements.push_back(startVertIndex + numVertX);
-				}
-				Swap = !Swap;
-			}
-			Swap = !Swap;
+			Helpers::ImageLoader heightmap;
+			if (!heightmap.Load("Data\\Heightmaps\\3gp_heightmap.bmp") || !terrainBuilder.SetHeightmap(heightmap))
+				return false;
+			heightScale = 5000.0f;
+		}
 
+		if (!terrainBuilder.Build(numVertX, numVertZ, glm::vec2(100.0f, 150.0f), heightScale, 40.0f, tervertices, ternormals, tertexture))
+			return false;
+
+		// Split into chunks so only the ones in view get drawn
+		if (!m_terrain.Create(tervertices, ternormals, tertexture, numVertX, numVertZ))
+			return false;
+
+		// Scatter apples over the terrain, each sat on a vertex with a random turn and size
+		std::mt19937 random{ 42 };
+		std::uniform_int_distribution<size_t> vertexChoice{ 0, tervertices.size() - 1 };
+		std::uniform_real_distribution<float> turnChoice{ 0.0f, glm::two_pi<float>() };
+		std::uniform_real_distribution<float> sizeChoice{ 2.0f, 5.0f };
+		m_appleTransforms.resize(KMaxApples);
+		for (glm::mat4& transform : m_appleTransforms)
+		{
+			transform = glm::translate(glm::mat4(1.0f), tervertices[vertexChoice(random)]);
+			transform = glm::rotate(transform, turnChoice(random), glm::vec3(0, 1, 0));
+			transform = glm::scale(transform, glm::vec3(sizeChoice(random)));
 		}
-		if (NoiseGen)
+
+		// Lights hovering over the terrain, one in four a spot light shining down
+		std::uniform_real_distribution<float> unitChoice{ 0.0f, 1.0f };
+		m_lightList.resize(KMaxLights);
+		for (size_t i = 0; i < m_lightList.size(); i++)
 		{
-			for (int i = 0; i < numVertZ; i++)
+			Helpers::Light& light{ m_lightList[i] };
+			light.position = tervertices[vertexChoice(random)] + glm::vec3(0.0f, 30.0f + unitChoice(random) * 90.0f, 0.0f);
+			light.range = 300.0f + unitChoice(random) * 600.0f;
+			light.colour = glm::normalize(glm::vec3(unitChoice(random), unitChoice(random), unitChoice(random)) + 0.2f);
+			light.intensity = 2.0f + unitChoice(random) * 2.0f;
+			if (i % 4 == 0)
 			{
-				for (int j = 0; j < numVertX; j++)
-				{
-					NoiseVal = Noise(i, j);
-					NoiseVal = NoiseVal + 1.00001f / 2;
-					glm::vec3 NoiseVec = tervertices[Index];
-					
-					NoiseVal = NoiseVal * 50.0f;
-					
-
-					NoiseVec.y = NoiseVec.y + NoiseVal;
-					tervertices[Index] = NoiseVec;
-					Index++;
-				}
+				light.range *= 1.5f;
+				light.direction = glm::normalize(glm::vec3(unitChoice(random) - 0.5f, -2.0f, unitChoice(random) - 0.5f));
+				light.cosInner = std::cos(glm::radians(25.0f));
+				light.cosOuter = std::cos(glm::radians(35.0f));
 			}
 		}
 
-		GLuint terpositionsVBO;
-		glGenBuffers(1, &terpositionsVBO);
-		glBindBuffer(GL_ARRAY_BUFFER, terpositionsVBO);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * tervertices.size(), tervertices.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-		GLuint terElementsEBO;
-		glGenBuffers(1, &terElementsEBO);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, terElementsEBO);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * terelements.size(), terelements.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
-		GLuint ternormalsVBO;
-		glGenBuffers(1, &ternormalsVBO);
-		glBindBuffer(GL_ARRAY_BUFFER, ternormalsVBO);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * ternormals.size(), ternormals.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-		GLuint tertexcoordsVBO;
-		glGenBuffers(1, &tertexcoordsVBO);
-		glBindBuffer(GL_ARRAY_BUFFER, tertexcoordsVBO);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec2) * tertexture.size(), tertexture.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-		t_numElements = terelements.size();
+	// Everything requested at the start should be ready now
+	assets.WaitAll();
 
-		glGenVertexArrays(1, &t_VAO);
-		glBindVertexArray(t_VAO);
-
-		glBindBuffer(GL_ARRAY_BUFFER, terpositionsVBO);
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0,3,GL_FLOAT,GL_FALSE,0,(void*)0);
-
-		glBindBuffer(GL_ARRAY_BUFFER, ternormalsVBO);
-		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+	// Load in the jeep, every mesh into the arena along with its material textures
+	Helpers::ModelLoader* loader{ assets.GetModel(jeepModelId) };
+	if (!loader)
+		return false;
 
-		glBindBuffer(GL_ARRAY_BUFFER, tertexcoordsVBO);
-		glEnableVertexAttribArray(2);
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+	Helpers::AssetLoader::Clock::time_point uploadStart{ Helpers::AssetLoader::Clock::now() };
+	m_jeep = m_models.Add(KJeepModel, *loader, m_textures, &m_streamer, &m_materials, &m_arena);
+	if (!m_jeep)
+		return false;
+	assets.AddUploadTime(jeepModelId, MsSince(uploadStart));
 
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, terElementsEBO);
-		glBindVertexArray(0);
+	// Parts sharing a texture share a bucket, so the jeep is one multi draw per texture
+	for (const Helpers::GpuModel::Part& part : m_jeep->GetParts())
+		m_jeepBuckets.push_back(m_arena.AddBucket(part.texture));
 
+	// Block compressed with a baked mip chain, the first run writes the bake
+	m_terrainTexture = m_textures.LoadCompressed(KTerrainTexture);
+	if (!m_terrainTexture)
+	{
+		MessageBox(NULL, L"Texture not found", L"Error", MB_OK | MB_ICONEXCLAMATION);
+		return false;
+	}
 
-		if (texture.Load("Data\\Textures\\grass11.bmp"))
-		{
-			glGenTextures(1, &t_tex);
-			glBindTexture(GL_TEXTURE_2D, t_tex);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, texture.Width(), texture.Height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, texture.GetData());
-			glGenerateMipmap(GL_TEXTURE_2D);
-		}
-		else
-		{
-			MessageBox(NULL, L"Texture not found", L"Error", MB_OK | MB_ICONEXCLAMATION);
+		//Apples
+		Helpers::ModelLoader* appleLoader{ assets.GetModel(appleModelId) };
+		if (!appleLoader)
 			return false;
-		}
-
-		for (glm::vec3& n : ternormals)
-			n = glm::vec3(0, 0, 0);
-
-		for (size_t index = 0; index < elements.size(); index += 3)
-		{
-			glm::vec3 v0{ tervertices[terelements[index]] };
-			glm::vec3 v1{ tervertices[terelements[index + 1]] };
-			glm::vec3 v2{ tervertices[terelements[index + 2]] };
 
-			glm::vec3 side1 = v1 - v0;
-			glm::vec3 side2 = v2 - v0;
+		uploadStart = Helpers::AssetLoader::Clock::now();
+		if (!m_apples.Create(appleLoader->GetMeshVector(), appleLoader->GetMaterialVector(), &m_materials))
+			return false;
+		assets.AddUploadTime(appleModelId, MsSince(uploadStart));
 
-			glm::vec3 TriNorm = glm::normalize(glm::cross(side1, side2));
+		m_appleTexture = m_textures.Stream(KAppleTexture, m_streamer);
 
-			ternormals[terelements[index]] += TriNorm;
-			ternormals[terelements[index + 1]] += TriNorm;
-			ternormals[terelements[index + 2]] += TriNorm;
-		}
+		for (size_t i = 0; i < m_apples.GetParts().size(); i++)
+			m_apples.SetTexture(i, m_appleTexture->GetId());
 
-		for (size_t normIndex = 0; normIndex < ternormals.size(); normIndex++)
+		// The same meshes in the arena too, for drawing the apples one by one
+		for (const Helpers::Mesh& mesh : appleLoader->GetMeshVector())
 		{
-			glm::normalize(ternormals[normIndex]);
+			m_appleMeshes.push_back(m_arena.AddMesh(mesh));
+			if (m_appleMeshes.back() == Helpers::StaticMeshArena::KInvalidMesh)
+				return false;
 		}
+		m_appleBucket = m_arena.AddBucket(m_appleTexture->GetId());
 
-		//Skybox
-		Helpers::ModelLoader Skyloader;
-		if (!Skyloader.LoadFromFile("Data\\Models\\Sky\\Mountains\\skybox.x"))
+		// Everything static has been added, one vertex buffer and one element buffer for all of it
+		if (!m_arena.Upload())
 			return false;
 
-		for (const Helpers::Mesh& mesh2 : Skyloader.GetMeshVector())
+		//Skybox, the other sets load when picked in the GUI
+		if (!m_skybox.Create(KSkySets, KFirstSkySet, m_textures))
 		{
-			//m_numElements = mesh2.elements.size();
-			Mesh newMesh;
-
-			GLuint SkyMeshVBO;
-			glGenBuffers(1, &SkyMeshVBO);
-			glBindBuffer(GL_ARRAY_BUFFER, SkyMeshVBO);
-			glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * mesh2.vertices.size(), mesh2.vertices.data(), GL_STATIC_DRAW);
-			glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-			GLuint SkyNormalsVBO;
-			glGenBuffers(1, &SkyNormalsVBO);
-			glBindBuffer(GL_ARRAY_BUFFER, SkyNormalsVBO);
-			glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * mesh2.normals.size(), mesh2.normals.data(), GL_STATIC_DRAW);
-			glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-			GLuint SkyTexcoordsVBO;
-			glGenBuffers(1, &SkyTexcoordsVBO);
-			glBindBuffer(GL_ARRAY_BUFFER, SkyTexcoordsVBO);
-			glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec2) * mesh2.uvCoords.size(), mesh2.uvCoords.data(), GL_STATIC_DRAW);
-			glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-			GLuint SkyMeshElementsEBO;
-			glGenBuffers(1, &SkyMeshElementsEBO);
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, SkyMeshElementsEBO);
-			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * mesh2.elements.size(), mesh2.elements.data(), GL_STATIC_DRAW);
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
-			newMesh.m_numElements = mesh2.elements.size();
-
-			glGenVertexArrays(1, &newMesh.VAO);
-			glBindVertexArray(newMesh.VAO);
-
-			glBindBuffer(GL_ARRAY_BUFFER, SkyMeshVBO);
-			glEnableVertexAttribArray(0);
-			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
-
-			glBindBuffer(GL_ARRAY_BUFFER, SkyNormalsVBO);
-			glEnableVertexAttribArray(1);
-			glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
-
-			glBindBuffer(GL_ARRAY_BUFFER, SkyTexcoordsVBO);
-			glEnableVertexAttribArray(2);
-			glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
-
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, SkyMeshElementsEBO);
-			glBindVertexArray(0);
+			MessageBox(NULL, L"Texture not found", L"Error", MB_OK | MB_ICONEXCLAMATION);
+			return false;
+		}
 
-			Skymodel.m_meshVector.emplace_back(newMesh);
+		// Every model's materials are in the table now, one upload covers them
+		m_materials.Upload();
 
-		}
-		m_modelVector.emplace_back(Skymodel);
+		// The CPU copies are no longer needed now they are in OpenGL buffers
+		assets.Clear();
+		assets.ReportTimings();
+		m_loadTimings.assign(assets.GetTimings().begin(), assets.GetTimings().end());
+		m_loadTotalMs = assets.GetTotalMs();
 
-		std::string facesCubemap[6] =
-		{
-			"Data\\Models\\Sky\\Mountains\\6.jpg",
-			"Data\\Models\\Sky\\Mountains\\3.jpg",
-			"Data\\Models\\Sky\\Mountains\\1.jpg",
-			"Data\\Models\\Sky\\Mountains\\2.jpg",
-			"Data\\Models\\Sky\\Mountains\\4.jpg",
-			"Data\\Models\\Sky\\Mountains\\5.jpg"
-		};
-
-		for (int i = 0; i < Skymodel.m_meshVector.size(); i++)
-		{
-			Helpers::ImageLoader SkyBox_Texture;
-			if (SkyBox_Texture.Load(facesCubemap[i]))
-			{
-				glGenTextures(1, &Skymodel.m_meshVector[i].Tex);
-				glBindTexture(GL_TEXTURE_2D, Skymodel.m_meshVector[i].Tex);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-				glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, SkyBox_Texture.Width(), SkyBox_Texture.Height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, SkyBox_Texture.GetData());
-				glGenerateMipmap(GL_TEXTURE_2D);
-			}
-		}
+		return true;
 }
 
 // Render the scene. Passed the delta time since last called.
 void Renderer::Render(const Helpers::Camera& camera, float deltaTime)
 {
+	// CPU time for the whole function, to compare instanced and individual draws
+	const Helpers::AssetLoader::Clock::time_point frameStart{ Helpers::AssetLoader::Clock::now() };
+
+	// All state changes go through the tracker so ones that change nothing are dropped
+	Helpers::GLState& state{ Helpers::GLState::Get() };
+	state.ResetCounters();
+
+	// Before anything draws so this frame samples what has arrived
+	m_streamer.Update();
+
 	// Configure pipeline settings
-	//glEnable(GL_DEPTH_TEST);
-	glEnable(GL_CULL_FACE);
+	state.Enable(GL_DEPTH_TEST);
+	state.Enable(GL_CULL_FACE);
 
 	// Wireframe mode controlled by ImGui
 	if (m_wireframe)
-		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+		state.PolygonMode(GL_LINE);
 	else
-		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+		state.PolygonMode(GL_FILL);
 
 	// Clear buffers from previous frame
 	//glClearColor(0.0f, 0.0f, 0.0f, 0.f);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 	// Compute viewport and projection matrix
-	GLint viewportSize[4];
-	glGetIntegerv(GL_VIEWPORT, viewportSize);
+	const glm::ivec4& viewportSize{ state.GetViewport() };
 	const float aspect_ratio = viewportSize[2] / (float)viewportSize[3];
 	glm::mat4 projection_xform = glm::perspective(glm::radians(45.0f), aspect_ratio, 1.0f, 40000.0f);
 
 	// Compute camera view matrix and combine with projection matrix for passing to shader
 	glm::mat4 view_xform = glm::lookAt(camera.GetPosition(), camera.GetPosition() + camera.GetLookVector(), camera.GetUpVector());
+	glm::mat4 combined_xform = projection_xform * view_xform;
 
-
-	// Use our program. Doing this enables the shaders we attached previously.
-	glUseProgram(m_program);
-
-	// Send the combined matrix to the shader in a uniform
-
-	glm::mat4 model_xform = glm::mat4(1);
-
-	// Uncomment all the lines below to rotate cube first round y then round x
-	//static float angle = 0;
-	//static bool rotateY = true;
-
-	//if (rotateY) // Rotate around y axis		
-	//	model_xform = glm::rotate(model_xform, angle, glm::vec3{ 0 ,1,0 });
-	//else // Rotate around x axis		
-	//	model_xform = glm::rotate(model_xform, angle, glm::vec3{ 1 ,0,0 });
-
-	//angle+=0.001f;
-	//if (angle > glm::two_pi<float>())
-	//{
-	//	angle = 0;
-	//	rotateY = !rotateY;
-	//}
-
-	glDepthMask(GL_FALSE);
-	//glDisable(GL_DEPTH_TEST);
-
-	//Skybox Render
-	glm::mat4 view_xform2 = glm::mat4(glm::mat3(view_xform));
-	glm::mat4 combined_xform2 = projection_xform * view_xform2;
-	GLuint combined_xform_id2 = glGetUniformLocation(m_program, "combined_xform");
-	glUniformMatrix4fv(combined_xform_id2, 1, GL_FALSE, glm::value_ptr(combined_xform2));
-	for (int i = 0; i < Skymodel.m_meshVector.size(); i++)
+	m_program->ResetCounters();
+	m_programcube->ResetCounters();
+	m_programSky->ResetCounters();
+	m_programInstanced->ResetCounters();
+	m_programArena->ResetCounters();
+
+	// The camera goes to every program in one write to the frame uniform block
+	m_frameUniforms.Update(view_xform, projection_xform, camera.GetPosition(), deltaTime);
+	m_materials.Bind();
+
+	// Binned against this frame's view so only the clusters each light touches list it
+	m_lights.Build(m_lightList.data(), (size_t)std::clamp(m_numLights, 0, KMaxLights), view_xform, projection_xform,
+		glm::ivec2(viewportSize[2], viewportSize[3]));
+	m_lights.Upload();
+	m_lights.Bind();
+	m_program->Set("show_light_count", m_showLightCount ? 1 : 0);
+	m_programInstanced->Set("show_light_count", m_showLightCount ? 1 : 0);
+	m_programArena->Set("show_light_count", m_showLightCount ? 1 : 0);
+
+	// Every draw with these programs samples texture unit 0, only uploaded the first frame as it never changes
+	m_program->Set("sampler_tex", 0);
+	m_programSky->Set("sampler_sky", 0);
+	m_programInstanced->Set("sampler_tex", 0);
+	m_programArena->Set("sampler_tex", 0);
+
+	// Record the frame's draws, they are sorted by layer then state before anything is drawn
+	const glm::vec3 cameraPosition{ camera.GetPosition() };
+	m_queue.Clear();
+	m_arena.BeginFrame();
+
+	//Jeep, an arena draw per mesh, parts the arena could not take are drawn on their own
 	{
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, Skymodel.m_meshVector[i].Tex);
-		glUniform1i(glGetUniformLocation(m_program, "sampelr_tex"), 0);
-		glBindVertexArray(Skymodel.m_meshVector[i].VAO);
-		glDrawElements(GL_TRIANGLES, Skymodel.m_meshVector[i].m_numElements, GL_UNSIGNED_INT, (void*)0);
+		const glm::vec3 position{ 1000.0f, 0.0f, 500.0f };
+		const glm::mat4 model_xform{ glm::translate(glm::mat4(1.0), position) };
+		uint32_t transform{ Helpers::RenderQueue::KNoTransform };
+		const std::vector<Helpers::GpuModel::Part>& parts{ m_jeep->GetParts() };
+		for (size_t i = 0; i < parts.size(); i++)
+		{
+			const Helpers::GpuModel::Part& part{ parts[i] };
+			if (part.arenaMesh != Helpers::StaticMeshArena::KInvalidMesh)
+			{
+				m_arena.AddDraw(m_jeepBuckets[i], part.arenaMesh, model_xform, part.material);
+				continue;
+			}
 
+			if (transform == Helpers::RenderQueue::KNoTransform)
+				transform = m_queue.AddTransform(model_xform);
+
+			Helpers::RenderQueue::Command command;
+			command.program = m_program.get();
+			command.vertexArray = part.vertexArray;
+			command.texture = part.texture;
+			command.elementType = part.elementType;
+			command.numElements = part.numElements;
+			command.transform = transform;
+			command.material = part.material;
+			m_queue.Submit(command, Helpers::KLayerOpaque, glm::distance(cameraPosition, position));
+		}
 	}
-	glDepthMask(GL_TRUE);
-	glEnable(GL_DEPTH_TEST);
-
-	//Jeep render
-	glm::mat4 combined_xform = projection_xform * view_xform;
-	GLuint combined_xform_id = glGetUniformLocation(m_program, "combined_xform");
-	glUniformMatrix4fv(combined_xform_id, 1, GL_FALSE, glm::value_ptr(combined_xform));
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, tex);
-	glUniform1i(glGetUniformLocation(m_program, "sampelr_tex"), 0);
 
-	model_xform = glm::translate(glm::mat4(1.0), glm::vec3{ 1000.0f, 0.0f, 500.0f });
-	 
-	// Send the model matrix to the shader in a uniform
-	GLuint model_xform_id = glGetUniformLocation(m_program, "model_xform");
-	glUniformMatrix4fv(model_xform_id, 1, GL_FALSE, glm::value_ptr(model_xform));
-
-	// Bind our VAO and render
-	glBindVertexArray(m_VAO);
-	glDrawElements(GL_TRIANGLES, m_numElements, GL_UNSIGNED_INT, (void*)0);
+	//Apples, either one instanced draw per mesh or an arena draw per mesh per apple to compare against
+	const size_t numApples{ (size_t)std::clamp(m_numApples, 0, KMaxApples) };
+	if (m_instancing)
+	{
+		m_apples.Update(m_appleTransforms.data(), numApples);
+
+		// Each mesh's VAO carries its material, so one command covers them all
+		Helpers::RenderQueue::Command command;
+		command.program = m_programInstanced.get();
+		command.texture = m_appleTexture->GetId();
+		command.customDraw = [](void* apples, size_t) { static_cast<const Helpers::InstancedModel*>(apples)->Draw(); };
+		command.context = &m_apples;
+		m_queue.Submit(command, Helpers::KLayerOpaque, 0.0f);
+	}
+	else
+	{
+		const std::vector<Helpers::InstancedModel::Part>& parts{ m_apples.GetParts() };
+		for (size_t i = 0; i < numApples; i++)
+		{
+			for (size_t part = 0; part < parts.size(); part++)
+				m_arena.AddDraw(m_appleBucket, m_appleMeshes[part], m_appleTransforms[i], parts[part].material);
+		}
+	}
 
+	// Every arena draw is recorded, one multi draw per texture bucket
+	m_arena.Flush();
+	for (size_t bucket = 0; bucket < m_arena.NumBuckets(); bucket++)
+	{
+		if (m_arena.NumDraws(bucket) == 0)
+			continue;
+
+		Helpers::RenderQueue::Command command;
+		command.program = m_programArena.get();
+		command.texture = m_arena.GetTexture(bucket);
+		command.customDraw = [](void* arena, size_t index) { static_cast<Helpers::StaticMeshArena*>(arena)->DrawBucket(index); };
+		command.context = &m_arena;
+		command.argument = bucket;
+		m_queue.Submit(command, Helpers::KLayerOpaque, 0.0f);
+	}
 
-	//Terrain Render
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, t_tex);
+	//Terrain, culled and LODs picked now, the chunks are drawn when the queue reaches it
+	{
+		m_terrain.Update(combined_xform, cameraPosition);
 
-	model_xform = glm::mat4(1.0);
-	glUniformMatrix4fv(model_xform_id, 1, GL_FALSE, glm::value_ptr(model_xform));
-	
-	//Bind vao and render
-	glBindVertexArray(t_VAO);
-	glDrawElements(GL_TRIANGLES, t_numElements, GL_UNSIGNED_INT, (void*)0);
+		Helpers::RenderQueue::Command command;
+		command.program = m_program.get();
+		command.texture = m_terrainTexture->GetId();
+		command.transform = m_queue.AddTransform(glm::mat4(1.0));
+		command.customDraw = [](void* terrain, size_t) { static_cast<const Helpers::Terrain*>(terrain)->Draw(); };
+		command.context = &m_terrain;
 
-	//Cube Render
+		// Usually underneath everything else so draw it last of the opaques, the depth test then rejects more of it
+		m_queue.Submit(command, Helpers::KLayerOpaque, 40000.0f);
+	}
 
-	glUseProgram(m_programcube);
-	combined_xform = projection_xform * view_xform;
+	//Cube
+	{
+		const glm::vec3 position{ 1000.0f, 500.0f, 500.0f };
+		glm::mat4 model_xform = glm::translate(glm::mat4(1), position);
+		model_xform = glm::scale(model_xform, glm::vec3{ 10.0f, 10.0f, 10.0f });
 
-	combined_xform_id = glGetUniformLocation(m_programcube, "combined_xform");
-	glUniformMatrix4fv(combined_xform_id, 1, GL_FALSE, glm::value_ptr(combined_xform));
+		//Cube rotation
+		static float angle = 0;
+		static bool rotateY = true;
 
-	model_xform = glm::mat4(1);
-	model_xform = glm::translate(model_xform, glm::vec3{ 1000.0f, 500.0f, 500.0f });
-	model_xform = glm::scale(model_xform, glm::vec3{ 10.0f, 10.0f, 10.0f });
+		if (rotateY) // Rotate around y axis
+			model_xform = glm::rotate(model_xform, angle, glm::vec3{ 0 ,1,0 });
+		else // Rotate around x axis
+			model_xform = glm::rotate(model_xform, angle, glm::vec3{ 1 ,0,0 });
 
-	//Cube rotation
-	static float angle = 0;
-	static bool rotateY = true;
+		angle+=0.001f;
+		if (angle > glm::two_pi<float>())
+		{
+			angle = 0;
+			rotateY = !rotateY;
+		}
 
-	if (rotateY) // Rotate around y axis		
-		model_xform = glm::rotate(model_xform, angle, glm::vec3{ 0 ,1,0 });
-	else // Rotate around x axis		
-		model_xform = glm::rotate(model_xform, angle, glm::vec3{ 1 ,0,0 });
+		Helpers::RenderQueue::Command command;
+		command.program = m_programcube.get();
+		command.vertexArray = c_VAO;
+		command.numElements = c_numElements;
+		command.transform = m_queue.AddTransform(model_xform);
+		m_queue.Submit(command, Helpers::KLayerOpaque, glm::distance(cameraPosition, position));
+	}
 
-	angle+=0.001f;
-	if (angle > glm::two_pi<float>())
+	//Skybox, after the opaques so only the pixels they left empty are shaded
 	{
-		angle = 0;
-		rotateY = !rotateY;
+		Helpers::RenderQueue::Command command;
+		command.program = m_programSky.get();
+		command.texture = m_skybox.GetTexture();
+		command.textureTarget = GL_TEXTURE_CUBE_MAP;
+		command.depthWrite = false;
+		command.customDraw = [](void* skybox, size_t) { static_cast<const Helpers::Skybox*>(skybox)->Draw(); };
+		command.context = &m_skybox;
+		m_queue.Submit(command, Helpers::KLayerSky, 0.0f);
 	}
-	
-	model_xform_id = glGetUniformLocation(m_programcube, "model_xform");
-	glUniformMatrix4fv(model_xform_id, 1, GL_FALSE, glm::value_ptr(model_xform));
-
-	glBindVertexArray(c_VAO);
-	glDrawElements(GL_TRIANGLES, c_numElements, GL_UNSIGNED_INT, (void*)0);
-
-
 
+	m_queue.Sort();
+	m_queue.Execute();
+	m_frameUniforms.EndFrame();
+	m_lights.EndFrame();
 
+	// Smoothed so the GUI reading is steady
+	m_renderCpuMs = glm::mix(m_renderCpuMs, MsSince(frameStart), 0.05);
 }
-
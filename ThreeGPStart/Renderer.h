@@ -5,53 +5,82 @@
 #include "Helper.h"
 #include "Mesh.h"
 #include "Camera.h"
-
-struct Mesh
-{
-	GLuint VAO;
-	GLuint m_numElements;
-	GLuint Tex;
-};
-
-struct Model
-{
-	std::vector<Mesh> m_meshVector;
-};
+#include "AssetLoader.h"
+#include "Terrain.h"
+#include "ShaderProgram.h"
+#include "RenderQueue.h"
+#include "InstancedModel.h"
+#include "GpuModel.h"
+#include "TextureManager.h"
+#include "TextureStreamer.h"
+#include "Skybox.h"
+#include "ProgramCache.h"
+#include "FrameUniforms.h"
+#include "MaterialTable.h"
+#include "ClusteredLights.h"
+#include "StaticMeshArena.h"
 
 class Renderer
 {
 private:
-	Model Skymodel;
-	std::vector<Model> m_modelVector;
-	// Program object - to host shaders
-	GLuint m_program{ 0 };
-	GLuint m_programcube{ 0 };
+	// Program object - to host shaders, permutations shared through the cache
+	Helpers::ProgramCache m_programCache;
+	std::shared_ptr<Helpers::ShaderProgram> m_program;
+	std::shared_ptr<Helpers::ShaderProgram> m_programcube;
+	std::shared_ptr<Helpers::ShaderProgram> m_programSky;
+	std::shared_ptr<Helpers::ShaderProgram> m_programInstanced;
+	std::shared_ptr<Helpers::ShaderProgram> m_programArena;
+	// View, projection and time for every program, written once a frame
+	Helpers::FrameUniforms m_frameUniforms;
+	// Every loaded material's colours in one buffer, draws pick theirs by index
+	Helpers::MaterialTable m_materials;
+	// Point and spot lights over the terrain, binned into clusters each frame so fragments only shade nearby ones
+	static constexpr int KMaxLights{ 4096 };
+	Helpers::ClusteredLights m_lights;
+	std::vector<Helpers::Light> m_lightList;
+	int m_numLights{ 256 };
+	bool m_showLightCount{ false };
 	//Cube
 	GLuint c_VAO{ 0 };
+	GLuint c_positionsVBO{ 0 };
+	GLuint c_coloursVBO{ 0 };
+	GLuint c_elementsEBO{ 0 };
 	GLuint c_numElements{ 0 };
-	//Skybox
-	GLuint s_VAO{ 0 };
-	GLuint s_tex;
-	GLuint s_numElements{ 0 };
+	//Apples scattered over the terrain, a stress test for instancing
+	static constexpr int KMaxApples{ 10000 };
+	Helpers::InstancedModel m_apples;
+	std::shared_ptr<Helpers::Texture> m_appleTexture;
+	std::vector<glm::mat4> m_appleTransforms;
+	int m_numApples{ KMaxApples };
+	bool m_instancing{ true };
+	double m_renderCpuMs{ 0 };
 	//Terrain
-	GLuint t_VAO{ 0 };
-	GLuint t_tex;
-	GLuint t_numElements{ 0 };
-	// Vertex Array Object to wrap all render settings
-	GLuint m_VAO{ 0 };
-	GLuint tex{ 0 };
-	// Number of elments to use when rendering
-	GLuint m_numElements{ 0 };
+	Helpers::Terrain m_terrain;
+	std::shared_ptr<Helpers::Texture> m_terrainTexture;
+	// Textures and models shared by path, released when the last user lets go
+	Helpers::TextureStreamer m_streamer;
+	Helpers::TextureManager m_textures;
+	Helpers::GpuModelCache m_models;
+	std::shared_ptr<Helpers::GpuModel> m_jeep;
+	// Jeep parts and the individually drawn apples merged into shared buffers, one multi draw per texture
+	Helpers::StaticMeshArena m_arena;
+	std::vector<size_t> m_jeepBuckets;
+	std::vector<size_t> m_appleMeshes;
+	size_t m_appleBucket{ 0 };
+	//Skybox, a cube map drawn in one triangle behind everything else
+	Helpers::Skybox m_skybox;
 
 	bool m_wireframe{ false };
 
-	GLuint CreateProgram(std::string, std::string);
+	// Draws for the frame, recorded then sorted by state before executing
+	Helpers::RenderQueue m_queue;
 
-	bool Swap = false;
 	bool NoiseGen = true;
 	bool ExtraNoise;
-	float NoiseVal{ 0 };
-	size_t Index{ 0 };
+
+	// How long each asset took to load, shown in the GUI
+	std::vector<Helpers::AssetLoader::Timing> m_loadTimings;
+	double m_loadTotalMs{ 0 };
 public:
 	Renderer();
 	~Renderer();
@@ -0,0 +1,128 @@
+#include "ShaderPreprocessor.h"
+#include "Helper.h"
+#include <unordered_set>
+#include <filesystem>
+namespace fs = std::filesystem;
+
+namespace Helpers
+{
+	// The directive name if line is a preprocessor directive, with rest set to what follows it
+	static std::string Directive(const std::string& line, std::string& rest)
+	{
+		size_t pos{ line.find_first_not_of(" \t") };
+		if (pos == std::string::npos || line[pos] != '#')
+			return "";
+
+		pos = line.find_first_not_of(" \t", pos + 1);
+		if (pos == std::string::npos)
+			return "";
+
+		const size_t end{ std::min(line.find_first_of(" \t\r", pos), line.size()) };
+		rest = line.substr(end);
+		return line.substr(pos, end - pos);
+	}
+
+	// The name between the quotes of an #include, empty if there are none
+	static std::string IncludeName(const std::string& rest)
+	{
+		const size_t open{ rest.find('"') };
+		const size_t close{ open == std::string::npos ? std::string::npos : rest.find('"', open + 1) };
+		if (close == std::string::npos)
+			return "";
+
+		return rest.substr(open + 1, close - open - 1);
+	}
+
+	// Pastes the file into the shader, following its includes. prelude goes after the #version line of the first file.
+	static bool AppendFile(const fs::path& path, const std::string& prelude, PreprocessedShader& shader,
+		std::unordered_set<std::string>& included)
+	{
+		const std::string key{ path.lexically_normal().string() };
+		if (!included.insert(key).second)
+			return true;
+
+		const std::string text{ stringFromFile(path.string()) };
+		if (text.empty())
+		{
+			std::cout << "Could not load " << path.string() << std::endl;
+			return false;
+		}
+
+		const size_t fileIndex{ shader.files.size() };
+		shader.files.push_back(path.string());
+		if (fileIndex > 0)
+			shader.source += "#line 1 " + std::to_string(fileIndex) + "\n";
+
+		std::istringstream lines(text);
+		std::string line;
+		int lineNumber{ 0 };
+		bool addedPrelude{ fileIndex > 0 || prelude.empty() };
+		while (std::getline(lines, line))
+		{
+			lineNumber++;
+
+			std::string rest;
+			const std::string directive{ Directive(line, rest) };
+			if (directive == "include")
+			{
+				const std::string name{ IncludeName(rest) };
+				if (name.empty())
+				{
+					std::cout << path.string() << "(" << lineNumber << "): #include needs a \"file\"" << std::endl;
+					return false;
+				}
+
+				if (!AppendFile(path.parent_path() / name, prelude, shader, included))
+					return false;
+
+				// Carry on numbering from the line after the #include
+				shader.source += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n";
+				continue;
+			}
+
+			shader.source += line + "\n";
+
+			// Defines can only come after #version, which has to be first
+			if (directive == "version" && !addedPrelude)
+			{
+				shader.source += prelude + "#line " + std::to_string(lineNumber + 1) + " 0\n";
+				addedPrelude = true;
+			}
+		}
+
+		// No #version so the defines can go first
+		if (!addedPrelude)
+			shader.source = prelude + "#line 1 0\n" + shader.source;
+
+		return true;
+	}
+
+	// Same string for the same define set e.g. "INSTANCED=1;VERTEX_COLOUR=1", empty for none
+	std::string DefinesKey(const ShaderDefines& defines)
+	{
+		std::string key;
+		for (const auto& define : defines)
+		{
+			if (!key.empty())
+				key += ";";
+			key += define.first + "=" + define.second;
+		}
+
+		return key;
+	}
+
+	// Reads a shader and pastes in each #include "file", found relative to the file including it. Every file goes in once
+	// however often it is included so cycles are harmless, and includes inside #if blocks are pasted either way.
+	// VERTEX_SHADER or FRAGMENT_SHADER is defined for the stage then defines follow it, straight after the #version line.
+	// #line directives keep the compiler's line numbers pointing into the right file. Returns false if a file is missing.
+	bool PreprocessShader(const std::string& filepath, GLenum stage, const ShaderDefines& defines, PreprocessedShader& shader)
+	{
+		std::string prelude{ stage == GL_VERTEX_SHADER ? "#define VERTEX_SHADER\n" : "#define FRAGMENT_SHADER\n" };
+		for (const auto& define : defines)
+			prelude += "#define " + define.first + " " + define.second + "\n";
+
+		shader = PreprocessedShader();
+		std::unordered_set<std::string> included;
+		return AppendFile(fs::path(filepath), prelude, shader, included);
+	}
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "ExternalLibraryHeaders.h"
+
+namespace Helpers
+{
+	// The #defines that pick one permutation of a shader, name to value. Sorted so a set always gives the same key.
+	using ShaderDefines = std::map<std::string, std::string>;
+
+	// A shader ready to compile with its includes pasted in and its defines added
+	struct PreprocessedShader
+	{
+		std::string source;
+
+		// Every file that went in, file i is source string i in the compiler's messages
+		std::vector<std::string> files;
+	};
+
+	// Same string for the same define set e.g. "INSTANCED=1;VERTEX_COLOUR=1", empty for none
+	std::string DefinesKey(const ShaderDefines& defines);
+
+	// Reads a shader and pastes in each #include "file", found relative to the file including it. Every file goes in once
+	// however often it is included so cycles are harmless, and includes inside #if blocks are pasted either way.
+	// VERTEX_SHADER or FRAGMENT_SHADER is defined for the stage then defines follow it, straight after the #version line.
+	// #line directives keep the compiler's line numbers pointing into the right file. Returns false if a file is missing.
+	bool PreprocessShader(const std::string& filepath, GLenum stage, const ShaderDefines& defines, PreprocessedShader& shader);
+}
@@ -0,0 +1,174 @@
+#include "ShaderProgram.h"
+
+namespace Helpers
+{
+	// Whether a value set with a setter for setterType can go into a uniform of uniformType
+	static bool TypesMatch(GLenum setterType, GLenum uniformType)
+	{
+		if (setterType == uniformType)
+			return true;
+
+		// Booleans and samplers are set as ints
+		if (setterType != GL_INT)
+			return false;
+
+		switch (uniformType)
+		{
+		case GL_BOOL:
+		case GL_SAMPLER_1D:
+		case GL_SAMPLER_2D:
+		case GL_SAMPLER_3D:
+		case GL_SAMPLER_CUBE:
+		case GL_SAMPLER_2D_SHADOW:
+		case GL_SAMPLER_2D_ARRAY:
+		case GL_SAMPLER_CUBE_MAP_ARRAY:
+		case GL_SAMPLER_BUFFER:
+		case GL_INT_SAMPLER_2D:
+		case GL_UNSIGNED_INT_SAMPLER_2D:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	ShaderProgram::~ShaderProgram()
+	{
+		Destroy();
+	}
+
+	// Takes ownership of a linked program e.g. from Renderer::CreateProgram and reads its active uniforms. Returns false if program is 0.
+	bool ShaderProgram::Attach(GLuint program)
+	{
+		Destroy();
+		if (program == 0)
+			return false;
+
+		m_program = program;
+		Reflect();
+		return true;
+	}
+
+	// Deletes the program
+	void ShaderProgram::Destroy()
+	{
+		if (m_program)
+			glDeleteProgram(m_program);
+
+		m_program = 0;
+		m_uniforms.clear();
+		m_warnings.clear();
+	}
+
+	// Reads every active uniform outside a uniform block into the table
+	void ShaderProgram::Reflect()
+	{
+		GLint numUniforms{ 0 };
+		GLint maxNameLength{ 0 };
+		glGetProgramiv(m_program, GL_ACTIVE_UNIFORMS, &numUniforms);
+		glGetProgramiv(m_program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+		std::vector<GLchar> nameBuffer(std::max(maxNameLength, 1));
+		for (GLint i = 0; i < numUniforms; i++)
+		{
+			GLsizei nameLength{ 0 };
+			Uniform uniform;
+			glGetActiveUniform(m_program, (GLuint)i, (GLsizei)nameBuffer.size(), &nameLength, &uniform.arraySize, &uniform.type, nameBuffer.data());
+
+			std::string name(nameBuffer.data(), nameLength);
+			uniform.location = glGetUniformLocation(m_program, name.c_str());
+
+			// Uniforms inside blocks have no location
+			if (uniform.location < 0)
+				continue;
+
+			// Arrays are reported as name[0], also allow just the name
+			const size_t bracket{ name.find('[') };
+			if (bracket != std::string::npos)
+				name.resize(bracket);
+
+			m_uniforms[name] = uniform;
+		}
+	}
+
+	// Location of a uniform, -1 if the program does not have it
+	GLint ShaderProgram::GetLocation(const std::string& name) const
+	{
+		const auto found{ m_uniforms.find(name) };
+		return found != m_uniforms.end() ? found->second.location : -1;
+	}
+
+	// Looks up the uniform, warning once if it does not exist or has a different type
+	ShaderProgram::Uniform* ShaderProgram::Find(const std::string& name, GLenum type)
+	{
+		const auto found{ m_uniforms.find(name) };
+		if (found != m_uniforms.end() && TypesMatch(type, found->second.type))
+			return &found->second;
+
+		if (m_warnings.insert(name).second)
+		{
+			if (found == m_uniforms.end())
+				std::cout << "ShaderProgram " << m_program << " has no active uniform called " << name << std::endl;
+			else
+				std::cout << "ShaderProgram " << m_program << " uniform " << name << " is set with the wrong type" << std::endl;
+		}
+
+		return nullptr;
+	}
+
+	// True if value differs from what was last uploaded, in which case it is recorded as the new value
+	bool ShaderProgram::Changed(Uniform& uniform, const void* value, size_t size)
+	{
+		if (uniform.hasValue && memcmp(uniform.value, value, size) == 0)
+		{
+			m_numSkipped++;
+			return false;
+		}
+
+		memcpy(uniform.value, value, size);
+		uniform.hasValue = true;
+		m_numUploads++;
+		return true;
+	}
+
+	void ShaderProgram::Set(const std::string& name, int value)
+	{
+		Uniform* uniform{ Find(name, GL_INT) };
+		if (uniform && Changed(*uniform, &value, sizeof(value)))
+			glProgramUniform1i(m_program, uniform->location, value);
+	}
+
+	void ShaderProgram::Set(const std::string& name, float value)
+	{
+		Uniform* uniform{ Find(name, GL_FLOAT) };
+		if (uniform && Changed(*uniform, &value, sizeof(value)))
+			glProgramUniform1f(m_program, uniform->location, value);
+	}
+
+	void ShaderProgram::Set(const std::string& name, const glm::vec2& value)
+	{
+		Uniform* uniform{ Find(name, GL_FLOAT_VEC2) };
+		if (uniform && Changed(*uniform, &value, sizeof(value)))
+			glProgramUniform2fv(m_program, uniform->location, 1, glm::value_ptr(value));
+	}
+
+	void ShaderProgram::Set(const std::string& name, const glm::vec3& value)
+	{
+		Uniform* uniform{ Find(name, GL_FLOAT_VEC3) };
+		if (uniform && Changed(*uniform, &value, sizeof(value)))
+			glProgramUniform3fv(m_program, uniform->location, 1, glm::value_ptr(value));
+	}
+
+	void ShaderProgram::Set(const std::string& name, const glm::vec4& value)
+	{
+		Uniform* uniform{ Find(name, GL_FLOAT_VEC4) };
+		if (uniform && Changed(*uniform, &value, sizeof(value)))
+			glProgramUniform4fv(m_program, uniform->location, 1, glm::value_ptr(value));
+	}
+
+	void ShaderProgram::Set(const std::string& name, const glm::mat4& value)
+	{
+		Uniform* uniform{ Find(name, GL_FLOAT_MAT4) };
+		if (uniform && Changed(*uniform, &value, sizeof(value)))
+			glProgramUniformMatrix4fv(m_program, uniform->location, 1, GL_FALSE, glm::value_ptr(value));
+	}
+}
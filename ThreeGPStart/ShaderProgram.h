@@ -0,0 +1,78 @@
+#pragma once
+
+#include "ExternalLibraryHeaders.h"
+#include "GLState.h"
+#include <unordered_map>
+#include <unordered_set>
+
+namespace Helpers
+{
+	// Owns a linked program and the locations of its uniforms, found once when the program is attached.
+	// The setters look names up in a hash table rather than asking the driver, warn once about names the program
+	// does not have, and skip the upload when the uniform already holds the value.
+	class ShaderProgram
+	{
+	private:
+		// Big enough for the largest type with a setter, a mat4
+		static constexpr size_t KMaxValueBytes{ sizeof(glm::mat4) };
+
+		struct Uniform
+		{
+			GLint location{ -1 };
+			GLenum type{ 0 };
+			GLint arraySize{ 1 };
+
+			// Last value uploaded, only valid once hasValue is set
+			bool hasValue{ false };
+			BYTE value[KMaxValueBytes];
+		};
+
+		GLuint m_program{ 0 };
+		std::unordered_map<std::string, Uniform> m_uniforms;
+
+		// Names already warned about so the output is not flooded every frame
+		std::unordered_set<std::string> m_warnings;
+
+		size_t m_numUploads{ 0 };
+		size_t m_numSkipped{ 0 };
+
+		Uniform* Find(const std::string& name, GLenum type);
+		bool Changed(Uniform& uniform, const void* value, size_t size);
+		void Reflect();
+	public:
+		ShaderProgram() = default;
+		~ShaderProgram();
+
+		ShaderProgram(const ShaderProgram&) = delete;
+		ShaderProgram& operator=(const ShaderProgram&) = delete;
+
+		// Takes ownership of a linked program e.g. from Renderer::CreateProgram and reads its active uniforms. Returns false if program is 0.
+		bool Attach(GLuint program);
+
+		// Deletes the program
+		void Destroy();
+
+		GLuint GetId() const { return m_program; }
+		bool IsValid() const { return m_program != 0; }
+
+		// Makes this the current program
+		void Use() const { GLState::Get().UseProgram(m_program); }
+
+		// Location of a uniform, -1 if the program does not have it
+		GLint GetLocation(const std::string& name) const;
+
+		// Typed setters. These use glProgramUniform so the program does not need to be bound.
+		// Samplers are set with the int version.
+		void Set(const std::string& name, int value);
+		void Set(const std::string& name, float value);
+		void Set(const std::string& name, const glm::vec2& value);
+		void Set(const std::string& name, const glm::vec3& value);
+		void Set(const std::string& name, const glm::vec4& value);
+		void Set(const std::string& name, const glm::mat4& value);
+
+		// Uniform uploads issued and skipped as unchanged since the last reset
+		size_t NumUploads() const { return m_numUploads; }
+		size_t NumSkipped() const { return m_numSkipped; }
+		void ResetCounters() { m_numUploads = 0; m_numSkipped = 0; }
+	};
+}
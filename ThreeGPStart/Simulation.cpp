@@ -1,11 +1,19 @@
 #include "Simulation.h"
 #include "Camera.h"
 #include "Renderer.h"
+#include "Benchmark.h"
+
+// Uncomment to time the engine systems at start up, results go to the output pane
+//#define RUN_BENCHMARKS
 
 
 // Initialise this as well as the renderer, returns false on error
 bool Simulation::Initialise()
 {
+#if defined(RUN_BENCHMARKS)
+	Benchmarks::RunAll();
+#endif
+
 	// Set up camera
 	m_camera = std::make_shared<Helpers::Camera>();
 	//m_camera->Initialise(glm::vec3(0, 200, 900), glm::vec3(0)); // Jeep
@@ -0,0 +1,134 @@
+#include "Skybox.h"
+#include "ImageLoader.h"
+#include "DDSFile.h"
+#include "TextureCompression.h"
+#include "JobSystem.h"
+#include "GLState.h"
+
+namespace Helpers
+{
+	Skybox::~Skybox()
+	{
+		if (m_vertexArray)
+			glDeleteVertexArrays(1, &m_vertexArray);
+	}
+
+	// Makes the vertex array and loads the first set to show. Returns false on error.
+	bool Skybox::Create(const std::vector<SkySet>& sets, size_t first, TextureManager& textures)
+	{
+		if (m_vertexArray || first >= sets.size())
+			return false;
+
+		m_sets = sets;
+		m_textures.resize(m_sets.size());
+
+		// Core profile draws need a vertex array bound even with no attributes
+		glGenVertexArrays(1, &m_vertexArray);
+
+		// Filter across face edges so the seams do not show
+		GLState::Get().Enable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+		return Select(first, textures);
+	}
+
+	// Shows another set, decoding its faces across the job system the first time.
+	// Returns false and keeps the current sky if a face will not load.
+	bool Skybox::Select(size_t set, TextureManager& textures)
+	{
+		if (set >= m_sets.size())
+			return false;
+
+		if (!m_textures[set])
+		{
+			m_textures[set] = LoadSet(m_sets[set], textures);
+			if (!m_textures[set])
+				return false;
+		}
+
+		m_current = set;
+		return true;
+	}
+
+	// Where a sky face's bake lives. Not BakedTexturePath as the bake is flipped and maybe turned, the name says which,
+	// so the same image used as a 2D texture or with its rotate flag changed never picks up the wrong copy.
+	static std::string SkyBakePath(const std::string& filepath, bool rotate)
+	{
+		return filepath + (rotate ? ".sky.r1.dds" : ".sky.r0.dds");
+	}
+
+	// DDS faces are uploaded as they are. Other faces are flipped, turned and compressed to BC1 with their mips once, then
+	// read back from SkyBakePath on later runs, so every set goes up block compressed without building mips on the GPU.
+	std::shared_ptr<Texture> Skybox::LoadSet(const SkySet& set, TextureManager& textures) const
+	{
+		std::vector<CompressedImage> compressed(6);
+		bool loaded[6]{};
+
+		JobSystem::Get().ParallelFor(6, 1, [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+				{
+					const std::string filepath{ set.folder + "\\" + set.faces[i] };
+
+					// DDS rows are already top first, the blocks cannot be turned without decoding them
+					if (IsDDSFile(filepath))
+					{
+						loaded[i] = !set.rotate[i] && LoadDDS(filepath, compressed[i]);
+						continue;
+					}
+
+					// Baked faces are stored flipped and turned already
+					const std::string bakedPath{ SkyBakePath(filepath, set.rotate[i]) };
+					if (IsBakeCurrent(filepath, bakedPath) && LoadDDS(bakedPath, compressed[i]))
+					{
+						loaded[i] = true;
+						continue;
+					}
+
+					ImageLoader image;
+					if (!image.Load(filepath))
+						continue;
+
+					image.FlipVertical();
+					if (set.rotate[i] && !image.RotateClockwise())
+						continue;
+
+					// Sky faces are opaque, BC1 for all of them so the faces agree on format
+					CompressImage(image.GetData(), image.Width(), image.Height(), KFormatBC1, compressed[i]);
+					if (!SaveDDS(bakedPath, compressed[i]))
+						std::cout << "Could not save baked sky face " << bakedPath << std::endl;
+
+					loaded[i] = true;
+				}
+			});
+
+		for (int i = 0; i < 6; i++)
+		{
+			if (!loaded[i])
+			{
+				std::cout << "Could not load sky " << set.name << " face " << set.faces[i] << std::endl;
+				return nullptr;
+			}
+		}
+
+		// Fails if DDS faces were mixed with baked ones in another format
+		return textures.AddCompressedCubeMap("Skybox " + set.name, compressed);
+	}
+
+	// The current set's cube map
+	GLuint Skybox::GetTexture() const
+	{
+		return m_current < m_textures.size() && m_textures[m_current] ? m_textures[m_current]->GetId() : 0;
+	}
+
+	// The sky program should already be bound with the cube map on unit 0. Tests LEQUAL against the cleared depth of 1.
+	void Skybox::Draw() const
+	{
+		GLState& state{ GLState::Get() };
+		state.BindVertexArray(m_vertexArray);
+
+		// The triangle's depth is exactly 1 so it only passes where nothing has been drawn
+		state.DepthFunc(GL_LEQUAL);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+		state.DepthFunc(GL_LESS);
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "ExternalLibraryHeaders.h"
+#include "TextureManager.h"
+
+namespace Helpers
+{
+	// The six images of one sky, in cube map face order +X, -X, +Y, -Y, +Z, -Z
+	struct SkySet
+	{
+		std::string name;
+		std::string folder;
+		std::string faces[6];
+
+		// Faces stored a quarter turn anticlockwise of how the cube map wants them, turned back as they load
+		bool rotate[6]{};
+	};
+
+	// A cube map sky drawn as one full screen triangle on the far plane after the opaque geometry, so the depth test
+	// leaves only the pixels nothing else covered to be shaded. Sets are loaded the first time they are chosen and kept.
+	class Skybox
+	{
+	private:
+		// Empty, the triangle's corners come from gl_VertexID
+		GLuint m_vertexArray{ 0 };
+
+		std::vector<SkySet> m_sets;
+		std::vector<std::shared_ptr<Texture>> m_textures;
+		size_t m_current{ 0 };
+
+		std::shared_ptr<Texture> LoadSet(const SkySet& set, TextureManager& textures) const;
+	public:
+		Skybox() = default;
+		~Skybox();
+
+		Skybox(const Skybox&) = delete;
+		Skybox& operator=(const Skybox&) = delete;
+
+		// Makes the vertex array and loads the first set to show. Returns false on error.
+		bool Create(const std::vector<SkySet>& sets, size_t first, TextureManager& textures);
+
+		// Shows another set, decoding its faces across the job system the first time.
+		// Returns false and keeps the current sky if a face will not load.
+		bool Select(size_t set, TextureManager& textures);
+
+		const std::vector<SkySet>& GetSets() const { return m_sets; }
+		size_t GetCurrent() const { return m_current; }
+
+		// The current set's cube map
+		GLuint GetTexture() const;
+
+		// The sky program should already be bound with the cube map on unit 0. Tests LEQUAL against the cleared depth of 1.
+		void Draw() const;
+	};
+}
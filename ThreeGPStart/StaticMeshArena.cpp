@@ -0,0 +1,192 @@
+#include "StaticMeshArena.h"
+#include "GLState.h"
+
+namespace Helpers
+{
+	StaticMeshArena::~StaticMeshArena()
+	{
+		// Nothing was created if Upload was never called
+		if (m_VAO == 0)
+			return;
+
+		glDeleteVertexArrays(1, &m_VAO);
+		glDeleteBuffers(1, &m_vertexBuffer);
+		glDeleteBuffers(1, &m_elementBuffer);
+		glDeleteBuffers(1, &m_commandBuffer);
+		glDeleteBuffers(1, &m_drawDataBuffer);
+	}
+
+	// Appends a mesh to the CPU copy, returns its id or KInvalidMesh if its vertex layout differs from the meshes already added
+	size_t StaticMeshArena::AddMesh(const Mesh& mesh)
+	{
+		if (m_VAO != 0)
+		{
+			std::cout << "Meshes cannot be added to a static mesh arena after Upload" << std::endl;
+			return KInvalidMesh;
+		}
+
+		// Always 32 bit elements, there is one element buffer for every mesh and base vertices can go past 65535
+		const InterleavedMesh packed{ BuildInterleavedMesh(mesh, KVertexPackNormals | KVertexPackUVs) };
+
+		if (m_meshes.empty())
+		{
+			m_attributes = packed.attributes;
+			m_stride = packed.stride;
+		}
+		else
+		{
+			bool sameLayout{ packed.stride == m_stride && packed.attributes.size() == m_attributes.size() };
+			for (size_t i = 0; sameLayout && i < m_attributes.size(); i++)
+			{
+				const VertexAttribute& a{ packed.attributes[i] };
+				const VertexAttribute& b{ m_attributes[i] };
+				sameLayout = a.location == b.location && a.numComponents == b.numComponents && a.type == b.type && a.offset == b.offset;
+			}
+
+			if (!sameLayout)
+			{
+				std::cout << "Mesh vertex layout does not match the static mesh arena, it needs drawing on its own" << std::endl;
+				return KInvalidMesh;
+			}
+		}
+
+		MeshRange range;
+		range.firstElement = (GLuint)m_elements.size();
+		range.numElements = packed.numElements;
+		range.baseVertex = (GLint)m_numVertices;
+
+		m_vertexData.insert(m_vertexData.end(), packed.vertexData.begin(), packed.vertexData.end());
+		for (GLuint i = 0; i < packed.numElements; i++)
+			m_elements.push_back(packed.GetElement(i));
+		m_numVertices += packed.numVertices;
+
+		m_meshes.push_back(range);
+		return m_meshes.size() - 1;
+	}
+
+	// Creates the buffers and VAO from everything added, after this no more meshes can be added
+	bool StaticMeshArena::Upload()
+	{
+		if (m_VAO != 0 || m_meshes.empty())
+			return false;
+
+		glGenBuffers(1, &m_vertexBuffer);
+		glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+		glBufferData(GL_ARRAY_BUFFER, m_vertexData.size(), m_vertexData.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		glGenBuffers(1, &m_elementBuffer);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_elementBuffer);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_elements.size() * sizeof(GLuint), m_elements.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+		// Filled every frame by Flush
+		glGenBuffers(1, &m_commandBuffer);
+		glGenBuffers(1, &m_drawDataBuffer);
+
+		glGenVertexArrays(1, &m_VAO);
+		GLState::Get().BindVertexArray(m_VAO);
+
+		glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+		for (const VertexAttribute& attribute : m_attributes)
+		{
+			glEnableVertexAttribArray(attribute.location);
+			glVertexAttribPointer(attribute.location, attribute.numComponents, attribute.type, attribute.normalised,
+				m_stride, (void*)(size_t)attribute.offset);
+		}
+
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_elementBuffer);
+		GLState::Get().BindVertexArray(0);
+
+		// The CPU copies are no longer needed now they are in OpenGL buffers
+		m_vertexData = std::vector<BYTE>();
+		m_elements = std::vector<GLuint>();
+
+		return true;
+	}
+
+	// A group of draws sharing a 2D texture, returns the bucket id. Asking again for the same texture returns the same bucket.
+	size_t StaticMeshArena::AddBucket(GLuint texture)
+	{
+		for (size_t i = 0; i < m_buckets.size(); i++)
+		{
+			if (m_buckets[i].texture == texture)
+				return i;
+		}
+
+		Bucket bucket;
+		bucket.texture = texture;
+		m_buckets.push_back(bucket);
+		return m_buckets.size() - 1;
+	}
+
+	// Empties every bucket ready for the frame's draws
+	void StaticMeshArena::BeginFrame()
+	{
+		for (Bucket& bucket : m_buckets)
+		{
+			bucket.commands.clear();
+			bucket.drawData.clear();
+		}
+
+		m_numCalls = 0;
+	}
+
+	// Records a draw of a mesh in a bucket, material is the MaterialTable entry
+	void StaticMeshArena::AddDraw(size_t bucket, size_t mesh, const glm::mat4& model, GLuint material)
+	{
+		const MeshRange& range{ m_meshes[mesh] };
+
+		// baseInstance is filled in by Flush once the draw's place in the shared buffers is known
+		m_buckets[bucket].commands.push_back({ range.numElements, 1, range.firstElement, range.baseVertex, 0 });
+		m_buckets[bucket].drawData.push_back({ model, material, { 0, 0, 0 } });
+	}
+
+	// Uploads the frame's draws, call once after the last AddDraw and before any DrawBucket
+	void StaticMeshArena::Flush()
+	{
+		m_frameCommands.clear();
+		m_frameDrawData.clear();
+
+		for (Bucket& bucket : m_buckets)
+		{
+			bucket.firstCommand = m_frameCommands.size();
+			for (size_t i = 0; i < bucket.commands.size(); i++)
+			{
+				DrawCommand command{ bucket.commands[i] };
+				command.baseInstance = (GLuint)m_frameDrawData.size();
+				m_frameCommands.push_back(command);
+				m_frameDrawData.push_back(bucket.drawData[i]);
+			}
+		}
+
+		if (m_frameCommands.empty())
+			return;
+
+		// Orphan and refill, the driver hands back fresh memory rather than waiting on last frame's draws
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, m_frameCommands.size() * sizeof(DrawCommand), m_frameCommands.data(), GL_STREAM_DRAW);
+
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_drawDataBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, m_frameDrawData.size() * sizeof(DrawData), m_frameDrawData.data(), GL_STREAM_DRAW);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+
+	// Issues one multi draw for the bucket. The program should already be bound, the texture is bound here.
+	void StaticMeshArena::DrawBucket(size_t bucket)
+	{
+		const Bucket& drawBucket{ m_buckets[bucket] };
+		if (drawBucket.commands.empty())
+			return;
+
+		GLState::Get().BindTexture(0, GL_TEXTURE_2D, drawBucket.texture);
+		GLState::Get().BindVertexArray(m_VAO);
+
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, KDrawDataBinding, m_drawDataBuffer);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)(drawBucket.firstCommand * sizeof(DrawCommand)),
+			(GLsizei)drawBucket.commands.size(), 0);
+
+		m_numCalls++;
+	}
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "ExternalLibraryHeaders.h"
+#include "Mesh.h"
+#include "VertexFormat.h"
+
+namespace Helpers
+{
+	// Static meshes merged into one vertex buffer and one element buffer, drawn with glMultiDrawElementsIndirect.
+	// Draws are grouped into buckets that share a texture, so a bucket costs one call however many meshes it holds.
+	// The per draw transform and material go in a shader storage buffer the vertex shader indexes with gl_BaseInstance.
+	// Materials come from a MaterialTable so one multi draw can mix them.
+	class StaticMeshArena
+	{
+	public:
+		static constexpr size_t KInvalidMesh{ (size_t)-1 };
+
+		// Binding point of the per draw data, see the ARENA permutation of Data/Shaders/mesh_shader.vert
+		static constexpr GLuint KDrawDataBinding{ 0 };
+
+		// Where a mesh lives in the shared buffers
+		struct MeshRange
+		{
+			GLuint firstElement{ 0 };
+			GLuint numElements{ 0 };
+			GLint baseVertex{ 0 };
+		};
+
+		// Matches the std430 DrawData struct in Data/Shaders/mesh_shader.vert
+		struct DrawData
+		{
+			glm::mat4 model;
+			GLuint material;
+			GLuint padding[3];
+		};
+	private:
+		// Layout OpenGL reads from the indirect buffer
+		struct DrawCommand
+		{
+			GLuint count;
+			GLuint instanceCount;
+			GLuint firstIndex;
+			GLint baseVertex;
+			GLuint baseInstance;
+		};
+
+		struct Bucket
+		{
+			GLuint texture{ 0 };
+			std::vector<DrawCommand> commands;
+			std::vector<DrawData> drawData;
+
+			// Where this bucket's commands start in the indirect buffer, set by Flush
+			size_t firstCommand{ 0 };
+		};
+
+		// CPU copies, released once uploaded
+		std::vector<BYTE> m_vertexData;
+		std::vector<GLuint> m_elements;
+
+		// Every mesh must have the same layout as the first
+		std::vector<VertexAttribute> m_attributes;
+		GLsizei m_stride{ 0 };
+		GLuint m_numVertices{ 0 };
+
+		std::vector<MeshRange> m_meshes;
+		std::vector<Bucket> m_buckets;
+
+		GLuint m_VAO{ 0 };
+		GLuint m_vertexBuffer{ 0 };
+		GLuint m_elementBuffer{ 0 };
+		GLuint m_commandBuffer{ 0 };
+		GLuint m_drawDataBuffer{ 0 };
+
+		// Per frame staging for Flush, kept to avoid reallocating
+		std::vector<DrawCommand> m_frameCommands;
+		std::vector<DrawData> m_frameDrawData;
+
+		size_t m_numCalls{ 0 };
+	public:
+		StaticMeshArena() = default;
+		~StaticMeshArena();
+
+		StaticMeshArena(const StaticMeshArena&) = delete;
+		StaticMeshArena& operator=(const StaticMeshArena&) = delete;
+
+		// Appends a mesh to the CPU copy, returns its id or KInvalidMesh if its vertex layout differs from the meshes already added
+		size_t AddMesh(const Mesh& mesh);
+
+		// Creates the buffers and VAO from everything added, after this no more meshes can be added
+		bool Upload();
+
+		// A group of draws sharing a 2D texture, returns the bucket id. Asking again for the same texture returns the same bucket.
+		size_t AddBucket(GLuint texture);
+
+		// Empties every bucket ready for the frame's draws
+		void BeginFrame();
+
+		// Records a draw of a mesh in a bucket, material is the MaterialTable entry
+		void AddDraw(size_t bucket, size_t mesh, const glm::mat4& model, GLuint material = 0);
+
+		// Uploads the frame's draws, call once after the last AddDraw and before any DrawBucket
+		void Flush();
+
+		// Issues one multi draw for the bucket. The program should already be bound, the texture is bound here.
+		void DrawBucket(size_t bucket);
+
+		const MeshRange& GetMesh(size_t mesh) const { return m_meshes[mesh]; }
+		GLuint GetTexture(size_t bucket) const { return m_buckets[bucket].texture; }
+		size_t NumMeshes() const { return m_meshes.size(); }
+		size_t NumBuckets() const { return m_buckets.size(); }
+		size_t NumDraws(size_t bucket) const { return m_buckets[bucket].commands.size(); }
+		size_t NumDraws() const { return m_frameCommands.size(); }
+
+		// Multi draw calls issued since BeginFrame
+		size_t NumCalls() const { return m_numCalls; }
+	};
+}
@@ -0,0 +1,309 @@
+#include "Terrain.h"
+#include "GLState.h"
+
+namespace Helpers
+{
+	Terrain::~Terrain()
+	{
+		// A terrain built with BuildChunks alone never touched OpenGL
+		if (m_VAO == 0)
+			return;
+
+		glDeleteVertexArrays(1, &m_VAO);
+		glDeleteBuffers(1, &m_vertexBuffer);
+		glDeleteBuffers(1, &m_elementBuffer);
+	}
+
+	// Split a grid of vertices into chunks. The grid is x major i.e. vertex (x, z) is at x * numVertZ + z
+	bool Terrain::BuildChunks(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals,
+		const std::vector<glm::vec2>& uvs, int numVertX, int numVertZ)
+	{
+		const size_t numVerts{ (size_t)numVertX * numVertZ };
+		if (numVertX < 2 || numVertZ < 2 || positions.size() != numVerts || normals.size() != numVerts || uvs.size() != numVerts)
+		{
+			std::cout << "Terrain::BuildChunks grid size does not match the vertex data" << std::endl;
+			return false;
+		}
+
+		const int numCellX{ numVertX - 1 };
+		const int numCellZ{ numVertZ - 1 };
+		m_numChunksX = (numCellX + KChunkCells - 1) / KChunkCells;
+		m_numChunksZ = (numCellZ + KChunkCells - 1) / KChunkCells;
+
+		m_chunks.clear();
+		m_chunks.reserve((size_t)m_numChunksX * m_numChunksZ);
+		m_vertices.clear();
+		m_vertices.reserve(m_chunks.capacity() * KChunkVerts * KChunkVerts);
+
+		for (int chunkX = 0; chunkX < m_numChunksX; chunkX++)
+		{
+			for (int chunkZ = 0; chunkZ < m_numChunksZ; chunkZ++)
+			{
+				Chunk chunk;
+				chunk.baseVertex = (GLint)m_vertices.size();
+				chunk.minExtents = glm::vec3(std::numeric_limits<float>::max());
+				chunk.maxExtents = glm::vec3(-std::numeric_limits<float>::max());
+
+				// Chunks on the far edges may hang off the grid, clamping repeats the last row so the extra cells have no area
+				for (int localX = 0; localX < KChunkVerts; localX++)
+				{
+					const int x{ std::min(chunkX * KChunkCells + localX, numVertX - 1) };
+					for (int localZ = 0; localZ < KChunkVerts; localZ++)
+					{
+						const int z{ std::min(chunkZ * KChunkCells + localZ, numVertZ - 1) };
+						const size_t index{ (size_t)x * numVertZ + z };
+
+						m_vertices.push_back(Vertex{ positions[index], normals[index], uvs[index] });
+						chunk.minExtents = glm::min(chunk.minExtents, positions[index]);
+						chunk.maxExtents = glm::max(chunk.maxExtents, positions[index]);
+					}
+				}
+
+				m_chunks.push_back(chunk);
+			}
+		}
+
+		BuildElements();
+
+		return true;
+	}
+
+	// One set of elements per level and stitch combination, shared by every chunk
+	void Terrain::BuildElements()
+	{
+		m_elements.clear();
+
+		for (int lod = 0; lod < KNumLods; lod++)
+		{
+			const int step{ 1 << lod };
+			const int cells{ KChunkCells / step };
+
+			for (unsigned int stitch = 0; stitch < KNumStitchVariants; stitch++)
+			{
+				// The coarsest level never has a coarser neighbour
+				if (lod == KNumLods - 1 && stitch != 0)
+				{
+					m_elementRanges[lod][stitch] = m_elementRanges[lod][0];
+					continue;
+				}
+
+				// On a stitched edge every odd vertex is moved onto the even vertex before it. The edge then matches the
+				// neighbour's coarser edge so there are no cracks, and the triangles that collapse are left out.
+				auto element = [stitch, cells, step](int x, int z)
+				{
+					if (((x == 0 && (stitch & KStitchNegX)) || (x == cells && (stitch & KStitchPosX))) && z % 2)
+						z--;
+					if (((z == 0 && (stitch & KStitchNegZ)) || (z == cells && (stitch & KStitchPosZ))) && x % 2)
+						x--;
+					return (GLushort)(x * step * KChunkVerts + z * step);
+				};
+
+				auto addTriangle = [this](GLushort a, GLushort b, GLushort c)
+				{
+					if (a != b && b != c && a != c)
+						m_elements.insert(m_elements.end(), { a, b, c });
+				};
+
+				ElementRange& range{ m_elementRanges[lod][stitch] };
+				range.first = m_elements.size();
+
+				// The diagonal alternates per cell to avoid a striped look.
+				// Chunks start on even cells so the pattern lines up across chunk borders.
+				for (int cellX = 0; cellX < cells; cellX++)
+				{
+					for (int cellZ = 0; cellZ < cells; cellZ++)
+					{
+						const GLushort v00{ element(cellX, cellZ) };
+						const GLushort v01{ element(cellX, cellZ + 1) };
+						const GLushort v10{ element(cellX + 1, cellZ) };
+						const GLushort v11{ element(cellX + 1, cellZ + 1) };
+
+						if ((cellX + cellZ) % 2)
+						{
+							addTriangle(v00, v01, v10);
+							addTriangle(v01, v11, v10);
+						}
+						else
+						{
+							addTriangle(v00, v01, v11);
+							addTriangle(v00, v11, v10);
+						}
+					}
+				}
+
+				range.count = (GLsizei)(m_elements.size() - range.first);
+			}
+		}
+	}
+
+	// Builds the chunks and uploads them to OpenGL
+	bool Terrain::Create(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals,
+		const std::vector<glm::vec2>& uvs, int numVertX, int numVertZ)
+	{
+		if (!BuildChunks(positions, normals, uvs, numVertX, numVertZ))
+			return false;
+
+		glGenBuffers(1, &m_vertexBuffer);
+		glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * m_vertices.size(), m_vertices.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		glGenBuffers(1, &m_elementBuffer);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_elementBuffer);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLushort) * m_elements.size(), m_elements.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+		glGenVertexArrays(1, &m_VAO);
+		GLState::Get().BindVertexArray(m_VAO);
+
+		glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, uv));
+
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_elementBuffer);
+		GLState::Get().BindVertexArray(0);
+
+		// Everything needed to draw is now in OpenGL
+		m_vertices = std::vector<Vertex>();
+
+		return true;
+	}
+
+	// Fills visibleChunks with the index of every chunk inside the frustum, returns the number of triangles they contain
+	size_t Terrain::Cull(const Frustum& frustum, std::vector<size_t>& visibleChunks) const
+	{
+		visibleChunks.clear();
+		for (size_t i = 0; i < m_chunks.size(); i++)
+		{
+			if (frustum.IntersectsAABB(m_chunks[i].minExtents, m_chunks[i].maxExtents))
+				visibleChunks.push_back(i);
+		}
+
+		return visibleChunks.size() * m_elementRanges[0][0].count / 3;
+	}
+
+	// Picks a level for every chunk from its distance to the camera. Neighbours never differ by more than one level.
+	void Terrain::SelectLods(const glm::vec3& cameraPosition, std::vector<int>& chunkLods) const
+	{
+		chunkLods.resize(m_chunks.size());
+		for (size_t i = 0; i < m_chunks.size(); i++)
+		{
+			const glm::vec3 closest{ glm::clamp(cameraPosition, m_chunks[i].minExtents, m_chunks[i].maxExtents) };
+			const float distance{ glm::distance(cameraPosition, closest) / m_lodDistance };
+
+			int lod{ 0 };
+			while (lod < KNumLods - 1 && distance >= (float)(1 << lod))
+				lod++;
+			chunkLods[i] = lod;
+		}
+
+		// Pull down any chunk more than one level coarser than a neighbour, repeated until nothing changes.
+		// Levels only ever drop so this settles within KNumLods passes.
+		bool changed{ true };
+		while (changed)
+		{
+			changed = false;
+			for (int chunkX = 0; chunkX < m_numChunksX; chunkX++)
+			{
+				for (int chunkZ = 0; chunkZ < m_numChunksZ; chunkZ++)
+				{
+					int& lod{ chunkLods[(size_t)chunkX * m_numChunksZ + chunkZ] };
+					int finest{ lod };
+					if (chunkX > 0)
+						finest = std::min(finest, chunkLods[(size_t)(chunkX - 1) * m_numChunksZ + chunkZ]);
+					if (chunkX < m_numChunksX - 1)
+						finest = std::min(finest, chunkLods[(size_t)(chunkX + 1) * m_numChunksZ + chunkZ]);
+					if (chunkZ > 0)
+						finest = std::min(finest, chunkLods[(size_t)chunkX * m_numChunksZ + chunkZ - 1]);
+					if (chunkZ < m_numChunksZ - 1)
+						finest = std::min(finest, chunkLods[(size_t)chunkX * m_numChunksZ + chunkZ + 1]);
+
+					if (lod > finest + 1)
+					{
+						lod = finest + 1;
+						changed = true;
+					}
+				}
+			}
+		}
+	}
+
+	// The elements to draw a chunk with given the levels chosen by SelectLods
+	const Terrain::ElementRange& Terrain::GetElementRange(size_t chunk, const std::vector<int>& chunkLods) const
+	{
+		const int chunkX{ (int)(chunk / m_numChunksZ) };
+		const int chunkZ{ (int)(chunk % m_numChunksZ) };
+		const int lod{ chunkLods[chunk] };
+
+		unsigned int stitch{ 0 };
+		if (chunkX > 0 && chunkLods[chunk - m_numChunksZ] > lod)
+			stitch |= KStitchNegX;
+		if (chunkX < m_numChunksX - 1 && chunkLods[chunk + m_numChunksZ] > lod)
+			stitch |= KStitchPosX;
+		if (chunkZ > 0 && chunkLods[chunk - 1] > lod)
+			stitch |= KStitchNegZ;
+		if (chunkZ < m_numChunksZ - 1 && chunkLods[chunk + 1] > lod)
+			stitch |= KStitchPosZ;
+
+		return m_elementRanges[lod][stitch];
+	}
+
+	// Triangles drawn for the visible chunks at the given levels
+	size_t Terrain::CountTriangles(const std::vector<size_t>& visibleChunks, const std::vector<int>& chunkLods) const
+	{
+		size_t numElements{ 0 };
+		for (size_t chunk : visibleChunks)
+			numElements += GetElementRange(chunk, chunkLods).count;
+
+		return numElements / 3;
+	}
+
+	// Culls and picks levels for this frame, filling the draw lists
+	void Terrain::Update(const glm::mat4& viewProjection, const glm::vec3& cameraPosition)
+	{
+		if (m_cullingEnabled)
+		{
+			Cull(Frustum(viewProjection), m_visibleChunks);
+		}
+		else
+		{
+			m_visibleChunks.resize(m_chunks.size());
+			for (size_t i = 0; i < m_chunks.size(); i++)
+				m_visibleChunks[i] = i;
+		}
+
+		if (m_lodEnabled)
+			SelectLods(cameraPosition, m_chunkLods);
+		else
+			m_chunkLods.assign(m_chunks.size(), 0);
+
+		m_trianglesSubmitted = 0;
+
+		m_drawCounts.resize(m_visibleChunks.size());
+		m_drawOffsets.resize(m_visibleChunks.size());
+		m_drawBaseVertices.resize(m_visibleChunks.size());
+		for (size_t i = 0; i < m_visibleChunks.size(); i++)
+		{
+			const ElementRange& range{ GetElementRange(m_visibleChunks[i], m_chunkLods) };
+			m_drawCounts[i] = range.count;
+			m_drawOffsets[i] = (void*)(range.first * sizeof(GLushort));
+			m_drawBaseVertices[i] = m_chunks[m_visibleChunks[i]].baseVertex;
+			m_trianglesSubmitted += range.count / 3;
+		}
+	}
+
+	// Draws the chunks chosen by the last Update, the program and texture should already be bound
+	void Terrain::Draw() const
+	{
+		if (m_visibleChunks.empty())
+			return;
+
+		GLState::Get().BindVertexArray(m_VAO);
+		glMultiDrawElementsBaseVertex(GL_TRIANGLES, m_drawCounts.data(), GL_UNSIGNED_SHORT, m_drawOffsets.data(),
+			(GLsizei)m_visibleChunks.size(), m_drawBaseVertices.data());
+	}
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "ExternalLibraryHeaders.h"
+#include "Frustum.h"
+
+namespace Helpers
+{
+	// Height field terrain split into square chunks that are culled against the view frustum
+	// Every chunk has its own block of vertices so they can all share one element buffer
+	// Distant chunks use coarser element lists (geomipmapping), stitched along edges that meet a coarser neighbour
+	class Terrain
+	{
+	public:
+		// Cells along each side of a chunk
+		static constexpr int KChunkCells{ 32 };
+		static constexpr int KChunkVerts{ KChunkCells + 1 };
+
+		// Level n steps over 2^n vertices, so the coarsest level is a single cell
+		static constexpr int KNumLods{ 6 };
+
+		// Set for each side of a chunk whose neighbour is one level coarser, selects the stitched element list
+		enum StitchEdge : unsigned int
+		{
+			KStitchNegX = 1,
+			KStitchPosX = 2,
+			KStitchNegZ = 4,
+			KStitchPosZ = 8,
+			KNumStitchVariants = 16
+		};
+
+		struct Vertex
+		{
+			glm::vec3 position;
+			glm::vec3 normal;
+			glm::vec2 uv;
+		};
+
+		struct Chunk
+		{
+			glm::vec3 minExtents;
+			glm::vec3 maxExtents;
+			GLint baseVertex;
+		};
+
+		// Part of the shared element list for one level and stitch combination
+		struct ElementRange
+		{
+			size_t first{ 0 };
+			GLsizei count{ 0 };
+		};
+	private:
+		std::vector<Chunk> m_chunks;
+		int m_numChunksX{ 0 };
+		int m_numChunksZ{ 0 };
+
+		// CPU copies, the vertices are released once uploaded
+		std::vector<Vertex> m_vertices;
+		std::vector<GLushort> m_elements;
+		ElementRange m_elementRanges[KNumLods][KNumStitchVariants];
+
+		GLuint m_VAO{ 0 };
+		GLuint m_vertexBuffer{ 0 };
+		GLuint m_elementBuffer{ 0 };
+
+		// Per frame draw lists for glMultiDrawElementsBaseVertex, kept to avoid reallocating.
+		// Mutable as GLEW declares the arrays non const even though OpenGL only reads them.
+		std::vector<size_t> m_visibleChunks;
+		std::vector<int> m_chunkLods;
+		mutable std::vector<GLsizei> m_drawCounts;
+		mutable std::vector<void*> m_drawOffsets;
+		mutable std::vector<GLint> m_drawBaseVertices;
+
+		bool m_cullingEnabled{ true };
+		bool m_lodEnabled{ true };
+		size_t m_trianglesSubmitted{ 0 };
+
+		// Chunks closer than this are drawn at full detail, each level after covers double the distance
+		float m_lodDistance{ 4000.0f };
+
+		void BuildElements();
+	public:
+		Terrain() = default;
+		~Terrain();
+
+		Terrain(const Terrain&) = delete;
+		Terrain& operator=(const Terrain&) = delete;
+
+		// Split a grid of vertices into chunks. The grid is x major i.e. vertex (x, z) is at x * numVertZ + z
+		// CPU only so it can be used without an OpenGL context. Returns false if the input is the wrong size.
+		bool BuildChunks(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals,
+			const std::vector<glm::vec2>& uvs, int numVertX, int numVertZ);
+
+		// Builds the chunks and uploads them to OpenGL
+		bool Create(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals,
+			const std::vector<glm::vec2>& uvs, int numVertX, int numVertZ);
+
+		// Fills visibleChunks with the index of every chunk inside the frustum, returns the number of triangles they contain at full detail
+		size_t Cull(const Frustum& frustum, std::vector<size_t>& visibleChunks) const;
+
+		// Picks a level for every chunk from its distance to the camera. Neighbours never differ by more than one level.
+		void SelectLods(const glm::vec3& cameraPosition, std::vector<int>& chunkLods) const;
+
+		// The elements to draw a chunk with given the levels chosen by SelectLods
+		const ElementRange& GetElementRange(size_t chunk, const std::vector<int>& chunkLods) const;
+		const ElementRange& GetElementRange(int lod, unsigned int stitch) const { return m_elementRanges[lod][stitch]; }
+		const std::vector<GLushort>& GetElements() const { return m_elements; }
+
+		// Triangles drawn for the visible chunks at the given levels
+		size_t CountTriangles(const std::vector<size_t>& visibleChunks, const std::vector<int>& chunkLods) const;
+
+		// Culls and picks levels for this frame then draws, the program and texture should already be bound
+		void Render(const glm::mat4& viewProjection, const glm::vec3& cameraPosition) { Update(viewProjection, cameraPosition); Draw(); }
+
+		// Culls and picks levels for this frame, filling the draw lists
+		void Update(const glm::mat4& viewProjection, const glm::vec3& cameraPosition);
+
+		// Draws the chunks chosen by the last Update, the program and texture should already be bound
+		void Draw() const;
+
+		size_t NumChunks() const { return m_chunks.size(); }
+		size_t NumVisibleChunks() const { return m_visibleChunks.size(); }
+		size_t NumTriangles() const { return m_chunks.size() * m_elementRanges[0][0].count / 3; }
+		size_t NumTrianglesSubmitted() const { return m_trianglesSubmitted; }
+
+		// Allows comparing against drawing every chunk at full detail
+		bool& CullingEnabled() { return m_cullingEnabled; }
+		bool& LodEnabled() { return m_lodEnabled; }
+		float& LodDistance() { return m_lodDistance; }
+	};
+}
@@ -0,0 +1,214 @@
+#include "TerrainBuilder.h"
+#include "JobSystem.h"
+#include <emmintrin.h>
+
+namespace Helpers
+{
+	// Grid lines given to each job, enough to cover the cost of handing out the work
+	static constexpr size_t KLinesPerJob{ 16 };
+
+	// Uses the red channel of a loaded image, u runs along the image width and v down its height
+	bool TerrainBuilder::SetHeightmap(const ImageLoader& image)
+	{
+		const BYTE* data{ image.GetData() };
+		if (!data || image.Width() < 1 || image.Height() < 1)
+		{
+			std::cout << "TerrainBuilder::SetHeightmap image has not been loaded" << std::endl;
+			return false;
+		}
+
+		m_sourceWidth = image.Width();
+		m_sourceHeight = image.Height();
+		m_heights.resize((size_t)m_sourceWidth * m_sourceHeight);
+
+		for (int v = 0; v < m_sourceHeight; v++)
+			for (int u = 0; u < m_sourceWidth; u++)
+				m_heights[(size_t)u * m_sourceHeight + v] = data[((size_t)v * m_sourceWidth + u) * 4] / 255.0f;
+
+		return true;
+	}
+
+	// Evaluates source(x, z) once per point of a width x height grid
+	void TerrainBuilder::SetProcedural(int width, int height, const std::function<float(int, int)>& source)
+	{
+		m_sourceWidth = std::max(width, 1);
+		m_sourceHeight = std::max(height, 1);
+		m_heights.resize((size_t)m_sourceWidth * m_sourceHeight);
+
+		for (int u = 0; u < m_sourceWidth; u++)
+			for (int v = 0; v < m_sourceHeight; v++)
+				m_heights[(size_t)u * m_sourceHeight + v] = source(u, v);
+	}
+
+	// Takes a width x height grid of heights that is already x major i.e. the height at (x, z) is at x * height + z
+	bool TerrainBuilder::SetHeights(int width, int height, std::vector<float>&& heights)
+	{
+		if (width < 1 || height < 1 || heights.size() != (size_t)width * height)
+		{
+			std::cout << "TerrainBuilder::SetHeights grid size does not match the heights" << std::endl;
+			return false;
+		}
+
+		m_sourceWidth = width;
+		m_sourceHeight = height;
+		m_heights = std::move(heights);
+		return true;
+	}
+
+	// Bilinear sample at u, v in the range 0 to 1, the scalar reference for the row sampler
+	float TerrainBuilder::Sample(float u, float v) const
+	{
+		const float su{ glm::clamp(u, 0.0f, 1.0f) * (m_sourceWidth - 1) };
+		const float sv{ glm::clamp(v, 0.0f, 1.0f) * (m_sourceHeight - 1) };
+		const int u0{ std::min((int)su, std::max(m_sourceWidth - 2, 0)) };
+		const int v0{ std::min((int)sv, std::max(m_sourceHeight - 2, 0)) };
+		const int u1{ std::min(u0 + 1, m_sourceWidth - 1) };
+		const int v1{ std::min(v0 + 1, m_sourceHeight - 1) };
+
+		auto height = [this](int x, int z) { return m_heights[(size_t)x * m_sourceHeight + z]; };
+		const float lower{ glm::mix(height(u0, v0), height(u0, v1), sv - v0) };
+		const float upper{ glm::mix(height(u1, v0), height(u1, v1), sv - v0) };
+		return glm::mix(lower, upper, su - u0);
+	}
+
+	// Bilinear samples count heights along the line at u, with v going from 0 to 1.
+	// First the two source columns either side of u are blended into column, which is contiguous so four at a time,
+	// then each output picks its pair from column and blends those four at a time.
+	void TerrainBuilder::SampleLine(float u, int count, std::vector<float>& column, float* heights) const
+	{
+		const float su{ glm::clamp(u, 0.0f, 1.0f) * (m_sourceWidth - 1) };
+		const int u0{ std::min((int)su, std::max(m_sourceWidth - 2, 0)) };
+		const int u1{ std::min(u0 + 1, m_sourceWidth - 1) };
+
+		const float* columnA{ m_heights.data() + (size_t)u0 * m_sourceHeight };
+		const float* columnB{ m_heights.data() + (size_t)u1 * m_sourceHeight };
+
+		// One extra at the end so v0 + 1 is always valid, even for the last sample
+		column.resize((size_t)m_sourceHeight + 1);
+
+		const __m128 weightU{ _mm_set1_ps(su - u0) };
+		int v{ 0 };
+		for (; v + 4 <= m_sourceHeight; v += 4)
+		{
+			const __m128 a{ _mm_loadu_ps(columnA + v) };
+			const __m128 b{ _mm_loadu_ps(columnB + v) };
+			_mm_storeu_ps(column.data() + v, _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), weightU)));
+		}
+		for (; v < m_sourceHeight; v++)
+			column[v] = columnA[v] + (columnB[v] - columnA[v]) * (su - u0);
+		column[m_sourceHeight] = column[m_sourceHeight - 1];
+
+		const float vScale{ count > 1 ? (float)(m_sourceHeight - 1) / (count - 1) : 0.0f };
+		const __m128 scale{ _mm_set1_ps(vScale) };
+		const __m128 laneOffsets{ _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f) };
+
+		alignas(16) int v0[4];
+		int z{ 0 };
+		for (; z + 4 <= count; z += 4)
+		{
+			// Always positive so truncating is the same as floor
+			const __m128 sv{ _mm_mul_ps(_mm_add_ps(_mm_set1_ps((float)z), laneOffsets), scale) };
+			const __m128i index{ _mm_cvttps_epi32(sv) };
+			const __m128 weightV{ _mm_sub_ps(sv, _mm_cvtepi32_ps(index)) };
+			_mm_store_si128((__m128i*)v0, index);
+
+			const __m128 a{ _mm_set_ps(column[v0[3]], column[v0[2]], column[v0[1]], column[v0[0]]) };
+			const __m128 b{ _mm_set_ps(column[v0[3] + 1], column[v0[2] + 1], column[v0[1] + 1], column[v0[0] + 1]) };
+			_mm_storeu_ps(heights + z, _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), weightV)));
+		}
+		for (; z < count; z++)
+		{
+			const float sv{ z * vScale };
+			const int index{ (int)sv };
+			heights[z] = column[index] + (column[index + 1] - column[index]) * (sv - index);
+		}
+	}
+
+	// Resamples the source to numVertX x numVertZ heights, x major like Build. Lines are spread across the job system.
+	void TerrainBuilder::SampleGrid(int numVertX, int numVertZ, std::vector<float>& heights) const
+	{
+		heights.resize((size_t)numVertX * numVertZ);
+		if (m_heights.empty())
+			return;
+
+		JobSystem::Get().ParallelFor((size_t)numVertX, KLinesPerJob, [&](size_t begin, size_t end)
+			{
+				std::vector<float> column;
+				for (size_t x = begin; x < end; x++)
+					SampleLine(numVertX > 1 ? (float)x / (numVertX - 1) : 0.0f, numVertZ, column, heights.data() + x * numVertZ);
+			});
+	}
+
+	// Fills numVertX x numVertZ vertices in the x major layout Terrain::BuildChunks takes i.e. vertex (x, z) is at x * numVertZ + z
+	bool TerrainBuilder::Build(int numVertX, int numVertZ, const glm::vec2& spacing, float heightScale, float uvTiling,
+		std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals, std::vector<glm::vec2>& uvs) const
+	{
+		if (m_heights.empty() || numVertX < 2 || numVertZ < 2)
+		{
+			std::cout << "TerrainBuilder::Build needs a height source and at least a 2 x 2 grid" << std::endl;
+			return false;
+		}
+
+		std::vector<float> heights;
+		SampleGrid(numVertX, numVertZ, heights);
+
+		const size_t numVerts{ heights.size() };
+		positions.resize(numVerts);
+		uvs.resize(numVerts);
+
+		JobSystem::Get().ParallelFor((size_t)numVertX, KLinesPerJob, [&](size_t begin, size_t end)
+			{
+				for (size_t x = begin; x < end; x++)
+				{
+					for (int z = 0; z < numVertZ; z++)
+					{
+						float& height{ heights[x * numVertZ + z] };
+						height *= heightScale;
+
+						positions[x * numVertZ + z] = glm::vec3(x * spacing.x, height, z * spacing.y);
+						uvs[x * numVertZ + z] = glm::vec2((float)x / (numVertX - 1), (float)z / (numVertZ - 1)) * uvTiling;
+					}
+				}
+			});
+
+		ComputeGridNormals(heights, numVertX, numVertZ, spacing, normals);
+		return true;
+	}
+
+	// Normals of a height grid from central differences (one sided along the edges), x major like TerrainBuilder::Build.
+	// Each normal only reads the heights around it so lines are spread across the job system.
+	void ComputeGridNormals(const std::vector<float>& heights, int numVertX, int numVertZ, const glm::vec2& spacing,
+		std::vector<glm::vec3>& normals)
+	{
+		normals.resize(heights.size());
+		if (numVertX < 2 || numVertZ < 2 || heights.size() != (size_t)numVertX * numVertZ)
+		{
+			std::fill(normals.begin(), normals.end(), glm::vec3(0, 1, 0));
+			return;
+		}
+
+		JobSystem::Get().ParallelFor((size_t)numVertX, KLinesPerJob, [&](size_t begin, size_t end)
+			{
+				for (size_t x = begin; x < end; x++)
+				{
+					const size_t xBefore{ x > 0 ? x - 1 : x };
+					const size_t xAfter{ x < (size_t)numVertX - 1 ? x + 1 : x };
+					const float* previous{ heights.data() + xBefore * numVertZ };
+					const float* current{ heights.data() + x * numVertZ };
+					const float* next{ heights.data() + xAfter * numVertZ };
+					const float dx{ (xAfter - xBefore) * spacing.x };
+
+					glm::vec3* line{ normals.data() + x * numVertZ };
+					for (int z = 0; z < numVertZ; z++)
+					{
+						const int zBefore{ std::max(z - 1, 0) };
+						const int zAfter{ std::min(z + 1, numVertZ - 1) };
+
+						const float slopeX{ (next[z] - previous[z]) / dx };
+						const float slopeZ{ (current[zAfter] - current[zBefore]) / ((zAfter - zBefore) * spacing.y) };
+						line[z] = glm::normalize(glm::vec3(-slopeX, 1.0f, -slopeZ));
+					}
+				}
+			});
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "ExternalLibraryHeaders.h"
+#include "ImageLoader.h"
+#include <functional>
+
+namespace Helpers
+{
+	// Generates the vertex grid for a Terrain from a height source, either a heightmap image or a procedural function
+	// The source is resampled with bilinear filtering so the grid size does not need to match it
+	class TerrainBuilder
+	{
+	private:
+		// Source heights in the range 0 to 1. Stored with v contiguous so one line of the output grid reads along memory.
+		std::vector<float> m_heights;
+		int m_sourceWidth{ 0 };
+		int m_sourceHeight{ 0 };
+
+		void SampleLine(float u, int count, std::vector<float>& column, float* heights) const;
+	public:
+		// Uses the red channel of a loaded image, u runs along the image width and v down its height
+		bool SetHeightmap(const ImageLoader& image);
+
+		// Evaluates source(x, z) once per point of a width x height grid
+		void SetProcedural(int width, int height, const std::function<float(int, int)>& source);
+
+		// Takes a width x height grid of heights that is already x major i.e. the height at (x, z) is at x * height + z
+		bool SetHeights(int width, int height, std::vector<float>&& heights);
+
+		int SourceWidth() const { return m_sourceWidth; }
+		int SourceHeight() const { return m_sourceHeight; }
+
+		// Bilinear sample at u, v in the range 0 to 1, the scalar reference for the row sampler
+		float Sample(float u, float v) const;
+
+		// Resamples the source to numVertX x numVertZ heights, x major like Build. Lines are spread across the job system.
+		void SampleGrid(int numVertX, int numVertZ, std::vector<float>& heights) const;
+
+		// Fills numVertX x numVertZ vertices in the x major layout Terrain::BuildChunks takes i.e. vertex (x, z) is at x * numVertZ + z
+		// Heights are scaled by heightScale and uvs repeat uvTiling times across the grid. Returns false if there is no source.
+		bool Build(int numVertX, int numVertZ, const glm::vec2& spacing, float heightScale, float uvTiling,
+			std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals, std::vector<glm::vec2>& uvs) const;
+	};
+
+	// Normals of a height grid from central differences (one sided along the edges), x major like TerrainBuilder::Build.
+	// Lines are spread across the job system.
+	void ComputeGridNormals(const std::vector<float>& heights, int numVertX, int numVertZ, const glm::vec2& spacing,
+		std::vector<glm::vec3>& normals);
+}
@@ -0,0 +1,517 @@
+#include "TextureCompression.h"
+#include "JobSystem.h"
+
+namespace Helpers
+{
+	// Rows of blocks encoded by each job
+	static constexpr size_t KBlockRowsPerJob{ 4 };
+
+	size_t CompressedImage::SizeInBytes() const
+	{
+		size_t bytes{ 0 };
+		for (const CompressedLevel& level : levels)
+			bytes += level.data.size();
+
+		return bytes;
+	}
+
+	// Bytes for one 4x4 block
+	size_t BlockBytes(CompressedFormat format)
+	{
+		return format == KFormatBC1 || format == KFormatBC4 ? 8 : 16;
+	}
+
+	// The matching OpenGL internal format
+	GLenum GLFormat(CompressedFormat format)
+	{
+		switch (format)
+		{
+		case KFormatBC1:
+			return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		case KFormatBC2:
+			return GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+		case KFormatBC3:
+			return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		case KFormatBC4:
+			return GL_COMPRESSED_RED_RGTC1;
+		case KFormatBC5:
+			return GL_COMPRESSED_RG_RGTC2;
+		default:
+			return GL_COMPRESSED_RGBA_BPTC_UNORM;
+		}
+	}
+
+	// Short name for reports and the GUI e.g. "BC1"
+	const char* FormatName(CompressedFormat format)
+	{
+		static const char* KNames[KNumCompressedFormats]{ "BC1", "BC2", "BC3", "BC4", "BC5", "BC7" };
+		return format < KNumCompressedFormats ? KNames[format] : "Unknown";
+	}
+
+	// Bytes for a level of width x height texels, partial blocks at the edges count as whole ones
+	size_t CompressedLevelBytes(CompressedFormat format, int width, int height)
+	{
+		return (size_t)((width + 3) / 4) * (size_t)((height + 3) / 4) * BlockBytes(format);
+	}
+
+	static uint16_t PackRGB565(const glm::vec3& colour)
+	{
+		const glm::vec3 clamped{ glm::clamp(colour, glm::vec3(0.0f), glm::vec3(255.0f)) };
+		const int r{ (int)(clamped.r * 31.0f / 255.0f + 0.5f) };
+		const int g{ (int)(clamped.g * 63.0f / 255.0f + 0.5f) };
+		const int b{ (int)(clamped.b * 31.0f / 255.0f + 0.5f) };
+		return (uint16_t)((r << 11) | (g << 5) | b);
+	}
+
+	static glm::vec3 UnpackRGB565(uint16_t colour)
+	{
+		const int r{ (colour >> 11) & 31 };
+		const int g{ (colour >> 5) & 63 };
+		const int b{ colour & 31 };
+		return glm::vec3((float)((r << 3) | (r >> 2)), (float)((g << 2) | (g >> 4)), (float)((b << 3) | (b >> 2)));
+	}
+
+	// The colours the decoder will produce. Four colour mode interpolates thirds, three colour mode a half plus black.
+	static void BuildPalette(uint16_t c0, uint16_t c1, bool fourColour, glm::vec3 palette[4])
+	{
+		palette[0] = UnpackRGB565(c0);
+		palette[1] = UnpackRGB565(c1);
+		if (fourColour)
+		{
+			palette[2] = glm::round((2.0f * palette[0] + palette[1]) / 3.0f);
+			palette[3] = glm::round((palette[0] + 2.0f * palette[1]) / 3.0f);
+		}
+		else
+		{
+			palette[2] = glm::round((palette[0] + palette[1]) / 2.0f);
+			palette[3] = glm::vec3(0.0f);
+		}
+	}
+
+	static float DistanceSquared(const glm::vec3& a, const glm::vec3& b)
+	{
+		const glm::vec3 difference{ a - b };
+		return glm::dot(difference, difference);
+	}
+
+	// Writes a four colour block from two end points, ordered so the decoder picks four colour mode. Returns the squared error.
+	static float EncodeColours(const glm::vec3 texels[16], const glm::vec3& end0, const glm::vec3& end1, BYTE* block)
+	{
+		uint16_t c0{ PackRGB565(end0) };
+		uint16_t c1{ PackRGB565(end1) };
+		if (c0 < c1)
+			std::swap(c0, c1);
+
+		glm::vec3 palette[4];
+		BuildPalette(c0, c1, true, palette);
+
+		// Equal end points decode in three colour mode but index 0 is still c0, so every texel uses it
+		uint32_t indices{ 0 };
+		float error{ 0 };
+		for (int i = 0; i < 16; i++)
+		{
+			int best{ 0 };
+			float bestDistance{ DistanceSquared(texels[i], palette[0]) };
+			for (int entry = 1; c0 != c1 && entry < 4; entry++)
+			{
+				const float distance{ DistanceSquared(texels[i], palette[entry]) };
+				if (distance < bestDistance)
+				{
+					best = entry;
+					bestDistance = distance;
+				}
+			}
+
+			indices |= (uint32_t)best << (i * 2);
+			error += bestDistance;
+		}
+
+		memcpy(block, &c0, 2);
+		memcpy(block + 2, &c1, 2);
+		memcpy(block + 4, &indices, 4);
+		return error;
+	}
+
+	// End points from the principal axis of the texel colours, then one least squares refit to the chosen indices
+	static void EncodeColourBlock(const BYTE* rgba, BYTE* block)
+	{
+		glm::vec3 texels[16];
+		glm::vec3 mean{ 0.0f };
+		for (int i = 0; i < 16; i++)
+		{
+			texels[i] = glm::vec3(rgba[i * 4], rgba[i * 4 + 1], rgba[i * 4 + 2]);
+			mean += texels[i];
+		}
+		mean /= 16.0f;
+
+		glm::mat3 covariance{ 0.0f };
+		for (int i = 0; i < 16; i++)
+		{
+			const glm::vec3 offset{ texels[i] - mean };
+			covariance += glm::outerProduct(offset, offset);
+		}
+
+		// Power iteration converges on the direction the colours spread along most
+		glm::vec3 axis{ 1.0f, 1.0f, 1.0f };
+		for (int iteration = 0; iteration < 8; iteration++)
+		{
+			axis = covariance * axis;
+			const float length{ glm::length(axis) };
+			if (length < 1e-6f)
+				break;
+			axis /= length;
+		}
+
+		float minProjection{ 0 };
+		float maxProjection{ 0 };
+		if (glm::length(axis) > 0.5f)
+		{
+			minProjection = maxProjection = glm::dot(texels[0] - mean, axis);
+			for (int i = 1; i < 16; i++)
+			{
+				const float projection{ glm::dot(texels[i] - mean, axis) };
+				minProjection = std::min(minProjection, projection);
+				maxProjection = std::max(maxProjection, projection);
+			}
+		}
+
+		// Pull the ends in slightly, the extremes are usually outliers and the middle matters more
+		const float inset{ (maxProjection - minProjection) / 16.0f };
+		glm::vec3 end0{ mean + axis * (maxProjection - inset) };
+		glm::vec3 end1{ mean + axis * (minProjection + inset) };
+		float error{ EncodeColours(texels, end0, end1, block) };
+
+		// Refit the ends to the indices chosen. Index 0 is all end0, 1 all end1, 2 and 3 two thirds and one third.
+		uint16_t c0, c1;
+		uint32_t indices;
+		memcpy(&c0, block, 2);
+		memcpy(&c1, block + 2, 2);
+		memcpy(&indices, block + 4, 4);
+		if (c0 == c1)
+			return;
+
+		static const float KWeights[4]{ 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+		float aa{ 0 }, ab{ 0 }, bb{ 0 };
+		glm::vec3 ax{ 0.0f }, bx{ 0.0f };
+		for (int i = 0; i < 16; i++)
+		{
+			const float a{ KWeights[(indices >> (i * 2)) & 3] };
+			const float b{ 1.0f - a };
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			ax += a * texels[i];
+			bx += b * texels[i];
+		}
+
+		const float determinant{ aa * bb - ab * ab };
+		if (std::abs(determinant) < 1e-6f)
+			return;
+
+		end0 = (ax * bb - bx * ab) / determinant;
+		end1 = (bx * aa - ax * ab) / determinant;
+
+		BYTE refined[8];
+		if (EncodeColours(texels, end0, end1, refined) < error)
+			memcpy(block, refined, 8);
+	}
+
+	// Eight value mode between the lowest and highest alpha, three bit indices
+	static void EncodeAlphaBlock(const BYTE* rgba, BYTE* block)
+	{
+		BYTE minAlpha{ 255 };
+		BYTE maxAlpha{ 0 };
+		for (int i = 0; i < 16; i++)
+		{
+			minAlpha = std::min(minAlpha, rgba[i * 4 + 3]);
+			maxAlpha = std::max(maxAlpha, rgba[i * 4 + 3]);
+		}
+
+		block[0] = maxAlpha;
+		block[1] = minAlpha;
+
+		uint64_t bits{ 0 };
+		if (maxAlpha != minAlpha)
+		{
+			int palette[8]{ maxAlpha, minAlpha };
+			for (int i = 2; i < 8; i++)
+				palette[i] = ((8 - i) * maxAlpha + (i - 1) * minAlpha + 3) / 7;
+
+			for (int i = 0; i < 16; i++)
+			{
+				int best{ 0 };
+				for (int entry = 1; entry < 8; entry++)
+				{
+					if (std::abs(palette[entry] - rgba[i * 4 + 3]) < std::abs(palette[best] - rgba[i * 4 + 3]))
+						best = entry;
+				}
+
+				bits |= (uint64_t)best << (i * 3);
+			}
+		}
+
+		for (int i = 0; i < 6; i++)
+			block[2 + i] = (BYTE)(bits >> (i * 8));
+	}
+
+	// Encode one block of 16 RGBA texels, row by row. BC1 ignores alpha.
+	void EncodeBC1Block(const BYTE* rgba, BYTE* block)
+	{
+		EncodeColourBlock(rgba, block);
+	}
+
+	void EncodeBC3Block(const BYTE* rgba, BYTE* block)
+	{
+		EncodeAlphaBlock(rgba, block);
+		EncodeColourBlock(rgba, block + 8);
+	}
+
+	// BC3 colour blocks are always four colour whatever order the end points are in
+	static void DecodeColourBlock(const BYTE* block, BYTE* rgba, bool alwaysFourColour)
+	{
+		uint16_t c0, c1;
+		uint32_t indices;
+		memcpy(&c0, block, 2);
+		memcpy(&c1, block + 2, 2);
+		memcpy(&indices, block + 4, 4);
+
+		glm::vec3 palette[4];
+		const bool fourColour{ alwaysFourColour || c0 > c1 };
+		BuildPalette(c0, c1, fourColour, palette);
+
+		for (int i = 0; i < 16; i++)
+		{
+			// The last entry of a three colour block is transparent black
+			const uint32_t index{ (indices >> (i * 2)) & 3 };
+			const glm::vec3& colour{ palette[index] };
+			rgba[i * 4] = (BYTE)colour.r;
+			rgba[i * 4 + 1] = (BYTE)colour.g;
+			rgba[i * 4 + 2] = (BYTE)colour.b;
+			rgba[i * 4 + 3] = !fourColour && index == 3 ? 0 : 255;
+		}
+	}
+
+	// Also codes the channels of BC4 and BC5
+	static void DecodeAlphaBlock(const BYTE* block, BYTE* rgba, int channel = 3)
+	{
+		const int alpha0{ block[0] };
+		const int alpha1{ block[1] };
+
+		int palette[8]{ alpha0, alpha1 };
+		if (alpha0 > alpha1)
+		{
+			for (int i = 2; i < 8; i++)
+				palette[i] = ((8 - i) * alpha0 + (i - 1) * alpha1 + 3) / 7;
+		}
+		else
+		{
+			for (int i = 2; i < 6; i++)
+				palette[i] = ((6 - i) * alpha0 + (i - 1) * alpha1 + 2) / 5;
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+
+		uint64_t bits{ 0 };
+		for (int i = 0; i < 6; i++)
+			bits |= (uint64_t)block[2 + i] << (i * 8);
+
+		for (int i = 0; i < 16; i++)
+			rgba[i * 4 + channel] = (BYTE)palette[(bits >> (i * 3)) & 7];
+	}
+
+	// Decode one block back to 16 RGBA texels, used to measure the quality of the encoder
+	void DecodeBC1Block(const BYTE* block, BYTE* rgba)
+	{
+		DecodeColourBlock(block, rgba, false);
+	}
+
+	void DecodeBC2Block(const BYTE* block, BYTE* rgba)
+	{
+		DecodeColourBlock(block + 8, rgba, true);
+		for (int i = 0; i < 16; i++)
+		{
+			const int alpha{ (block[i / 2] >> ((i % 2) * 4)) & 0xF };
+			rgba[i * 4 + 3] = (BYTE)(alpha * 17);
+		}
+	}
+
+	void DecodeBC3Block(const BYTE* block, BYTE* rgba)
+	{
+		DecodeColourBlock(block + 8, rgba, true);
+		DecodeAlphaBlock(block, rgba);
+	}
+
+	void DecodeBC4Block(const BYTE* block, BYTE* rgba)
+	{
+		for (int i = 0; i < 16; i++)
+		{
+			rgba[i * 4 + 1] = rgba[i * 4 + 2] = 0;
+			rgba[i * 4 + 3] = 255;
+		}
+		DecodeAlphaBlock(block, rgba, 0);
+	}
+
+	void DecodeBC5Block(const BYTE* block, BYTE* rgba)
+	{
+		DecodeBC4Block(block, rgba);
+		DecodeAlphaBlock(block + 8, rgba, 1);
+	}
+
+	// Box filters RGBA8 into every level below the source, down to 1x1
+	void BuildMipChain(const BYTE* rgba, int width, int height, std::vector<std::vector<BYTE>>& levels)
+	{
+		levels.clear();
+
+		const BYTE* source{ rgba };
+		while (width > 1 || height > 1)
+		{
+			const int levelWidth{ std::max(width / 2, 1) };
+			const int levelHeight{ std::max(height / 2, 1) };
+			std::vector<BYTE> level((size_t)levelWidth * levelHeight * 4);
+
+			for (int y = 0; y < levelHeight; y++)
+			{
+				// Odd sizes repeat the last row or column
+				const int y0{ std::min(y * 2, height - 1) };
+				const int y1{ std::min(y * 2 + 1, height - 1) };
+				for (int x = 0; x < levelWidth; x++)
+				{
+					const int x0{ std::min(x * 2, width - 1) };
+					const int x1{ std::min(x * 2 + 1, width - 1) };
+					for (int channel = 0; channel < 4; channel++)
+					{
+						const int sum{ source[((size_t)y0 * width + x0) * 4 + channel] + source[((size_t)y0 * width + x1) * 4 + channel] +
+							source[((size_t)y1 * width + x0) * 4 + channel] + source[((size_t)y1 * width + x1) * 4 + channel] };
+						level[((size_t)y * levelWidth + x) * 4 + channel] = (BYTE)((sum + 2) / 4);
+					}
+				}
+			}
+
+			levels.push_back(std::move(level));
+			source = levels.back().data();
+			width = levelWidth;
+			height = levelHeight;
+		}
+	}
+
+	// Encodes one level, block rows spread across the job system
+	static void CompressLevel(const BYTE* rgba, int width, int height, CompressedFormat format, CompressedLevel& level)
+	{
+		level.width = width;
+		level.height = height;
+		level.data.resize(CompressedLevelBytes(format, width, height));
+
+		const int blocksX{ (width + 3) / 4 };
+		const int blocksY{ (height + 3) / 4 };
+		const size_t blockBytes{ BlockBytes(format) };
+
+		JobSystem::Get().ParallelFor((size_t)blocksY, KBlockRowsPerJob, [&](size_t begin, size_t end)
+			{
+				BYTE texels[16 * 4];
+				for (size_t blockY = begin; blockY < end; blockY++)
+				{
+					for (int blockX = 0; blockX < blocksX; blockX++)
+					{
+						// Blocks hanging over the edge repeat the last texels
+						for (int y = 0; y < 4; y++)
+						{
+							const int sourceY{ std::min((int)blockY * 4 + y, height - 1) };
+							for (int x = 0; x < 4; x++)
+							{
+								const int sourceX{ std::min(blockX * 4 + x, width - 1) };
+								memcpy(texels + (y * 4 + x) * 4, rgba + ((size_t)sourceY * width + sourceX) * 4, 4);
+							}
+						}
+
+						BYTE* block{ level.data.data() + (blockY * blocksX + blockX) * blockBytes };
+						if (format == KFormatBC1)
+							EncodeBC1Block(texels, block);
+						else
+							EncodeBC3Block(texels, block);
+					}
+				}
+			});
+	}
+
+	// Builds the mip chain and encodes every level, block rows spread across the job system
+	void CompressImage(const BYTE* rgba, int width, int height, CompressedFormat format, CompressedImage& image)
+	{
+		std::vector<std::vector<BYTE>> mips;
+		BuildMipChain(rgba, width, height, mips);
+
+		image.format = format;
+		image.levels.resize(mips.size() + 1);
+		CompressLevel(rgba, width, height, format, image.levels[0]);
+		for (size_t i = 0; i < mips.size(); i++)
+		{
+			width = std::max(width / 2, 1);
+			height = std::max(height / 2, 1);
+			CompressLevel(mips[i].data(), width, height, format, image.levels[i + 1]);
+		}
+	}
+
+	// Expands one compressed level back to RGBA8. Returns false for BC7 which has no CPU decoder.
+	bool DecompressLevel(const CompressedLevel& level, CompressedFormat format, std::vector<BYTE>& rgba)
+	{
+		static void (* const KDecoders[KNumCompressedFormats])(const BYTE*, BYTE*){
+			DecodeBC1Block, DecodeBC2Block, DecodeBC3Block, DecodeBC4Block, DecodeBC5Block, nullptr };
+		if (format >= KNumCompressedFormats || !KDecoders[format])
+			return false;
+
+		rgba.resize((size_t)level.width * level.height * 4);
+
+		const int blocksX{ (level.width + 3) / 4 };
+		const int blocksY{ (level.height + 3) / 4 };
+		const size_t blockBytes{ BlockBytes(format) };
+
+		BYTE texels[16 * 4];
+		for (int blockY = 0; blockY < blocksY; blockY++)
+		{
+			for (int blockX = 0; blockX < blocksX; blockX++)
+			{
+				const BYTE* block{ level.data.data() + ((size_t)blockY * blocksX + blockX) * blockBytes };
+				KDecoders[format](block, texels);
+
+				for (int y = 0; y < 4 && blockY * 4 + y < level.height; y++)
+					for (int x = 0; x < 4 && blockX * 4 + x < level.width; x++)
+						memcpy(rgba.data() + ((size_t)(blockY * 4 + y) * level.width + blockX * 4 + x) * 4, texels + (y * 4 + x) * 4, 4);
+			}
+		}
+
+		return true;
+	}
+
+	// Peak signal to noise ratio in dB over the RGB channels of two RGBA8 images the same size, higher is closer
+	double ComputePSNR(const BYTE* a, const BYTE* b, int width, int height)
+	{
+		double sumSquares{ 0 };
+		const size_t numTexels{ (size_t)width * height };
+		for (size_t i = 0; i < numTexels; i++)
+		{
+			for (int channel = 0; channel < 3; channel++)
+			{
+				const double difference{ (double)a[i * 4 + channel] - b[i * 4 + channel] };
+				sumSquares += difference * difference;
+			}
+		}
+
+		const double meanSquare{ sumSquares / (numTexels * 3.0) };
+		if (meanSquare == 0)
+			return 99.0;
+
+		return 10.0 * std::log10(255.0 * 255.0 / meanSquare);
+	}
+
+	// BC3 when any texel is not fully opaque, otherwise BC1 which is half the size
+	CompressedFormat ChooseFormat(const BYTE* rgba, int width, int height)
+	{
+		const size_t numTexels{ (size_t)width * height };
+		for (size_t i = 0; i < numTexels; i++)
+		{
+			if (rgba[i * 4 + 3] != 255)
+				return KFormatBC3;
+		}
+
+		return KFormatBC1;
+	}
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "ExternalLibraryHeaders.h"
+
+namespace Helpers
+{
+	// Block compressed formats that can be loaded, all code 4x4 texel blocks. The encoder only produces BC1 and BC3.
+	enum CompressedFormat
+	{
+		KFormatBC1,		// 8 bytes a block, RGB (DXT1)
+		KFormatBC2,		// 16 bytes a block, RGB plus 4 bit explicit alpha (DXT3)
+		KFormatBC3,		// 16 bytes a block, RGB plus separately coded alpha (DXT5)
+		KFormatBC4,		// 8 bytes a block, one channel (ATI1)
+		KFormatBC5,		// 16 bytes a block, two channels e.g. a normal map's x and y (ATI2)
+		KFormatBC7,		// 16 bytes a block, high quality RGBA, loaded but not decoded on the CPU
+		KNumCompressedFormats
+	};
+
+	// One level of a compressed mip chain
+	struct CompressedLevel
+	{
+		int width{ 0 };
+		int height{ 0 };
+		std::vector<BYTE> data;
+	};
+
+	// A block compressed texture with its mip chain, as stored in a DDS file and uploaded with glCompressedTexSubImage2D
+	struct CompressedImage
+	{
+		CompressedFormat format{ KFormatBC1 };
+		std::vector<CompressedLevel> levels;
+
+		int Width() const { return levels.empty() ? 0 : levels[0].width; }
+		int Height() const { return levels.empty() ? 0 : levels[0].height; }
+		size_t SizeInBytes() const;
+	};
+
+	// Bytes for one 4x4 block
+	size_t BlockBytes(CompressedFormat format);
+
+	// The matching OpenGL internal format
+	GLenum GLFormat(CompressedFormat format);
+
+	// Short name for reports and the GUI e.g. "BC1"
+	const char* FormatName(CompressedFormat format);
+
+	// Bytes for a level of width x height texels, partial blocks at the edges count as whole ones
+	size_t CompressedLevelBytes(CompressedFormat format, int width, int height);
+
+	// Encode one block of 16 RGBA texels, row by row. BC1 ignores alpha.
+	void EncodeBC1Block(const BYTE* rgba, BYTE* block);
+	void EncodeBC3Block(const BYTE* rgba, BYTE* block);
+
+	// Decode one block back to 16 RGBA texels, used to measure the quality of the encoder and check loaded files.
+	// BC4 decodes to red and BC5 to red and green, the other channels are 0 and alpha 255.
+	void DecodeBC1Block(const BYTE* block, BYTE* rgba);
+	void DecodeBC2Block(const BYTE* block, BYTE* rgba);
+	void DecodeBC3Block(const BYTE* block, BYTE* rgba);
+	void DecodeBC4Block(const BYTE* block, BYTE* rgba);
+	void DecodeBC5Block(const BYTE* block, BYTE* rgba);
+
+	// Box filters RGBA8 down to 1x1, levels holds every level below the source
+	void BuildMipChain(const BYTE* rgba, int width, int height, std::vector<std::vector<BYTE>>& levels);
+
+	// Builds the mip chain and encodes every level, block rows spread across the job system. format must be BC1 or BC3.
+	void CompressImage(const BYTE* rgba, int width, int height, CompressedFormat format, CompressedImage& image);
+
+	// Expands one compressed level back to RGBA8. Returns false for BC7 which has no CPU decoder.
+	bool DecompressLevel(const CompressedLevel& level, CompressedFormat format, std::vector<BYTE>& rgba);
+
+	// Peak signal to noise ratio in dB over the RGB channels of two RGBA8 images the same size, higher is closer
+	double ComputePSNR(const BYTE* a, const BYTE* b, int width, int height);
+
+	// BC3 when any texel is not fully opaque, otherwise BC1 which is half the size
+	CompressedFormat ChooseFormat(const BYTE* rgba, int width, int height);
+}
@@ -0,0 +1,343 @@
+#include "TextureManager.h"
+#include "ImageLoader.h"
+#include "GLState.h"
+#include "DDSFile.h"
+#include "TextureStreamer.h"
+#include <filesystem>
+namespace fs = std::filesystem;
+
+namespace Helpers
+{
+	Texture::Texture(const std::string& name, GLuint id, GLenum target, int width, int height, int layers, size_t gpuBytes) :
+		m_name(name), m_id(id), m_target(target), m_width(width), m_height(height), m_layers(layers), m_gpuBytes(gpuBytes)
+	{
+	}
+
+	Texture::~Texture()
+	{
+		glDeleteTextures(1, &m_id);
+	}
+
+	// Same string for every way of writing the same file's path
+	std::string TextureManager::Key(const std::string& filepath)
+	{
+		std::error_code error;
+		fs::path path{ fs::weakly_canonical(fs::path(filepath), error) };
+		if (error)
+			path = fs::path(filepath).lexically_normal();
+
+		// Windows paths are not case sensitive
+		std::string key{ path.make_preferred().string() };
+		std::transform(key.begin(), key.end(), key.begin(), [](char c) { return (char)std::tolower((unsigned char)c); });
+		return key;
+	}
+
+	// Drops entries whose textures have gone then records the new one
+	std::shared_ptr<Texture> TextureManager::Track(const std::string& key, std::shared_ptr<Texture> texture)
+	{
+		for (auto entry = m_textures.begin(); entry != m_textures.end();)
+			entry = entry->second.expired() ? m_textures.erase(entry) : std::next(entry);
+
+		m_textures[key] = texture;
+		return texture;
+	}
+
+	// The texture if it is still in use, otherwise nullptr. Check before decoding an image again.
+	std::shared_ptr<Texture> TextureManager::Find(const std::string& filepath)
+	{
+		const auto found{ m_textures.find(Key(filepath)) };
+		if (found == m_textures.end())
+			return nullptr;
+
+		std::shared_ptr<Texture> texture{ found->second.lock() };
+		if (texture)
+			m_numShared++;
+
+		return texture;
+	}
+
+	// Decodes and uploads the image unless it is already in use, the pixels are freed once uploaded. Returns nullptr on error.
+	// DDS files skip FreeImage, their blocks and mips go to GL as they are.
+	std::shared_ptr<Texture> TextureManager::Load(const std::string& filepath, GLint wrapMode)
+	{
+		if (std::shared_ptr<Texture> existing{ Find(filepath) })
+			return existing;
+
+		if (IsDDSFile(filepath))
+		{
+			CompressedImage image;
+			if (!LoadDDS(filepath, image))
+				return nullptr;
+
+			return AddCompressed(filepath, image, wrapMode);
+		}
+
+		ImageLoader image;
+		if (!image.Load(filepath))
+			return nullptr;
+
+		return Add(filepath, image, wrapMode);
+	}
+
+	// Uploads an image already decoded e.g. by the AssetLoader, or shares the texture already uploaded for filepath
+	std::shared_ptr<Texture> TextureManager::Add(const std::string& filepath, const ImageLoader& image, GLint wrapMode)
+	{
+		const std::string key{ Key(filepath) };
+		const auto found{ m_textures.find(key) };
+		if (found != m_textures.end())
+		{
+			if (std::shared_ptr<Texture> existing{ found->second.lock() })
+			{
+				m_numShared++;
+				return existing;
+			}
+		}
+
+		const GLuint id{ CreateTexture2D(image, wrapMode) };
+		if (id == 0)
+			return nullptr;
+
+		return Track(key, std::make_shared<Texture>(filepath, id, GL_TEXTURE_2D, image.Width(), image.Height(), 1,
+			MipChainBytes(image.Width(), image.Height(), 1)));
+	}
+
+	// Streams the image in over the next frames unless it is already in use. The texture can be bound straight away,
+	// it has no size until decoded and sharpens as its mips arrive. DDS files are small enough to load at once.
+	std::shared_ptr<Texture> TextureManager::Stream(const std::string& filepath, TextureStreamer& streamer, GLint wrapMode)
+	{
+		if (IsDDSFile(filepath))
+			return Load(filepath, wrapMode);
+
+		if (std::shared_ptr<Texture> existing{ Find(filepath) })
+			return existing;
+
+		GLuint id;
+		glGenTextures(1, &id);
+		std::shared_ptr<Texture> texture{ Track(Key(filepath), std::make_shared<Texture>(filepath, id, GL_TEXTURE_2D, 0, 0, 1, 0)) };
+		streamer.Stream(texture, filepath, wrapMode);
+		return texture;
+	}
+
+	// Uploads every level of a block compressed image, or shares the texture already uploaded for filepath
+	std::shared_ptr<Texture> TextureManager::AddCompressed(const std::string& filepath, const CompressedImage& image, GLint wrapMode)
+	{
+		const std::string key{ Key(filepath) };
+		const auto found{ m_textures.find(key) };
+		if (found != m_textures.end())
+		{
+			if (std::shared_ptr<Texture> existing{ found->second.lock() })
+			{
+				m_numShared++;
+				return existing;
+			}
+		}
+
+		const GLuint id{ CreateCompressedTexture(image, wrapMode) };
+		if (id == 0)
+			return nullptr;
+
+		return Track(key, std::make_shared<Texture>(filepath, id, GL_TEXTURE_2D, image.Width(), image.Height(), 1, image.SizeInBytes()));
+	}
+
+	// Loads the block compressed copy of an image baked by BakeTexture, baking it first if it is missing or older than the source.
+	// Falls back to an uncompressed upload if the bake cannot be written. DDS files are loaded as they are.
+	std::shared_ptr<Texture> TextureManager::LoadCompressed(const std::string& filepath, GLint wrapMode)
+	{
+		if (IsDDSFile(filepath))
+			return Load(filepath, wrapMode);
+
+		if (std::shared_ptr<Texture> existing{ Find(filepath) })
+			return existing;
+
+		CompressedImage image;
+		const std::string bakedPath{ BakedTexturePath(filepath) };
+		if (!(IsBakeCurrent(filepath, bakedPath) && LoadDDS(bakedPath, image)) && !BakeTexture(filepath, image))
+		{
+			std::cout << "Could not bake a compressed copy of " << filepath << ", using it uncompressed" << std::endl;
+			return Load(filepath, wrapMode);
+		}
+
+		return AddCompressed(filepath, image, wrapMode);
+	}
+
+	// Uploads six square block compressed images, +X -X +Y -Y +Z -Z with the top row first, as a cube map tracked under name.
+	// The faces must share a format and number of levels, returns nullptr if they do not.
+	std::shared_ptr<Texture> TextureManager::AddCompressedCubeMap(const std::string& name, const std::vector<CompressedImage>& faces)
+	{
+		const GLuint id{ CreateCompressedCubeMap(faces) };
+		if (id == 0)
+			return nullptr;
+
+		size_t gpuBytes{ 0 };
+		for (const CompressedImage& face : faces)
+			gpuBytes += face.SizeInBytes();
+
+		const int size{ faces[0].Width() };
+		return Track(name, std::make_shared<Texture>(name, id, GL_TEXTURE_CUBE_MAP, size, size, 6, gpuBytes));
+	}
+
+	TextureManager::Stats TextureManager::GetStats() const
+	{
+		Stats stats;
+		stats.numShared = m_numShared;
+		for (const auto& entry : m_textures)
+		{
+			if (std::shared_ptr<Texture> texture{ entry.second.lock() })
+			{
+				stats.numTextures++;
+				stats.gpuBytes += texture->GpuBytes();
+			}
+		}
+
+		return stats;
+	}
+
+	// Every texture still in use, for listing in the GUI
+	std::vector<std::shared_ptr<Texture>> TextureManager::GetTextures() const
+	{
+		std::vector<std::shared_ptr<Texture>> textures;
+		for (const auto& entry : m_textures)
+		{
+			if (std::shared_ptr<Texture> texture{ entry.second.lock() })
+				textures.push_back(texture);
+		}
+
+		return textures;
+	}
+
+	// Where the baked copy of an image lives, next to the source
+	std::string BakedTexturePath(const std::string& filepath)
+	{
+		return filepath + ".baked.dds";
+	}
+
+	// True if the baked copy at bakedPath exists and is no older than the source
+	bool IsBakeCurrent(const std::string& filepath, const std::string& bakedPath)
+	{
+		std::error_code error;
+		return fs::exists(bakedPath, error) &&
+			fs::last_write_time(bakedPath, error) >= fs::last_write_time(filepath, error) && !error;
+	}
+
+	// Decodes an image, compresses it and its mip chain (BC1 if opaque, BC3 if not) and writes them to BakedTexturePath.
+	// The compressed image is returned as well so a first run can upload it without reading the file back.
+	bool BakeTexture(const std::string& filepath, CompressedImage& image)
+	{
+		ImageLoader source;
+		if (!source.Load(filepath))
+			return false;
+
+		const CompressedFormat format{ ChooseFormat(source.GetData(), source.Width(), source.Height()) };
+		CompressImage(source.GetData(), source.Width(), source.Height(), format, image);
+
+		return SaveDDS(BakedTexturePath(filepath), image);
+	}
+
+	// Mipmapped RGBA8 2D texture from an image, returns 0 if the image has no pixels
+	GLuint CreateTexture2D(const ImageLoader& image, GLint wrapMode)
+	{
+		if (!image.GetData())
+			return 0;
+
+		GLuint texture;
+		glGenTextures(1, &texture);
+		GLState::Get().BindTexture(0, GL_TEXTURE_2D, texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapMode);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapMode);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.Width(), image.Height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, image.GetData());
+		glGenerateMipmap(GL_TEXTURE_2D);
+
+		return texture;
+	}
+
+	// 2D texture from every level of a block compressed image
+	GLuint CreateCompressedTexture(const CompressedImage& image, GLint wrapMode)
+	{
+		if (image.levels.empty())
+			return 0;
+
+		GLuint texture;
+		glGenTextures(1, &texture);
+		GLState::Get().BindTexture(0, GL_TEXTURE_2D, texture);
+		glTexStorage2D(GL_TEXTURE_2D, (GLsizei)image.levels.size(), GLFormat(image.format), image.Width(), image.Height());
+		for (size_t i = 0; i < image.levels.size(); i++)
+		{
+			const CompressedLevel& level{ image.levels[i] };
+			glCompressedTexSubImage2D(GL_TEXTURE_2D, (GLint)i, 0, 0, level.width, level.height, GLFormat(image.format),
+				(GLsizei)level.data.size(), level.data.data());
+		}
+
+		const bool mipmapped{ image.levels.size() > 1 };
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mipmapped ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapMode);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapMode);
+
+		return texture;
+	}
+
+	// Sampling across a face edge must never reach the opposite edge of the same face
+	static void SetCubeMapParameters(bool mipmapped)
+	{
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, mipmapped ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	}
+
+	// Cube map from six block compressed images in GL face order, every level uploaded as it is. Returns 0 if they differ.
+	GLuint CreateCompressedCubeMap(const std::vector<CompressedImage>& faces)
+	{
+		if (faces.size() != 6 || faces[0].levels.empty())
+			return 0;
+
+		const CompressedImage& first{ faces[0] };
+		for (const CompressedImage& face : faces)
+		{
+			if (face.format != first.format || face.levels.size() != first.levels.size() ||
+				face.Width() != first.Width() || face.Height() != first.Width())
+			{
+				std::cout << "Cube map faces must all be square and share a size, format and mip count" << std::endl;
+				return 0;
+			}
+		}
+
+		GLuint texture;
+		glGenTextures(1, &texture);
+		GLState::Get().BindTexture(0, GL_TEXTURE_CUBE_MAP, texture);
+		glTexStorage2D(GL_TEXTURE_CUBE_MAP, (GLsizei)first.levels.size(), GLFormat(first.format), first.Width(), first.Width());
+		for (GLenum i = 0; i < 6; i++)
+		{
+			for (size_t j = 0; j < faces[i].levels.size(); j++)
+			{
+				const CompressedLevel& level{ faces[i].levels[j] };
+				glCompressedTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, (GLint)j, 0, 0, level.width, level.height,
+					GLFormat(first.format), (GLsizei)level.data.size(), level.data.data());
+			}
+		}
+
+		SetCubeMapParameters(first.levels.size() > 1);
+
+		return texture;
+	}
+
+	// Bytes for a full mip chain of RGBA8 texels
+	size_t MipChainBytes(int width, int height, int layers)
+	{
+		size_t bytes{ 0 };
+		while (true)
+		{
+			bytes += (size_t)width * height * layers * 4;
+			if (width == 1 && height == 1)
+				break;
+
+			width = std::max(width / 2, 1);
+			height = std::max(height / 2, 1);
+		}
+
+		return bytes;
+	}
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "ExternalLibraryHeaders.h"
+#include "TextureCompression.h"
+#include <unordered_map>
+
+namespace Helpers
+{
+	class ImageLoader;
+	class TextureStreamer;
+
+	// An OpenGL texture and what it costs, deleted when the last reference goes
+	class Texture
+	{
+	private:
+		std::string m_name;
+		GLuint m_id{ 0 };
+		GLenum m_target{ GL_TEXTURE_2D };
+		int m_width{ 0 };
+		int m_height{ 0 };
+		int m_layers{ 1 };
+		size_t m_gpuBytes{ 0 };
+	public:
+		Texture(const std::string& name, GLuint id, GLenum target, int width, int height, int layers, size_t gpuBytes);
+		~Texture();
+
+		Texture(const Texture&) = delete;
+		Texture& operator=(const Texture&) = delete;
+
+		const std::string& GetName() const { return m_name; }
+		GLuint GetId() const { return m_id; }
+		GLenum GetTarget() const { return m_target; }
+		int Width() const { return m_width; }
+		int Height() const { return m_height; }
+		int Layers() const { return m_layers; }
+
+		// Video memory used including the mip chain
+		size_t GpuBytes() const { return m_gpuBytes; }
+
+		// For textures created before their image is decoded, such as streamed ones
+		void SetSize(int width, int height, size_t gpuBytes) { m_width = width; m_height = height; m_gpuBytes = gpuBytes; }
+	};
+
+	// Shares textures by canonical file path so an image referenced from several places is only decoded and uploaded once.
+	// Only weak references are kept, a texture is deleted when its last user lets go. The CPU pixels are never kept.
+	class TextureManager
+	{
+	public:
+		struct Stats
+		{
+			size_t numTextures{ 0 };
+			size_t gpuBytes{ 0 };
+
+			// Requests served by a texture already uploaded
+			size_t numShared{ 0 };
+		};
+	private:
+		std::unordered_map<std::string, std::weak_ptr<Texture>> m_textures;
+		size_t m_numShared{ 0 };
+
+		std::shared_ptr<Texture> Track(const std::string& key, std::shared_ptr<Texture> texture);
+	public:
+		// Same string for every way of writing the same file's path
+		static std::string Key(const std::string& filepath);
+
+		// The texture if it is still in use, otherwise nullptr. Check before decoding an image again.
+		std::shared_ptr<Texture> Find(const std::string& filepath);
+
+		// Decodes and uploads the image unless it is already in use, the pixels are freed once uploaded. Returns nullptr on error.
+		// DDS files skip FreeImage, their blocks and mips go to GL as they are.
+		std::shared_ptr<Texture> Load(const std::string& filepath, GLint wrapMode = GL_REPEAT);
+
+		// Uploads an image already decoded e.g. by the AssetLoader, or shares the texture already uploaded for filepath
+		std::shared_ptr<Texture> Add(const std::string& filepath, const ImageLoader& image, GLint wrapMode = GL_REPEAT);
+
+		// Streams the image in over the next frames unless it is already in use. The texture can be bound straight away,
+		// it has no size until decoded and sharpens as its mips arrive. DDS files are small enough to load at once.
+		std::shared_ptr<Texture> Stream(const std::string& filepath, TextureStreamer& streamer, GLint wrapMode = GL_REPEAT);
+
+		// Uploads every level of a block compressed image, or shares the texture already uploaded for filepath
+		std::shared_ptr<Texture> AddCompressed(const std::string& filepath, const CompressedImage& image, GLint wrapMode = GL_REPEAT);
+
+		// Loads the block compressed copy of an image baked by BakeTexture, baking it first if it is missing or older than the source.
+		// Falls back to an uncompressed upload if the bake cannot be written. DDS files are loaded as they are.
+		std::shared_ptr<Texture> LoadCompressed(const std::string& filepath, GLint wrapMode = GL_REPEAT);
+
+		// Uploads six square block compressed images, +X -X +Y -Y +Z -Z with the top row first, as a cube map tracked under name.
+		// The faces must share a format and number of levels, returns nullptr if they do not.
+		std::shared_ptr<Texture> AddCompressedCubeMap(const std::string& name, const std::vector<CompressedImage>& faces);
+
+		Stats GetStats() const;
+
+		// Every texture still in use, for listing in the GUI
+		std::vector<std::shared_ptr<Texture>> GetTextures() const;
+	};
+
+	// Where the baked copy of an image lives, next to the source
+	std::string BakedTexturePath(const std::string& filepath);
+
+	// True if the baked copy at bakedPath exists and is no older than the source
+	bool IsBakeCurrent(const std::string& filepath, const std::string& bakedPath);
+
+	// Decodes an image, compresses it and its mip chain (BC1 if opaque, BC3 if not) and writes them to BakedTexturePath.
+	// The compressed image is returned as well so a first run can upload it without reading the file back.
+	bool BakeTexture(const std::string& filepath, CompressedImage& image);
+
+	// Mipmapped RGBA8 2D texture from an image, returns 0 if the image has no pixels
+	GLuint CreateTexture2D(const ImageLoader& image, GLint wrapMode);
+
+	// 2D texture from every level of a block compressed image
+	GLuint CreateCompressedTexture(const CompressedImage& image, GLint wrapMode);
+
+	// Cube map from six block compressed images in GL face order, every level uploaded as it is. Returns 0 if they differ.
+	GLuint CreateCompressedCubeMap(const std::vector<CompressedImage>& faces);
+
+	// Bytes for a full mip chain of RGBA8 texels
+	size_t MipChainBytes(int width, int height, int layers);
+}
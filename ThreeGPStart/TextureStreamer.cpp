@@ -0,0 +1,326 @@
+#include "TextureStreamer.h"
+#include "TextureManager.h"
+#include "TextureCompression.h"
+#include "JobSystem.h"
+#include "GLState.h"
+
+namespace Helpers
+{
+	static size_t AlignUp(size_t bytes, size_t alignment)
+	{
+		return (bytes + alignment - 1) / alignment * alignment;
+	}
+
+	static bool IsReady(const std::future<bool>& result)
+	{
+		return result.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+	}
+
+	static bool IsReady(const std::future<void>& result)
+	{
+		return result.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+	}
+
+	TextureStreamer::~TextureStreamer()
+	{
+		// Jobs write into the items and the mapped ring so must finish first
+		for (const std::unique_ptr<Item>& item : m_items)
+		{
+			if (item->decoded.valid())
+				item->decoded.wait();
+		}
+
+		for (Upload& upload : m_uploads)
+		{
+			if (upload.copied.valid())
+				upload.copied.wait();
+			if (upload.fence)
+				glDeleteSync(upload.fence);
+		}
+
+		if (m_buffer)
+		{
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffer);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			glDeleteBuffers(1, &m_buffer);
+		}
+	}
+
+	// Maps a ring of ringBytes, at most bytesPerFrame are handed to GL each Update. Needs OpenGL 4.4. Returns false on error.
+	bool TextureStreamer::Create(size_t ringBytes, size_t bytesPerFrame)
+	{
+		if (m_buffer)
+			return false;
+
+		m_bytesPerFrame = bytesPerFrame;
+		if (!GLEW_VERSION_4_4 && !GLEW_ARB_buffer_storage)
+		{
+			std::cout << "Texture streaming needs persistent buffer mapping, textures will upload directly" << std::endl;
+			return false;
+		}
+
+		// Written by the copy jobs and only read by GL, coherent so nothing needs flushing
+		const GLbitfield flags{ GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT };
+		glGenBuffers(1, &m_buffer);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffer);
+		glBufferStorage(GL_PIXEL_UNPACK_BUFFER, ringBytes, nullptr, flags);
+		m_mapped = (BYTE*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, ringBytes, flags);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+		if (!m_mapped)
+		{
+			std::cout << "Could not map the texture streaming ring, textures will upload directly" << std::endl;
+			glDeleteBuffers(1, &m_buffer);
+			m_buffer = 0;
+			return false;
+		}
+
+		m_capacity = ringBytes;
+		return true;
+	}
+
+	// Queues the decode. texture must have a GL name but no storage yet, it gets both its storage and its size once decoded.
+	// If the texture is dropped before it is resident the rest of the stream is skipped.
+	void TextureStreamer::Stream(const std::shared_ptr<Texture>& texture, const std::string& filepath, GLint wrapMode)
+	{
+		std::unique_ptr<Item> item{ std::make_unique<Item>() };
+		item->texture = texture;
+		item->filepath = filepath;
+		item->wrapMode = wrapMode;
+
+		Item* decoding{ item.get() };
+		item->decoded = JobSystem::Get().Submit([decoding]()
+			{
+				if (!decoding->image.Load(decoding->filepath))
+					return false;
+
+				BuildMipChain(decoding->image.GetData(), decoding->image.Width(), decoding->image.Height(), decoding->mips);
+				return true;
+			});
+
+		m_items.push_back(std::move(item));
+	}
+
+	// Takes bytes from the ring after the newest allocation, wrapping to the start if the end is too short.
+	// Returns false if GL is still reading the space needed.
+	bool TextureStreamer::Allocate(size_t bytes, size_t& offset)
+	{
+		bytes = AlignUp(bytes, KAlignment);
+		if (m_uploads.empty())
+			m_head = 0;
+
+		// The space in use runs from the oldest allocation up to m_head, wrapping round when m_head is before it
+		const size_t tail{ m_uploads.empty() ? 0 : m_uploads.front().offset };
+		if (m_uploads.empty() || m_head > tail)
+		{
+			if (m_capacity - m_head >= bytes)
+				offset = m_head;
+			else if (tail > bytes)
+				offset = 0;
+			else
+				return false;
+		}
+		else
+		{
+			// Strictly less so m_head never catches up with the oldest allocation
+			if (tail - m_head <= bytes)
+				return false;
+
+			offset = m_head;
+		}
+
+		m_head = offset + bytes;
+		m_bytesInUse += bytes;
+		return true;
+	}
+
+	// Frees the oldest ring space GL has finished reading, in order
+	void TextureStreamer::Retire()
+	{
+		while (!m_uploads.empty() && m_uploads.front().fence)
+		{
+			const GLenum status{ glClientWaitSync(m_uploads.front().fence, 0, 0) };
+			if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+				break;
+
+			glDeleteSync(m_uploads.front().fence);
+			m_bytesInUse -= AlignUp(m_uploads.front().bytes, KAlignment);
+			m_uploads.pop_front();
+		}
+	}
+
+	// Level 0 is the decoded image, the rest are the mip chain built alongside it
+	const BYTE* TextureStreamer::LevelData(const Item& item, int level) const
+	{
+		return level == 0 ? item.image.GetData() : item.mips[level - 1].data();
+	}
+
+	// Gives a decoded texture its storage with only the smallest level to be sampled. Returns false if there is nothing to stream.
+	bool TextureStreamer::StartItem(Item& item)
+	{
+		item.started = true;
+		if (!item.decoded.get())
+		{
+			std::cout << "Could not stream texture: " << item.filepath << std::endl;
+			return false;
+		}
+
+		std::shared_ptr<Texture> texture{ item.texture.lock() };
+		if (!texture)
+			return false;
+
+		const int width{ item.image.Width() };
+		const int height{ item.image.Height() };
+		item.numLevels = 1 + (int)item.mips.size();
+		item.nextLevel = item.numLevels - 1;
+		texture->SetSize(width, height, MipChainBytes(width, height, 1));
+
+		GLState::Get().BindTexture(0, GL_TEXTURE_2D, texture->GetId());
+		glTexStorage2D(GL_TEXTURE_2D, item.numLevels, GL_RGBA8, width, height);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, item.wrapMode);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, item.wrapMode);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, item.nextLevel);
+
+		return true;
+	}
+
+	// pixels is an offset into the ring when it is bound, otherwise CPU memory. Sampling then starts from this level.
+	void TextureStreamer::UploadLevel(Item& item, int level, int width, int height, const void* pixels)
+	{
+		m_stats.numLevelsUploaded++;
+		m_stats.bytesUploaded += (size_t)width * height * 4;
+
+		std::shared_ptr<Texture> texture{ item.texture.lock() };
+		if (!texture)
+			return;
+
+		GLState::Get().BindTexture(0, GL_TEXTURE_2D, texture->GetId());
+		glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+	}
+
+	// Hands GL the levels whose copies have finished, oldest first and within the frame's budget
+	void TextureStreamer::UploadCopied()
+	{
+		bool bound{ false };
+		for (Upload& upload : m_uploads)
+		{
+			if (upload.fence)
+				continue;
+
+			// In order so each texture's levels arrive smallest first
+			if (!IsReady(upload.copied))
+				break;
+
+			// At least one level a frame however large
+			if (m_stats.numLevelsUploaded > 0 && m_stats.bytesUploaded + upload.bytes > m_bytesPerFrame)
+				break;
+
+			if (!bound)
+			{
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffer);
+				bound = true;
+			}
+
+			Item& item{ *upload.item };
+			UploadLevel(item, upload.level, upload.width, upload.height, (const void*)upload.offset);
+			upload.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			upload.item = nullptr;
+
+			// Every level is in the ring or on the GPU now so the CPU copies can go
+			item.numPending--;
+			if (upload.level == 0)
+			{
+				item.image.Release();
+				item.mips.clear();
+			}
+		}
+
+		// Left bound, later client memory uploads would be read as offsets into the ring
+		if (bound)
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+
+	// Starts copy jobs for decoded textures, smallest level first, until the ring is full
+	void TextureStreamer::ScheduleCopies()
+	{
+		for (const std::unique_ptr<Item>& pointer : m_items)
+		{
+			Item& item{ *pointer };
+			if (!item.started)
+			{
+				if (!IsReady(item.decoded) || !StartItem(item))
+					continue;
+			}
+
+			// Dropped part way, the levels already in the ring still upload but no more are copied
+			if (item.texture.expired())
+				item.nextLevel = -1;
+
+			while (item.nextLevel >= 0)
+			{
+				const int level{ item.nextLevel };
+				const int width{ std::max(item.image.Width() >> level, 1) };
+				const int height{ std::max(item.image.Height() >> level, 1) };
+				const size_t bytes{ (size_t)width * height * 4 };
+				const BYTE* source{ LevelData(item, level) };
+
+				// Too big for the ring (or there is no ring), uploaded from CPU memory once the smaller levels are in
+				if (AlignUp(bytes, KAlignment) > m_capacity)
+				{
+					if (item.numPending > 0)
+						break;
+
+					UploadLevel(item, level, width, height, source);
+					item.nextLevel--;
+					continue;
+				}
+
+				size_t offset;
+				if (!Allocate(bytes, offset))
+				{
+					m_stats.numRingFull++;
+					return;
+				}
+
+				BYTE* destination{ m_mapped + offset };
+				Upload upload;
+				upload.item = &item;
+				upload.level = level;
+				upload.width = width;
+				upload.height = height;
+				upload.offset = offset;
+				upload.bytes = bytes;
+				upload.copied = JobSystem::Get().Submit([destination, source, bytes]() { memcpy(destination, source, bytes); });
+				m_uploads.push_back(std::move(upload));
+
+				item.numPending++;
+				item.nextLevel--;
+			}
+		}
+	}
+
+	// Call once a frame on the GL thread: frees ring space GL has finished with, uploads copied levels and starts new copies
+	void TextureStreamer::Update()
+	{
+		m_stats.numLevelsUploaded = 0;
+		m_stats.bytesUploaded = 0;
+
+		Retire();
+		UploadCopied();
+		ScheduleCopies();
+
+		// Finished once every level is uploaded, or the decode failed or the texture was dropped
+		for (auto item = m_items.begin(); item != m_items.end();)
+		{
+			const bool finished{ (*item)->started && (*item)->nextLevel < 0 && (*item)->numPending == 0 };
+			item = finished ? m_items.erase(item) : std::next(item);
+		}
+
+		m_stats.numStreaming = m_items.size();
+		m_stats.ringBytesInUse = m_bytesInUse;
+	}
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "ExternalLibraryHeaders.h"
+#include "ImageLoader.h"
+#include <deque>
+#include <future>
+
+namespace Helpers
+{
+	class Texture;
+
+	// Uploads textures over several frames instead of stalling the one they are asked for in.
+	// Images are decoded and their mip chains built on the job system, then jobs copy each level into a ring of persistently
+	// mapped pixel unpack buffer memory for GL to read from. Fences say when GL has finished with a stretch of the ring.
+	// The smallest mips go first and GL_TEXTURE_BASE_LEVEL follows the finest one resident, so textures sharpen as they arrive.
+	class TextureStreamer
+	{
+	public:
+		struct Stats
+		{
+			// Textures not yet fully resident
+			size_t numStreaming{ 0 };
+
+			// Uploaded by the last Update
+			size_t numLevelsUploaded{ 0 };
+			size_t bytesUploaded{ 0 };
+
+			size_t ringBytesInUse{ 0 };
+
+			// Times a level had to wait a frame for ring space
+			size_t numRingFull{ 0 };
+		};
+	private:
+		// Ring allocations start on this boundary, enough for any pixel transfer alignment
+		static constexpr size_t KAlignment{ 64 };
+
+		// One texture on its way in
+		struct Item
+		{
+			std::weak_ptr<Texture> texture;
+			std::string filepath;
+			GLint wrapMode{ GL_REPEAT };
+
+			// Filled in by the decode job, freed once level 0 is uploaded
+			ImageLoader image;
+			std::vector<std::vector<BYTE>> mips;
+			std::future<bool> decoded;
+
+			int numLevels{ 0 };
+
+			// The next level to copy counting down to 0, -1 before the storage exists
+			int nextLevel{ -1 };
+			bool started{ false };
+
+			// Copied or being copied into the ring but not yet uploaded
+			int numPending{ 0 };
+		};
+
+		// One mip level's trip through the ring
+		struct Upload
+		{
+			Item* item{ nullptr };
+			int level{ 0 };
+			int width{ 0 };
+			int height{ 0 };
+			size_t offset{ 0 };
+			size_t bytes{ 0 };
+			std::future<void> copied;
+
+			// Set once GL has been told to read it, the ring space is free when this signals
+			GLsync fence{ nullptr };
+		};
+
+		GLuint m_buffer{ 0 };
+		BYTE* m_mapped{ nullptr };
+		size_t m_capacity{ 0 };
+		size_t m_head{ 0 };
+		size_t m_bytesInUse{ 0 };
+		size_t m_bytesPerFrame{ 0 };
+
+		std::deque<std::unique_ptr<Item>> m_items;
+
+		// In ring order, the front is the oldest allocation
+		std::deque<Upload> m_uploads;
+		Stats m_stats;
+
+		bool Allocate(size_t bytes, size_t& offset);
+		void Retire();
+		bool StartItem(Item& item);
+		void ScheduleCopies();
+		void UploadCopied();
+		void UploadLevel(Item& item, int level, int width, int height, const void* pixels);
+		const BYTE* LevelData(const Item& item, int level) const;
+	public:
+		TextureStreamer() = default;
+		~TextureStreamer();
+
+		TextureStreamer(const TextureStreamer&) = delete;
+		TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+		// Maps a ring of ringBytes, at most bytesPerFrame are handed to GL each Update. Needs OpenGL 4.4. Returns false on error.
+		bool Create(size_t ringBytes, size_t bytesPerFrame);
+
+		// Queues the decode. texture must have a GL name but no storage yet, it gets both its storage and its size once decoded.
+		// If the texture is dropped before it is resident the rest of the stream is skipped.
+		void Stream(const std::shared_ptr<Texture>& texture, const std::string& filepath, GLint wrapMode);
+
+		// Call once a frame on the GL thread: frees ring space GL has finished with, uploads copied levels and starts new copies
+		void Update();
+
+		// True while anything is still decoding or uploading
+		bool Busy() const { return !m_items.empty(); }
+
+		const Stats& GetStats() const { return m_stats; }
+	};
+}
@@ -0,0 +1,223 @@
+#include "VertexFormat.h"
+#include "GLState.h"
+#include <glm/packing.hpp>
+#include <glm/gtc/packing.hpp>
+
+namespace Helpers
+{
+	// Half floats have 11 bits of precision so beyond this the UV error becomes visible when tiling
+	static constexpr float KMaxHalfUV{ 4.0f };
+
+	// Interleave (and optionally pack) the mesh into one vertex buffer
+	InterleavedMesh BuildInterleavedMesh(const Mesh& mesh, unsigned int packing)
+	{
+		InterleavedMesh out;
+		out.numVertices = (GLuint)mesh.vertices.size();
+		out.numElements = (GLuint)mesh.elements.size();
+
+		// Normals and uvs are optional so only included when there is one per vertex
+		const bool hasNormals{ !mesh.normals.empty() && mesh.normals.size() == mesh.vertices.size() };
+		const bool hasUVs{ !mesh.uvCoords.empty() && mesh.uvCoords.size() == mesh.vertices.size() };
+
+		bool packUVs{ hasUVs && (packing & KVertexPackUVs) };
+		for (size_t i = 0; packUVs && i < mesh.uvCoords.size(); i++)
+		{
+			if (std::abs(mesh.uvCoords[i].x) > KMaxHalfUV || std::abs(mesh.uvCoords[i].y) > KMaxHalfUV)
+				packUVs = false;
+		}
+		const bool packNormals{ hasNormals && (packing & KVertexPackNormals) };
+
+		// Work out the layout
+		GLuint offset{ 0 };
+		out.attributes.push_back({ KPositionLocation, 3, GL_FLOAT, GL_FALSE, offset });
+		offset += sizeof(glm::vec3);
+
+		GLuint normalOffset{ offset };
+		if (hasNormals)
+		{
+			if (packNormals)
+			{
+				out.attributes.push_back({ KNormalLocation, 4, GL_INT_2_10_10_10_REV, GL_TRUE, offset });
+				offset += sizeof(uint32_t);
+			}
+			else
+			{
+				out.attributes.push_back({ KNormalLocation, 3, GL_FLOAT, GL_FALSE, offset });
+				offset += sizeof(glm::vec3);
+			}
+		}
+
+		GLuint uvOffset{ offset };
+		if (hasUVs)
+		{
+			if (packUVs)
+			{
+				out.attributes.push_back({ KUVLocation, 2, GL_HALF_FLOAT, GL_FALSE, offset });
+				offset += sizeof(uint32_t);
+			}
+			else
+			{
+				out.attributes.push_back({ KUVLocation, 2, GL_FLOAT, GL_FALSE, offset });
+				offset += sizeof(glm::vec2);
+			}
+		}
+
+		out.stride = (GLsizei)offset;
+
+		// Fill the vertex buffer
+		out.vertexData.resize((size_t)out.stride * out.numVertices);
+		for (size_t v = 0; v < out.numVertices; v++)
+		{
+			BYTE* vertex{ out.vertexData.data() + v * out.stride };
+			memcpy(vertex, &mesh.vertices[v], sizeof(glm::vec3));
+
+			if (hasNormals)
+			{
+				if (packNormals)
+				{
+					// GL_INT_2_10_10_10_REV has x in the low bits, the same order glm packs in
+					glm::vec3 normal{ mesh.normals[v] };
+					const float length{ glm::length(normal) };
+					if (length > 0)
+						normal /= length;
+
+					const uint32_t packed{ glm::packSnorm3x10_1x2(glm::vec4(normal, 0.0f)) };
+					memcpy(vertex + normalOffset, &packed, sizeof(packed));
+				}
+				else
+				{
+					memcpy(vertex + normalOffset, &mesh.normals[v], sizeof(glm::vec3));
+				}
+			}
+
+			if (hasUVs)
+			{
+				if (packUVs)
+				{
+					const uint32_t packed{ glm::packHalf2x16(mesh.uvCoords[v]) };
+					memcpy(vertex + uvOffset, &packed, sizeof(packed));
+				}
+				else
+				{
+					memcpy(vertex + uvOffset, &mesh.uvCoords[v], sizeof(glm::vec2));
+				}
+			}
+		}
+
+		// And the elements
+		if ((packing & KVertexShortIndices) && out.numVertices < 65536)
+		{
+			out.elementType = GL_UNSIGNED_SHORT;
+			out.elementData.resize(sizeof(uint16_t) * out.numElements);
+
+			uint16_t* elements{ (uint16_t*)out.elementData.data() };
+			for (size_t i = 0; i < out.numElements; i++)
+				elements[i] = (uint16_t)mesh.elements[i];
+		}
+		else
+		{
+			out.elementType = GL_UNSIGNED_INT;
+			out.elementData.resize(sizeof(GLuint) * out.numElements);
+			if (out.numElements)
+				memcpy(out.elementData.data(), mesh.elements.data(), out.elementData.size());
+		}
+
+		out.unpackedBytes = sizeof(glm::vec3) * mesh.vertices.size() + sizeof(glm::vec3) * mesh.normals.size() +
+			sizeof(glm::vec2) * mesh.uvCoords.size() + sizeof(GLuint) * mesh.elements.size();
+
+		return out;
+	}
+
+	// Creates the vertex buffer, element buffer and a VAO that wraps them. Returns the VAO.
+	GLuint InterleavedMesh::CreateVAO(GLuint& vertexBuffer, GLuint& elementBuffer) const
+	{
+		glGenBuffers(1, &vertexBuffer);
+		glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+		glBufferData(GL_ARRAY_BUFFER, vertexData.size(), vertexData.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		glGenBuffers(1, &elementBuffer);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBuffer);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, elementData.size(), elementData.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+		GLuint vao;
+		glGenVertexArrays(1, &vao);
+		GLState::Get().BindVertexArray(vao);
+
+		glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+		for (const VertexAttribute& attribute : attributes)
+		{
+			glEnableVertexAttribArray(attribute.location);
+			glVertexAttribPointer(attribute.location, attribute.numComponents, attribute.type, attribute.normalised,
+				stride, (void*)(size_t)attribute.offset);
+		}
+
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBuffer);
+		GLState::Get().BindVertexArray(0);
+
+		return vao;
+	}
+
+	// Decode a vertex back to full floats, used to verify the packing
+	glm::vec3 InterleavedMesh::GetPosition(size_t vertex) const
+	{
+		glm::vec3 position;
+		memcpy(&position, vertexData.data() + vertex * stride + attributes[0].offset, sizeof(position));
+		return position;
+	}
+
+	glm::vec3 InterleavedMesh::GetNormal(size_t vertex) const
+	{
+		for (const VertexAttribute& attribute : attributes)
+		{
+			if (attribute.location != KNormalLocation)
+				continue;
+
+			const BYTE* data{ vertexData.data() + vertex * stride + attribute.offset };
+			if (attribute.type == GL_INT_2_10_10_10_REV)
+			{
+				uint32_t packed;
+				memcpy(&packed, data, sizeof(packed));
+				return glm::vec3(glm::unpackSnorm3x10_1x2(packed));
+			}
+
+			glm::vec3 normal;
+			memcpy(&normal, data, sizeof(normal));
+			return normal;
+		}
+
+		return glm::vec3(0);
+	}
+
+	glm::vec2 InterleavedMesh::GetUV(size_t vertex) const
+	{
+		for (const VertexAttribute& attribute : attributes)
+		{
+			if (attribute.location != KUVLocation)
+				continue;
+
+			const BYTE* data{ vertexData.data() + vertex * stride + attribute.offset };
+			if (attribute.type == GL_HALF_FLOAT)
+			{
+				uint32_t packed;
+				memcpy(&packed, data, sizeof(packed));
+				return glm::unpackHalf2x16(packed);
+			}
+
+			glm::vec2 uv;
+			memcpy(&uv, data, sizeof(uv));
+			return uv;
+		}
+
+		return glm::vec2(0);
+	}
+
+	GLuint InterleavedMesh::GetElement(size_t element) const
+	{
+		if (elementType == GL_UNSIGNED_SHORT)
+			return ((const uint16_t*)elementData.data())[element];
+
+		return ((const GLuint*)elementData.data())[element];
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+// Interleaved and packed vertex layouts built from a Helpers::Mesh
+
+#include "ExternalLibraryHeaders.h"
+#include "Mesh.h"
+
+namespace Helpers
+{
+	// Options for BuildInterleavedMesh, combine with |
+	enum VertexPacking : unsigned int
+	{
+		KVertexPackNone = 0,
+		KVertexPackNormals = 1,		// Normals as 10:10:10:2 signed normalised (4 bytes rather than 12)
+		KVertexPackUVs = 2,			// UVs as half floats (4 bytes rather than 8), ignored if the UVs are too large for half precision
+		KVertexShortIndices = 4,	// 16 bit elements when the mesh has fewer than 65536 vertices
+		KVertexPackAll = KVertexPackNormals | KVertexPackUVs | KVertexShortIndices
+	};
+
+	// One stream within the interleaved buffer, maps directly onto glVertexAttribPointer
+	struct VertexAttribute
+	{
+		GLuint location;
+		GLint numComponents;
+		GLenum type;
+		GLboolean normalised;
+		GLuint offset;
+	};
+
+	// CPU side copy of a mesh laid out ready for a single vertex buffer and element buffer
+	struct InterleavedMesh
+	{
+		std::vector<BYTE> vertexData;
+		std::vector<BYTE> elementData;
+		std::vector<VertexAttribute> attributes;
+
+		GLsizei stride{ 0 };
+		GLenum elementType{ GL_UNSIGNED_INT };
+		GLuint numVertices{ 0 };
+		GLuint numElements{ 0 };
+
+		// Size the same mesh takes as separate full float position / normal / uv buffers plus 32 bit elements
+		size_t unpackedBytes{ 0 };
+
+		size_t PackedBytes() const { return vertexData.size() + elementData.size(); }
+
+		// Creates the vertex buffer, element buffer and a VAO that wraps them. Returns the VAO.
+		GLuint CreateVAO(GLuint& vertexBuffer, GLuint& elementBuffer) const;
+
+		// Decode a vertex back to full floats, used to verify the packing
+		glm::vec3 GetPosition(size_t vertex) const;
+		glm::vec3 GetNormal(size_t vertex) const;
+		glm::vec2 GetUV(size_t vertex) const;
+		GLuint GetElement(size_t element) const;
+	};
+
+	// Attribute locations match the layout qualifiers in the shaders
+	constexpr GLuint KPositionLocation{ 0 };
+	constexpr GLuint KNormalLocation{ 1 };
+	constexpr GLuint KUVLocation{ 2 };
+
+	// Interleave (and optionally pack) the mesh into one vertex buffer
+	InterleavedMesh BuildInterleavedMesh(const Mesh& mesh, unsigned int packing = KVertexPackAll);
+}